@@ -3,6 +3,10 @@
 # LIBEXCEPT_FOUND        - System has LibExcept
 # LIBEXCEPT_INCLUDE_DIRS - The LibExcept include directories
 # LIBEXCEPT_LIBRARIES    - The libraries needed to use LibExcept
+# LIBEXCEPT_FD_PROVENANCE_LIBRARIES - The opt-in library replacing open(),
+#                          close(), etc. to track file descriptor provenance
+# LIBEXCEPT_THROW_TRACE_LIBRARIES - The opt-in library replacing
+#                          __cxa_throw() to capture the throw stacks
 # LIBEXCEPT_DEFINITIONS  - Compiler switches required for using LibExcept
 #
 # License:
@@ -42,13 +46,35 @@ find_library(
         ENV LIBEXCEPT_LIBRARY
 )
 
+find_library(
+    LIBEXCEPT_FD_PROVENANCE_LIBRARY
+        except_fd_provenance
+
+    PATHS
+        ${LIBEXCEPT_LIBRARY_DIR}
+        ENV LIBEXCEPT_LIBRARY
+)
+
+find_library(
+    LIBEXCEPT_THROW_TRACE_LIBRARY
+        except_throw_trace
+
+    PATHS
+        ${LIBEXCEPT_LIBRARY_DIR}
+        ENV LIBEXCEPT_LIBRARY
+)
+
 mark_as_advanced(
     LIBEXCEPT_INCLUDE_DIR
     LIBEXCEPT_LIBRARY
+    LIBEXCEPT_FD_PROVENANCE_LIBRARY
+    LIBEXCEPT_THROW_TRACE_LIBRARY
 )
 
 set(LIBEXCEPT_INCLUDE_DIRS ${LIBEXCEPT_INCLUDE_DIR})
 set(LIBEXCEPT_LIBRARIES    ${LIBEXCEPT_LIBRARY})
+set(LIBEXCEPT_FD_PROVENANCE_LIBRARIES ${LIBEXCEPT_FD_PROVENANCE_LIBRARY})
+set(LIBEXCEPT_THROW_TRACE_LIBRARIES ${LIBEXCEPT_THROW_TRACE_LIBRARY})
 
 include(FindPackageHandleStandardArgs)
 
@@ -0,0 +1,501 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/crash_journal.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstring>
+#include    <typeinfo>
+
+
+// C
+//
+#include    <execinfo.h>
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <time.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the memory mapped crash journal.
+ *
+ * Writing a report from a dying process is not reliable: the process may
+ * be killed with SIGKILL, or the signal handler itself may crash. The
+ * crash journal avoids those problems by saving the records directly
+ * in a file mapped in memory with `MAP_SHARED`. Once a record is copied
+ * to the map, the kernel owns the data and writes it to disk even if
+ * the process dies right after.
+ *
+ * The journal is a header followed by an array of fixed size slots used
+ * in a circular manner. A writer claims a slot by incrementing the
+ * `f_next` counter of the header (one atomic operation, no lock), fills
+ * it, then saves the slot sequence number. A slot with a sequence of 0
+ * was being written when the process died and gets ignored by the reader.
+ *
+ * The journal is reopened, not reset, by the next run of the process,
+ * as long as its geometry did not change. This way the records of a
+ * crash remain available after a restart. The `crash-journal` tool
+ * prints the records of a journal.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+constexpr char const            g_journal_magic[4] = { 'L', 'X', 'J', '1' };
+constexpr std::uint32_t const   JOURNAL_VERSION = 1;
+
+
+struct journal_header_t
+{
+    char                        f_magic[4];
+    std::uint32_t               f_version;
+    std::uint32_t               f_slot_size;
+    std::uint32_t               f_slot_count;
+    std::atomic<std::uint64_t>  f_next;
+    std::uint8_t                f_reserved[40];
+};
+
+
+struct journal_slot_t
+{
+    std::atomic<std::uint64_t>  f_sequence;
+    std::uint32_t               f_type;
+    std::int32_t                f_pid;
+    std::int32_t                f_tid;
+    std::int32_t                f_signal;
+    std::int64_t                f_sec;
+    std::int64_t                f_nsec;
+    std::uint64_t               f_address;
+    std::uint32_t               f_frame_count;
+    std::uint32_t               f_reserved;
+    std::uint64_t               f_frames[CRASH_JOURNAL_FRAMES];
+    char                        f_name[CRASH_JOURNAL_NAME_SIZE];
+    char                        f_message[CRASH_JOURNAL_MESSAGE_SIZE];
+};
+
+
+static_assert(sizeof(journal_header_t) == 64);
+static_assert(sizeof(journal_slot_t) == 512);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+
+std::atomic<journal_header_t *> g_journal = nullptr;
+std::size_t                     g_journal_size = 0;
+thread_local std::exception const *
+                                g_last_exception = nullptr;
+thread_local journal_header_t * g_last_header = nullptr;
+thread_local journal_slot_t *   g_last_slot = nullptr;
+thread_local std::uint64_t      g_last_sequence = 0;
+
+
+journal_slot_t * slots(journal_header_t * header)
+{
+    return reinterpret_cast<journal_slot_t *>(header + 1);
+}
+
+
+journal_slot_t * claim_slot(journal_header_t * header, std::uint64_t & sequence)
+{
+    sequence = header->f_next.fetch_add(1, std::memory_order_relaxed) + 1;
+    journal_slot_t * slot(slots(header) + (sequence - 1) % header->f_slot_count);
+    slot->f_sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    slot->f_pid = getpid();
+    slot->f_tid = gettid();
+    slot->f_signal = 0;
+    slot->f_sec = now.tv_sec;
+    slot->f_nsec = now.tv_nsec;
+    slot->f_address = 0;
+    slot->f_reserved = 0;
+
+    return slot;
+}
+
+
+void copy_string(char * dst, char const * src, std::size_t size)
+{
+    std::size_t const l(std::min(strlen(src), size - 1));
+    memcpy(dst, src, l);
+    memset(dst + l, 0, size - l);
+}
+
+
+void copy_frames(journal_slot_t * slot, void * const * frames, int frame_count)
+{
+    std::size_t const count(std::min<std::size_t>(std::max(frame_count, 0), CRASH_JOURNAL_FRAMES));
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        slot->f_frames[idx] = reinterpret_cast<std::uintptr_t>(frames[idx]);
+    }
+    slot->f_frame_count = count;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Open the crash journal.
+ *
+ * This function maps \p filename in memory. From then on, the libexcept
+ * exceptions and the crashes caught by init_report_signal() get saved in
+ * that file.
+ *
+ * If the file exists and has the same geometry (i.e. same number of
+ * \p slot_count), the existing records are kept and new ones get added after
+ * them, overwriting the oldest. Otherwise the file is reset.
+ *
+ * Each slot uses 512 bytes. The journal can have up to
+ * CRASH_JOURNAL_MAX_SLOTS slots (512Mb).
+ *
+ * If a journal is already open, it gets closed first.
+ *
+ * \exception crash_journal_error
+ * This exception is raised if \p slot_count is 0 or larger than
+ * CRASH_JOURNAL_MAX_SLOTS, or if the file cannot be created or mapped.
+ *
+ * \param[in] filename  The path to the journal file.
+ * \param[in] slot_count  The number of records the journal can hold.
+ */
+void open_crash_journal(std::string const & filename, std::size_t slot_count)
+{
+    if(slot_count == 0)
+    {
+        throw crash_journal_error("the crash journal needs at least one slot.");
+    }
+    if(slot_count > CRASH_JOURNAL_MAX_SLOTS)
+    {
+        throw crash_journal_error("the crash journal cannot have more than "
+                                + std::to_string(CRASH_JOURNAL_MAX_SLOTS)
+                                + " slots.");
+    }
+
+    close_crash_journal();
+
+    int const fd(open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600));
+    if(fd == -1)
+    {
+        throw crash_journal_error("could not open crash journal \"" + filename + "\".");
+    }
+
+    std::size_t const size(sizeof(journal_header_t) + slot_count * sizeof(journal_slot_t));
+    struct stat st;
+    if(fstat(fd, &st) != 0
+    || (static_cast<std::size_t>(st.st_size) != size && ftruncate(fd, size) != 0))
+    {
+        close(fd);
+        throw crash_journal_error("could not resize crash journal \"" + filename + "\".");
+    }
+
+    void * ptr(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    if(ptr == MAP_FAILED)
+    {
+        throw crash_journal_error("could not map crash journal \"" + filename + "\".");
+    }
+
+    journal_header_t * header(reinterpret_cast<journal_header_t *>(ptr));
+    if(memcmp(header->f_magic, g_journal_magic, sizeof(g_journal_magic)) != 0
+    || header->f_version != JOURNAL_VERSION
+    || header->f_slot_size != sizeof(journal_slot_t)
+    || header->f_slot_count != slot_count)
+    {
+        memset(ptr, 0, size);
+        memcpy(header->f_magic, g_journal_magic, sizeof(g_journal_magic));
+        header->f_version = JOURNAL_VERSION;
+        header->f_slot_size = sizeof(journal_slot_t);
+        header->f_slot_count = static_cast<std::uint32_t>(slot_count);
+    }
+
+    g_journal_size = size;
+    g_journal.store(header, std::memory_order_release);
+}
+
+
+/** \brief Close the crash journal.
+ *
+ * This function unmaps the journal. The data already saved remains in
+ * the file.
+ *
+ * \warning
+ * No other thread may be saving an exception while the journal gets
+ * closed. In most cases, you want to open the journal on startup and
+ * never close it.
+ */
+void close_crash_journal()
+{
+    journal_header_t * header(g_journal.exchange(nullptr));
+    if(header != nullptr)
+    {
+        munmap(header, g_journal_size);
+        g_journal_size = 0;
+    }
+}
+
+
+/** \brief Check whether a crash journal is open.
+ *
+ * \return true if open_crash_journal() was called successfully.
+ */
+bool has_crash_journal()
+{
+    return g_journal.load(std::memory_order_relaxed) != nullptr;
+}
+
+
+/** \brief Save an exception in the crash journal.
+ *
+ * The libexcept exceptions call this function from their constructor
+ * through record_exception(). If no journal is open, nothing happens.
+ *
+ * \param[in] e  The exception to save.
+ */
+void journal_exception(std::exception const & e)
+{
+    g_last_exception = &e;
+    g_last_slot = nullptr;
+
+    journal_header_t * header(g_journal.load(std::memory_order_acquire));
+    if(header == nullptr)
+    {
+        return;
+    }
+
+    std::uint64_t sequence(0);
+    journal_slot_t * slot(claim_slot(header, sequence));
+    slot->f_type = static_cast<std::uint32_t>(journal_record_type_t::JOURNAL_RECORD_EXCEPTION);
+    copy_string(slot->f_name, typeid(e).name(), sizeof(slot->f_name));
+    copy_string(slot->f_message, e.what(), sizeof(slot->f_message));
+
+    void * frames[CRASH_JOURNAL_FRAMES];
+    copy_frames(slot, frames, backtrace(frames, CRASH_JOURNAL_FRAMES));
+
+    slot->f_sequence.store(sequence, std::memory_order_release);
+
+    g_last_header = header;
+    g_last_slot = slot;
+    g_last_sequence = sequence;
+}
+
+
+/** \brief Fix the type of the last exception saved in the journal.
+ *
+ * This function is called by record_exception_type() once an exception
+ * has its final type. If \p e is the last exception this thread saved
+ * in the journal and the slot was not reused since, the name gets
+ * replaced by the name of the most derived type.
+ *
+ * \param[in] e  The exception which was just saved.
+ */
+void journal_exception_type(std::exception const & e)
+{
+    journal_exception_type(e, typeid(e));
+}
+
+
+/** \brief Fix the type of the last exception saved in the journal.
+ *
+ * This function is the same as journal_exception_type(std::exception const &)
+ * except that the type is given explicitly.
+ *
+ * \param[in] e  The exception which was just saved.
+ * \param[in] type  The final type of \p e.
+ */
+void journal_exception_type(std::exception const & e, std::type_info const & type)
+{
+    if(g_last_exception != &e
+    || g_last_slot == nullptr
+    || g_journal.load(std::memory_order_acquire) != g_last_header
+    || strncmp(g_last_slot->f_message, e.what(), sizeof(g_last_slot->f_message) - 1) != 0)
+    {
+        return;
+    }
+
+    // mark the slot as being written; if another thread claimed it in
+    // the meantime, leave it alone
+    //
+    std::uint64_t expected(g_last_sequence);
+    if(!g_last_slot->f_sequence.compare_exchange_strong(expected, 0, std::memory_order_relaxed))
+    {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    copy_string(g_last_slot->f_name, type.name(), sizeof(g_last_slot->f_name));
+
+    g_last_slot->f_sequence.store(g_last_sequence, std::memory_order_release);
+}
+
+
+/** \brief Save a crash in the crash journal.
+ *
+ * The report_signal() handler calls this function first, before it tries
+ * anything else, so the record exists even if the rest of the handler
+ * fails. The function is async-signal-safe.
+ *
+ * \param[in] sig  The signal that was received.
+ * \param[in] info  The signal information, may be nullptr.
+ * \param[in] frames  The raw frames of the crashing thread.
+ * \param[in] frame_count  The number of \p frames.
+ */
+void journal_crash(
+      int sig
+    , siginfo_t const * info
+    , void * const * frames
+    , int frame_count)
+{
+    journal_header_t * header(g_journal.load(std::memory_order_acquire));
+    if(header == nullptr)
+    {
+        return;
+    }
+
+    std::uint64_t sequence(0);
+    journal_slot_t * slot(claim_slot(header, sequence));
+    slot->f_type = static_cast<std::uint32_t>(journal_record_type_t::JOURNAL_RECORD_CRASH);
+    slot->f_signal = sig;
+    copy_string(slot->f_name, sigabbrev_np(sig) == nullptr ? "" : sigabbrev_np(sig), sizeof(slot->f_name));
+    copy_string(slot->f_message, sigdescr_np(sig) == nullptr ? "" : sigdescr_np(sig), sizeof(slot->f_message));
+    if(info != nullptr)
+    {
+        slot->f_address = reinterpret_cast<std::uintptr_t>(info->si_addr);
+    }
+    copy_frames(slot, frames, frame_count);
+
+    slot->f_sequence.store(sequence, std::memory_order_release);
+}
+
+
+/** \brief Read a crash journal.
+ *
+ * This function reads the records found in the journal \p filename and
+ * returns them from the oldest to the newest. Slots which were never used
+ * or were being written when the process died are ignored.
+ *
+ * The function does not need the journal to be open and can be used by
+ * another process, for example after a restart.
+ *
+ * \exception crash_journal_error
+ * This exception is raised if the file cannot be read or is not a valid
+ * crash journal.
+ *
+ * \param[in] filename  The path to the journal file.
+ *
+ * \return The list of records.
+ */
+journal_records_t read_crash_journal(std::string const & filename)
+{
+    int const fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd == -1)
+    {
+        throw crash_journal_error("could not open crash journal \"" + filename + "\".");
+    }
+
+    std::vector<char> buffer;
+    struct stat st;
+    if(fstat(fd, &st) == 0)
+    {
+        buffer.resize(st.st_size);
+    }
+    std::size_t size(0);
+    while(size < buffer.size())
+    {
+        ssize_t const r(read(fd, buffer.data() + size, buffer.size() - size));
+        if(r <= 0)
+        {
+            break;
+        }
+        size += r;
+    }
+    close(fd);
+
+    journal_header_t const * header(reinterpret_cast<journal_header_t const *>(buffer.data()));
+    if(size < sizeof(journal_header_t)
+    || memcmp(header->f_magic, g_journal_magic, sizeof(g_journal_magic)) != 0
+    || header->f_version != JOURNAL_VERSION
+    || header->f_slot_size != sizeof(journal_slot_t)
+    || size != sizeof(journal_header_t) + header->f_slot_count * sizeof(journal_slot_t))
+    {
+        throw crash_journal_error("\"" + filename + "\" is not a valid crash journal.");
+    }
+
+    journal_records_t result;
+    journal_slot_t const * slot(reinterpret_cast<journal_slot_t const *>(header + 1));
+    for(std::uint32_t idx(0); idx < header->f_slot_count; ++idx, ++slot)
+    {
+        std::uint64_t const sequence(slot->f_sequence.load(std::memory_order_relaxed));
+        if(sequence == 0)
+        {
+            continue;
+        }
+
+        journal_record_t record;
+        record.f_sequence = sequence;
+        record.f_type = static_cast<journal_record_type_t>(slot->f_type);
+        record.f_pid = slot->f_pid;
+        record.f_tid = slot->f_tid;
+        record.f_signal = slot->f_signal;
+        record.f_time.tv_sec = slot->f_sec;
+        record.f_time.tv_nsec = slot->f_nsec;
+        record.f_address = slot->f_address;
+        record.f_frames.assign(
+                  slot->f_frames
+                , slot->f_frames + std::min<std::size_t>(slot->f_frame_count, CRASH_JOURNAL_FRAMES));
+        record.f_name = std::string(slot->f_name, strnlen(slot->f_name, sizeof(slot->f_name)));
+        record.f_message = std::string(slot->f_message, strnlen(slot->f_message, sizeof(slot->f_message)));
+        result.push_back(record);
+    }
+
+    std::sort(
+          result.begin()
+        , result.end()
+        , [](journal_record_t const & a, journal_record_t const & b)
+          {
+              return a.f_sequence < b.f_sequence;
+          });
+
+    return result;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
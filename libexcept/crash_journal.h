@@ -0,0 +1,105 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/exception.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <typeinfo>
+#include    <vector>
+
+
+// C
+//
+#include    <signal.h>
+
+
+
+/** \file
+ * \brief Declarations of the memory mapped crash journal.
+ *
+ * This file defines the functions used to save exceptions and crashes
+ * in a journal file mapped in memory so the data survives the death of
+ * the process, and the functions used to read it back.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(crash_journal_error);
+
+
+constexpr std::size_t const     CRASH_JOURNAL_DEFAULT_SLOTS = 1024;
+constexpr std::size_t const     CRASH_JOURNAL_MAX_SLOTS = 1024 * 1024;
+constexpr std::size_t const     CRASH_JOURNAL_FRAMES = 16;
+constexpr std::size_t const     CRASH_JOURNAL_NAME_SIZE = 80;
+constexpr std::size_t const     CRASH_JOURNAL_MESSAGE_SIZE = 248;
+
+
+enum class journal_record_type_t : std::uint32_t
+{
+    JOURNAL_RECORD_EXCEPTION = 1,
+    JOURNAL_RECORD_CRASH = 2,
+};
+
+
+struct journal_record_t
+{
+    std::uint64_t               f_sequence = 0;
+    journal_record_type_t       f_type = journal_record_type_t::JOURNAL_RECORD_EXCEPTION;
+    pid_t                       f_pid = 0;
+    pid_t                       f_tid = 0;
+    int                         f_signal = 0;
+    timespec                    f_time = timespec();
+    std::uint64_t               f_address = 0;
+    std::vector<std::uint64_t>  f_frames = std::vector<std::uint64_t>();
+    std::string                 f_name = std::string();
+    std::string                 f_message = std::string();
+};
+
+typedef std::vector<journal_record_t>   journal_records_t;
+
+
+void                            open_crash_journal(
+                                          std::string const & filename
+                                        , std::size_t slot_count = CRASH_JOURNAL_DEFAULT_SLOTS);
+void                            close_crash_journal();
+bool                            has_crash_journal();
+void                            journal_exception(std::exception const & e);
+void                            journal_exception_type(std::exception const & e);
+void                            journal_exception_type(std::exception const & e, std::type_info const & type);
+void                            journal_crash(
+                                          int sig
+                                        , siginfo_t const * info
+                                        , void * const * frames
+                                        , int frame_count);
+journal_records_t               read_crash_journal(std::string const & filename);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -22,12 +22,16 @@
 #include    "libexcept/exception.h"
 
 #include    "libexcept/demangle.h"
+#include    "libexcept/exception_context.h"
+#include    "libexcept/recent_exceptions.h"
 
 
 // C++
 //
+#include    <cstring>
 #include    <iostream>
 #include    <memory>
+#include    <type_traits>
 #include    <vector>
 
 
@@ -147,6 +151,14 @@ namespace
 {
 
 
+// moving an exception must never throw (it happens while unwinding)
+//
+static_assert(std::is_nothrow_move_constructible_v<exception_base_t>);
+static_assert(std::is_nothrow_move_constructible_v<logic_exception_t>);
+static_assert(std::is_nothrow_move_constructible_v<out_of_range_t>);
+static_assert(std::is_nothrow_move_constructible_v<exception_t>);
+
+
 /** \brief Global flag to eventually prevent stack trace collection.
  *
  * Whenever a libexcept exception is raised, the stack gets collected.
@@ -166,6 +178,59 @@ namespace
 collect_stack_t     g_collect_stack = collect_stack_t::COLLECT_STACK_YES;
 
 
+/** \brief Whether exceptions with a cause reuse its stack trace.
+ *
+ * See set_reuse_cause_stack() for details.
+ */
+bool                g_reuse_cause_stack = true;
+
+
+
+/** \brief Concatenate a prefix and a message without allocating.
+ *
+ * The DECLARE_...() macros generate exceptions with a `what` string
+ * composed of the name of the exception and the message. Building that
+ * string with a `std::string` means one allocation for the concatenation
+ * and another when the standard exception saves its own copy.
+ *
+ * This class concatenates the two strings in a buffer on the stack so
+ * only the standard exception allocates memory. Very long messages fall
+ * back to a `std::string`.
+ */
+class what_buffer
+{
+public:
+    what_buffer(std::string_view prefix, std::string_view what)
+    {
+        std::size_t const size(prefix.length() + what.length());
+        if(size < sizeof(f_buffer))
+        {
+            memcpy(f_buffer, prefix.data(), prefix.length());
+            memcpy(f_buffer + prefix.length(), what.data(), what.length());
+            f_buffer[size] = '\0';
+            f_what = f_buffer;
+        }
+        else
+        {
+            f_large.reserve(size);
+            f_large += prefix;
+            f_large += what;
+            f_what = f_large.c_str();
+        }
+    }
+
+    char const * c_str() const
+    {
+        return f_what;
+    }
+
+private:
+    char                f_buffer[256];
+    std::string         f_large = std::string();
+    char const *        f_what = nullptr;
+};
+
+
 
 
 } // no name namespace
@@ -226,6 +291,85 @@ void set_collect_stack(collect_stack_t collect_stack)
 }
 
 
+/** \brief Check whether exceptions with a cause reuse its stack trace.
+ *
+ * \return true if exceptions created with a cause skip collecting their
+ * own stack trace when the cause already has one.
+ *
+ * \sa set_reuse_cause_stack()
+ */
+bool get_reuse_cause_stack()
+{
+    return g_reuse_cause_stack;
+}
+
+
+/** \brief Set whether exceptions with a cause reuse its stack trace.
+ *
+ * When a low level exception gets wrapped in a higher level exception,
+ * the stack trace of the low level exception is generally the one of
+ * interest. Collecting a new stack trace for the wrapper doubles the
+ * cost for little gain since the two traces share most of their frames.
+ *
+ * By default (\p reuse is true), an exception created with a cause does
+ * not collect a stack trace if one of the exceptions in the chain of
+ * causes already has one. Use get_root_stack_trace() to retrieve it.
+ *
+ * Set \p reuse to false to always collect a new stack trace.
+ *
+ * \warning
+ * Like set_collect_stack(), this function is not multithread safe.
+ * Call it before you create threads.
+ *
+ * \param[in] reuse  Whether to reuse the stack trace of the cause.
+ */
+void set_reuse_cause_stack(bool reuse)
+{
+    g_reuse_cause_stack = reuse;
+}
+
+
+/** \brief Get the chain of exceptions starting with \p e.
+ *
+ * This function returns \p e followed by its cause, the cause of
+ * its cause, etc. The chain ends with the first exception which is
+ * not derived from exception_base_t or which has no cause.
+ *
+ * The pointers remain valid as long as \p e exists since each
+ * exception holds a reference to its cause.
+ *
+ * \code
+ *     catch(libexcept::exception_t const & e)
+ *     {
+ *         for(auto const * c : libexcept::get_exception_chain(e))
+ *         {
+ *             std::cerr << "  caused by: " << c->what() << "\n";
+ *         }
+ *     }
+ * \endcode
+ *
+ * \param[in] e  The exception to start with.
+ *
+ * \return The list of exceptions in the chain, starting with \p e.
+ */
+exception_chain_t get_exception_chain(std::exception const & e)
+{
+    exception_chain_t chain;
+    std::exception const * c(&e);
+    while(c != nullptr)
+    {
+        chain.push_back(c);
+        exception_base_t const * base(dynamic_cast<exception_base_t const *>(c));
+        if(base == nullptr)
+        {
+            break;
+        }
+        c = base->get_cause_exception();
+    }
+    return chain;
+}
+
+
 
 
 
@@ -251,12 +395,38 @@ void set_collect_stack(collect_stack_t collect_stack)
  */
 
 
-/** \var stack_trace_t libexcept::exception_base_t::f_stack_trace
- * \brief The variable where the exception stack trace gets saved.
+/** \brief The data attached to an exception.
+ *
+ * The stack trace and the parameters of an exception are saved in this
+ * payload. The exception holds a shared pointer to it so copying an
+ * exception (which happens when throwing by value, catching by value,
+ * or saving an `std::exception_ptr`) only increments a reference
+ * counter instead of duplicating a list of strings and a map.
  *
- * This parameter holds the vector of strings representing the stack
- * trace at the time an exception was raised and an instance of
- * the exception_base_t class was created.
+ * The payload is considered immutable once shared. The set_parameter()
+ * function makes a private copy first if another exception still
+ * references it (copy-on-write).
+ */
+struct exception_base_t::payload_t
+{
+    parameter_t                 f_parameters = parameter_t();
+    stack_trace_t               f_stack_trace = stack_trace_t();
+    std::exception_ptr          f_cause = std::exception_ptr();
+    std::exception const *      f_cause_exception = nullptr;
+};
+
+
+/** \var exception_base_t::payload_pointer_t libexcept::exception_base_t::f_payload
+ * \brief The variable where the exception stack trace and parameters are saved.
+ *
+ * This parameter holds a pointer to the payload with the vector of strings
+ * representing the stack trace at the time an exception was raised and
+ * the parameters added with set_parameter(). It also holds the cause
+ * of the exception, if any.
+ *
+ * The pointer remains null as long as the exception has neither a stack
+ * trace, a parameter, nor a cause. This way an exception created while the stack
+ * collection is turned off does not allocate a payload at all.
  */
 
 
@@ -286,6 +456,12 @@ void set_collect_stack(collect_stack_t collect_stack)
  * exceptions only in very exceptional cases and not on every single error
  * so the event should be rare in a normal run of our daemons.
  *
+ * A \p stack_trace_depth of 0 (or less) means no stack trace at all. In
+ * that case the constructor does not allocate anything.
+ *
+ * The exception_context guards active in this thread are saved in the
+ * parameters of the exception.
+ *
  * \param[in] stack_trace_depth  The number of lines to grab in our
  *                               stack trace.
  *
@@ -293,17 +469,116 @@ void set_collect_stack(collect_stack_t collect_stack)
  */
 exception_base_t::exception_base_t(int const stack_trace_depth)
 {
+    collect(stack_trace_depth);
+    add_context();
+}
+
+
+/** \brief Initialize an exception with a cause.
+ *
+ * This constructor attaches \p cause to the new exception. The cause is
+ * shared, not copied. Generally, you get it with std::current_exception()
+ * in a catch() block:
+ *
+ * \code
+ *     catch(io_error const &)
+ *     {
+ *         throw configuration_error("could not load settings", std::current_exception());
+ *     }
+ * \endcode
+ *
+ * If get_reuse_cause_stack() returns true (the default) and one of the
+ * exceptions in the chain of causes already has a stack trace, then no
+ * new stack trace gets collected. Use get_root_stack_trace() to access
+ * the stack trace of the cause.
+ *
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ *
+ * \sa set_cause()
+ */
+exception_base_t::exception_base_t(std::exception_ptr cause, int const stack_trace_depth)
+{
+    set_cause(cause);
+    if(!get_reuse_cause_stack()
+    || get_root_stack_trace().empty())
+    {
+        collect(stack_trace_depth);
+    }
+    add_context();
+}
+
+
+/** \brief Save the context of this thread in the parameters.
+ *
+ * This function copies the name and value of each exception_context
+ * guard active in the current thread to the parameters of this
+ * exception. When a name appears more than once, the innermost
+ * context wins.
+ *
+ * When no context is active, nothing gets allocated.
+ */
+void exception_base_t::add_context()
+{
+    exception_context const * context(get_exception_context());
+    if(context == nullptr)
+    {
+        return;
+    }
+
+    if(f_payload == nullptr)
+    {
+        f_payload = std::make_shared<payload_t>();
+    }
+
+    for(; context != nullptr; context = context->get_previous())
+    {
+        if(context->get_name() != nullptr
+        && context->get_value() != nullptr)
+        {
+            f_payload->f_parameters.emplace(context->get_name(), context->get_value());
+        }
+    }
+}
+
+
+/** \brief Collect the stack trace of this exception.
+ *
+ * This function collects the stack trace as defined by the
+ * get_collect_stack() flag and saves it in the payload.
+ *
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+void exception_base_t::collect(int const stack_trace_depth)
+{
+    if(stack_trace_depth <= 0)
+    {
+        // no trace requested, avoid allocating an empty payload
+        //
+        return;
+    }
+
     switch(get_collect_stack())
     {
     case collect_stack_t::COLLECT_STACK_NO:
         break;
 
     case collect_stack_t::COLLECT_STACK_YES:
-        f_stack_trace = collect_stack_trace(stack_trace_depth);
+        if(f_payload == nullptr)
+        {
+            f_payload = std::make_shared<payload_t>();
+        }
+        f_payload->f_stack_trace = collect_stack_trace(stack_trace_depth);
         break;
 
     case collect_stack_t::COLLECT_STACK_COMPLETE:
-        f_stack_trace = collect_stack_trace_with_line_numbers(stack_trace_depth);
+        if(f_payload == nullptr)
+        {
+            f_payload = std::make_shared<payload_t>();
+        }
+        f_payload->f_stack_trace = collect_stack_trace_with_line_numbers(stack_trace_depth);
         break;
 
     }
@@ -318,6 +593,26 @@ exception_base_t::exception_base_t(int const stack_trace_depth)
  */
 
 
+/** \fn exception_base_t::exception_base_t(exception_base_t const & rhs)
+ * \brief Copy an exception.
+ *
+ * The copy shares the payload (stack trace and parameters) of \p rhs.
+ * The cost is one atomic increment of the payload reference counter.
+ *
+ * \param[in] rhs  The exception to copy.
+ */
+
+
+/** \fn exception_base_t::exception_base_t(exception_base_t && rhs)
+ * \brief Move an exception.
+ *
+ * The payload of \p rhs is transferred to the new exception. This
+ * function never throws.
+ *
+ * \param[in] rhs  The exception to move.
+ */
+
+
 /** \brief Retrieve the set of exception parameters.
  *
  * This function returns a reference to all the parameters found in this
@@ -328,7 +623,13 @@ exception_base_t::exception_base_t(int const stack_trace_depth)
  */
 parameter_t const & exception_base_t::get_parameters() const
 {
-    return f_parameters;
+    if(f_payload == nullptr)
+    {
+        static parameter_t const g_empty_parameters = parameter_t();
+        return g_empty_parameters;
+    }
+
+    return f_payload->f_parameters;
 }
 
 
@@ -345,8 +646,13 @@ parameter_t const & exception_base_t::get_parameters() const
  */
 std::string exception_base_t::get_parameter(std::string const & name) const
 {
-    auto const it(f_parameters.find(name));
-    if(it == f_parameters.end())
+    if(f_payload == nullptr)
+    {
+        return std::string();
+    }
+
+    auto const it(f_payload->f_parameters.find(name));
+    if(it == f_payload->f_parameters.end())
     {
         return std::string();
     }
@@ -373,6 +679,11 @@ std::string exception_base_t::get_parameter(std::string const & name) const
  * parameter is considered invalid. At the moment, an empty string is
  * considered invalid.
  *
+ * \note
+ * The payload of an exception is shared between copies. If another copy
+ * still references it, this function first duplicates the payload so
+ * the other copies do not see the new parameter.
+ *
  * \param[in] name  The name of the parameter. It cannot be empty.
  * \param[in] value  The value of this parameter.
  *
@@ -382,19 +693,159 @@ exception_base_t & exception_base_t::set_parameter(std::string const & name, std
 {
     if(!name.empty())
     {
-        f_parameters[name] = value;
+        if(f_payload == nullptr)
+        {
+            f_payload = std::make_shared<payload_t>();
+        }
+        else if(f_payload.use_count() > 1)
+        {
+            f_payload = std::make_shared<payload_t>(*f_payload);
+        }
+        f_payload->f_parameters[name] = value;
     }
 
     return *this;
 }
 
 
-/** \fn exception_base_t::get_stack_trace()
- * \brief Retrieve the stack trace.
+/** \brief Retrieve the stack trace.
  *
  * This function retreives a reference to the vector of strings representing
  * the stack trace at the time the exception was raised.
+ *
+ * \return A reference to the stack trace, possibly empty.
  */
+stack_trace_t const & exception_base_t::get_stack_trace() const
+{
+    if(f_payload == nullptr)
+    {
+        static stack_trace_t const g_empty_stack_trace = stack_trace_t();
+        return g_empty_stack_trace;
+    }
+
+    return f_payload->f_stack_trace;
+}
+
+
+/** \brief Retrieve the stack trace of the root cause.
+ *
+ * This function returns the stack trace of the deepest exception in the
+ * chain of causes which has one. If none of the causes has a stack trace,
+ * the stack trace of this exception is returned.
+ *
+ * Note that an exception created with a cause which already has a
+ * stack trace does not collect its own (see set_reuse_cause_stack())
+ * so this is the function to use to display the trace of such
+ * exceptions.
+ *
+ * \return A reference to the root stack trace, possibly empty.
+ */
+stack_trace_t const & exception_base_t::get_root_stack_trace() const
+{
+    exception_base_t const * root(this);
+    for(exception_base_t const * e(this); e != nullptr; )
+    {
+        if(!e->get_stack_trace().empty())
+        {
+            root = e;
+        }
+        e = dynamic_cast<exception_base_t const *>(e->get_cause_exception());
+    }
+    return root->get_stack_trace();
+}
+
+
+/** \brief Retrieve the cause of this exception.
+ *
+ * \return A pointer to the cause of this exception or a null pointer.
+ *
+ * \sa set_cause()
+ */
+std::exception_ptr exception_base_t::get_cause() const
+{
+    if(f_payload == nullptr)
+    {
+        return std::exception_ptr();
+    }
+
+    return f_payload->f_cause;
+}
+
+
+/** \brief Retrieve the cause of this exception as a standard exception.
+ *
+ * This function gives direct access to the cause without having to
+ * rethrow it. If the cause is not derived from std::exception, then
+ * this function returns a null pointer.
+ *
+ * The pointer remains valid as long as this exception (or a copy of it)
+ * exists.
+ *
+ * \return The cause of this exception or nullptr.
+ *
+ * \sa get_exception_chain()
+ */
+std::exception const * exception_base_t::get_cause_exception() const
+{
+    if(f_payload == nullptr)
+    {
+        return nullptr;
+    }
+
+    return f_payload->f_cause_exception;
+}
+
+
+/** \brief Attach a cause to this exception.
+ *
+ * The cause is saved as an std::exception_ptr which means it is shared
+ * and not copied. Its stack trace, parameters and own cause remain
+ * available through get_cause_exception() and get_exception_chain().
+ *
+ * The cause gets rethrown once here to retrieve a pointer to the
+ * std::exception object. This avoids a rethrow each time the chain
+ * is walked.
+ *
+ * \param[in] cause  The exception which caused this exception.
+ *
+ * \return A reference to this exception.
+ */
+exception_base_t & exception_base_t::set_cause(std::exception_ptr cause)
+{
+    if(cause == nullptr
+    && get_cause() == nullptr)
+    {
+        return *this;
+    }
+
+    if(f_payload == nullptr)
+    {
+        f_payload = std::make_shared<payload_t>();
+    }
+    else if(f_payload.use_count() > 1)
+    {
+        f_payload = std::make_shared<payload_t>(*f_payload);
+    }
+
+    f_payload->f_cause = cause;
+    f_payload->f_cause_exception = nullptr;
+    if(cause != nullptr)
+    {
+        try
+        {
+            std::rethrow_exception(cause);
+        }
+        catch(std::exception const & e)
+        {
+            f_payload->f_cause_exception = &e;
+        }
+        catch(...)
+        {
+        }
+    }
+
+    return *this;
+}
 
 
 
@@ -417,6 +868,7 @@ logic_exception_t::logic_exception_t(
     : std::logic_error(what.c_str())
     , exception_base_t(stack_trace_depth)
 {
+    record_exception(*this);
 }
 
 
@@ -447,6 +899,110 @@ logic_exception_t::logic_exception_t(
     : std::logic_error(what)
     , exception_base_t(stack_trace_depth)
 {
+    record_exception(*this);
+}
+
+
+/** \brief Initialize a logic exception from a string view.
+ *
+ * This function initializes an exception setting its 'what' string to
+ * the specified \p what parameter. The string does not need to be
+ * NUL terminated.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+logic_exception_t::logic_exception_t(
+          std::string_view what
+        , int const stack_trace_depth)
+    : logic_exception_t(std::string_view(), what, stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize a logic exception from a prefix and a message.
+ *
+ * The 'what' string of the exception is set to \p prefix followed by
+ * \p what. The concatenation happens in a buffer on the stack so the
+ * only allocation is the copy saved by the standard exception.
+ *
+ * This is the constructor used by the DECLARE_...() macros where the
+ * prefix is the name of the exception followed by ": ".
+ *
+ * \param[in] prefix  The string to prepend to \p what.
+ * \param[in] what  The message of the exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+logic_exception_t::logic_exception_t(
+          std::string_view prefix
+        , std::string_view what
+        , int const stack_trace_depth)
+    : logic_exception_t(what_buffer(prefix, what).c_str(), stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize a logic exception with a cause.
+ *
+ * This function initializes an exception setting its 'what' string to
+ * \p what and attaching \p cause to it. See the exception_base_t
+ * constructor for details about the stack trace.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+logic_exception_t::logic_exception_t(
+          std::string_view what
+        , std::exception_ptr cause
+        , int const stack_trace_depth)
+    : logic_exception_t(std::string_view(), what, cause, stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize a logic exception from a prefix, a message and a cause.
+ *
+ * This is the constructor used by the DECLARE_...() macros to create
+ * an exception wrapping another one.
+ *
+ * \param[in] prefix  The string to prepend to \p what.
+ * \param[in] what  The message of the exception.
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+logic_exception_t::logic_exception_t(
+          std::string_view prefix
+        , std::string_view what
+        , std::exception_ptr cause
+        , int const stack_trace_depth)
+    : std::logic_error(what_buffer(prefix, what).c_str())
+    , exception_base_t(cause, stack_trace_depth)
+{
+    record_exception(*this);
+}
+
+
+/** \brief Initialize a logic exception from an existing payload.
+ *
+ * This constructor is used to promote an error (see error_result_t) to an
+ * exception. The stack trace and parameters of \p base are shared with
+ * the new exception, not copied, and no new stack trace is collected.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] base  The object with the payload to share.
+ */
+logic_exception_t::logic_exception_t(
+          std::string const & what
+        , exception_base_t const & base)
+    : std::logic_error(what.c_str())
+    , exception_base_t(base)
+{
+    record_exception(*this);
 }
 
 
@@ -497,6 +1053,7 @@ out_of_range_t::out_of_range_t(
     : std::out_of_range(what.c_str())
     , exception_base_t(stack_trace_depth)
 {
+    record_exception(*this);
 }
 
 
@@ -526,10 +1083,114 @@ out_of_range_t::out_of_range_t(
         , int const stack_trace_depth)
     : std::out_of_range(what)
     , exception_base_t(stack_trace_depth)
+{
+    record_exception(*this);
+}
+
+
+/** \brief Initialize an out of range exception from a string view.
+ *
+ * This function initializes an exception setting its 'what' string to
+ * the specified \p what parameter. The string does not need to be
+ * NUL terminated.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+out_of_range_t::out_of_range_t(
+          std::string_view what
+        , int const stack_trace_depth)
+    : out_of_range_t(std::string_view(), what, stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize an out of range exception from a prefix and a message.
+ *
+ * The 'what' string of the exception is set to \p prefix followed by
+ * \p what. The concatenation happens in a buffer on the stack so the
+ * only allocation is the copy saved by the standard exception.
+ *
+ * This is the constructor used by the DECLARE_...() macros where the
+ * prefix is the name of the exception followed by ": ".
+ *
+ * \param[in] prefix  The string to prepend to \p what.
+ * \param[in] what  The message of the exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+out_of_range_t::out_of_range_t(
+          std::string_view prefix
+        , std::string_view what
+        , int const stack_trace_depth)
+    : out_of_range_t(what_buffer(prefix, what).c_str(), stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize an out of range exception with a cause.
+ *
+ * This function initializes an exception setting its 'what' string to
+ * \p what and attaching \p cause to it. See the exception_base_t
+ * constructor for details about the stack trace.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+out_of_range_t::out_of_range_t(
+          std::string_view what
+        , std::exception_ptr cause
+        , int const stack_trace_depth)
+    : out_of_range_t(std::string_view(), what, cause, stack_trace_depth)
 {
 }
 
 
+/** \brief Initialize an out of range exception from a prefix, a message and a cause.
+ *
+ * This is the constructor used by the DECLARE_...() macros to create
+ * an exception wrapping another one.
+ *
+ * \param[in] prefix  The string to prepend to \p what.
+ * \param[in] what  The message of the exception.
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+out_of_range_t::out_of_range_t(
+          std::string_view prefix
+        , std::string_view what
+        , std::exception_ptr cause
+        , int const stack_trace_depth)
+    : std::out_of_range(what_buffer(prefix, what).c_str())
+    , exception_base_t(cause, stack_trace_depth)
+{
+    record_exception(*this);
+}
+
+
+/** \brief Initialize an out of range exception from an existing payload.
+ *
+ * This constructor is used to promote an error (see error_result_t) to an
+ * exception. The stack trace and parameters of \p base are shared with
+ * the new exception, not copied, and no new stack trace is collected.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] base  The object with the payload to share.
+ */
+out_of_range_t::out_of_range_t(
+          std::string const & what
+        , exception_base_t const & base)
+    : std::out_of_range(what.c_str())
+    , exception_base_t(base)
+{
+    record_exception(*this);
+}
+
+
 /** \brief Retrieve the `what` parameter as passed to the constructor.
  *
  * This function returns the `what` description of the exception when the
@@ -572,6 +1233,7 @@ exception_t::exception_t(
     : std::runtime_error(what.c_str())
     , exception_base_t(stack_trace_depth)
 {
+    record_exception(*this);
 }
 
 
@@ -598,6 +1260,110 @@ exception_t::exception_t(
     : std::runtime_error(what)
     , exception_base_t(stack_trace_depth)
 {
+    record_exception(*this);
+}
+
+
+/** \brief Initialize an exception from a string view.
+ *
+ * This function initializes an exception setting its 'what' string to
+ * the specified \p what parameter. The string does not need to be
+ * NUL terminated.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+exception_t::exception_t(
+          std::string_view what
+        , int const stack_trace_depth)
+    : exception_t(std::string_view(), what, stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize an exception from a prefix and a message.
+ *
+ * The 'what' string of the exception is set to \p prefix followed by
+ * \p what. The concatenation happens in a buffer on the stack so the
+ * only allocation is the copy saved by the standard exception.
+ *
+ * This is the constructor used by the DECLARE_...() macros where the
+ * prefix is the name of the exception followed by ": ".
+ *
+ * \param[in] prefix  The string to prepend to \p what.
+ * \param[in] what  The message of the exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+exception_t::exception_t(
+          std::string_view prefix
+        , std::string_view what
+        , int const stack_trace_depth)
+    : exception_t(what_buffer(prefix, what).c_str(), stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize an exception with a cause.
+ *
+ * This function initializes an exception setting its 'what' string to
+ * \p what and attaching \p cause to it. See the exception_base_t
+ * constructor for details about the stack trace.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+exception_t::exception_t(
+          std::string_view what
+        , std::exception_ptr cause
+        , int const stack_trace_depth)
+    : exception_t(std::string_view(), what, cause, stack_trace_depth)
+{
+}
+
+
+/** \brief Initialize an exception from a prefix, a message and a cause.
+ *
+ * This is the constructor used by the DECLARE_...() macros to create
+ * an exception wrapping another one.
+ *
+ * \param[in] prefix  The string to prepend to \p what.
+ * \param[in] what  The message of the exception.
+ * \param[in] cause  The exception which caused this exception.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+exception_t::exception_t(
+          std::string_view prefix
+        , std::string_view what
+        , std::exception_ptr cause
+        , int const stack_trace_depth)
+    : std::runtime_error(what_buffer(prefix, what).c_str())
+    , exception_base_t(cause, stack_trace_depth)
+{
+    record_exception(*this);
+}
+
+
+/** \brief Initialize an exception from an existing payload.
+ *
+ * This constructor is used to promote an error (see error_result_t) to an
+ * exception. The stack trace and parameters of \p base are shared with
+ * the new exception, not copied, and no new stack trace is collected.
+ *
+ * \param[in] what  The string used to initialize the exception what parameter.
+ * \param[in] base  The object with the payload to share.
+ */
+exception_t::exception_t(
+          std::string const & what
+        , exception_base_t const & base)
+    : std::runtime_error(what.c_str())
+    , exception_base_t(base)
+{
+    record_exception(*this);
 }
 
 
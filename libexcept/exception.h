@@ -20,14 +20,21 @@
 
 // self
 //
+#include    <libexcept/recent_exceptions.h>
 #include    <libexcept/stack_trace.h>
 
 
 // C++ includes
 //
+#include    <exception>
 #include    <map>
+#include    <memory>
 #include    <stdexcept>
 #include    <string>
+#include    <string_view>
+#include    <type_traits>
+#include    <typeinfo>
+#include    <utility>
 #include    <vector>
 
 
@@ -55,28 +62,48 @@ enum class collect_stack_t
 
 
 typedef std::map<std::string, std::string>  parameter_t;
+typedef std::vector<std::exception const *> exception_chain_t;
 
 
 collect_stack_t     get_collect_stack();
 void                set_collect_stack(collect_stack_t collect_stack);
+bool                get_reuse_cause_stack();
+void                set_reuse_cause_stack(bool reuse);
+exception_chain_t   get_exception_chain(std::exception const & e);
 
 
 class exception_base_t
 {
 public:
     explicit                    exception_base_t(int const stack_trace_depth = STACK_TRACE_DEPTH);
+    explicit                    exception_base_t(std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                exception_base_t(exception_base_t const & rhs) = default;
+                                exception_base_t(exception_base_t && rhs) noexcept = default;
 
     virtual                     ~exception_base_t() {}
 
+    exception_base_t &          operator = (exception_base_t const & rhs) = default;
+    exception_base_t &          operator = (exception_base_t && rhs) noexcept = default;
+
     parameter_t const &         get_parameters() const;
     std::string                 get_parameter(std::string const & name) const;
     exception_base_t &          set_parameter(std::string const & name, std::string const & value);
 
-    stack_trace_t const &       get_stack_trace() const { return f_stack_trace; }
+    stack_trace_t const &       get_stack_trace() const;
+    stack_trace_t const &       get_root_stack_trace() const;
+
+    std::exception_ptr          get_cause() const;
+    std::exception const *      get_cause_exception() const;
+    exception_base_t &          set_cause(std::exception_ptr cause);
 
 private:
-    parameter_t                 f_parameters = parameter_t();
-    stack_trace_t               f_stack_trace = stack_trace_t();
+    void                        add_context();
+    void                        collect(int const stack_trace_depth);
+
+    struct payload_t;
+    typedef std::shared_ptr<payload_t>  payload_pointer_t;
+
+    payload_pointer_t           f_payload = payload_pointer_t();
 };
 
 
@@ -87,9 +114,19 @@ class logic_exception_t
 public:
     explicit                    logic_exception_t(std::string const & what, int const stack_trace_depth = STACK_TRACE_DEPTH);
     explicit                    logic_exception_t(char const *        what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+    explicit                    logic_exception_t(std::string_view    what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                logic_exception_t(std::string_view prefix, std::string_view what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                logic_exception_t(std::string const & what, exception_base_t const & base);
+                                logic_exception_t(std::string_view what, std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                logic_exception_t(std::string_view prefix, std::string_view what, std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                logic_exception_t(logic_exception_t const & rhs) = default;
+                                logic_exception_t(logic_exception_t && rhs) noexcept = default;
 
     virtual                     ~logic_exception_t() override {}
 
+    logic_exception_t &         operator = (logic_exception_t const & rhs) = default;
+    logic_exception_t &         operator = (logic_exception_t && rhs) noexcept = default;
+
     virtual char const *        what() const throw() override;
 };
 
@@ -101,9 +138,19 @@ class out_of_range_t
 public:
     explicit                    out_of_range_t(std::string const & what, int const stack_trace_depth = STACK_TRACE_DEPTH);
     explicit                    out_of_range_t(char const *        what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+    explicit                    out_of_range_t(std::string_view    what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                out_of_range_t(std::string_view prefix, std::string_view what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                out_of_range_t(std::string const & what, exception_base_t const & base);
+                                out_of_range_t(std::string_view what, std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                out_of_range_t(std::string_view prefix, std::string_view what, std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                out_of_range_t(out_of_range_t const & rhs) = default;
+                                out_of_range_t(out_of_range_t && rhs) noexcept = default;
 
     virtual                     ~out_of_range_t() override {}
 
+    out_of_range_t &            operator = (out_of_range_t const & rhs) = default;
+    out_of_range_t &            operator = (out_of_range_t && rhs) noexcept = default;
+
     virtual char const *        what() const throw() override;
 };
 
@@ -115,28 +162,75 @@ class exception_t
 public:
     explicit                    exception_t(std::string const & what, int const stack_trace_depth = STACK_TRACE_DEPTH);
     explicit                    exception_t(char const *        what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+    explicit                    exception_t(std::string_view    what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                exception_t(std::string_view prefix, std::string_view what, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                exception_t(std::string const & what, exception_base_t const & base);
+                                exception_t(std::string_view what, std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                exception_t(std::string_view prefix, std::string_view what, std::exception_ptr cause, int const stack_trace_depth = STACK_TRACE_DEPTH);
+                                exception_t(exception_t const & rhs) = default;
+                                exception_t(exception_t && rhs) noexcept = default;
 
     virtual                     ~exception_t() override {}
 
+    exception_t &               operator = (exception_t const & rhs) = default;
+    exception_t &               operator = (exception_t && rhs) noexcept = default;
+
     virtual char const *        what() const throw() override;
 };
 
 
+// the DECLARE_EXCEPTION() classes derive from this template which forwards
+// its parameters to the base constructor, so any base works (i.e. one with
+// just a `std::string const &` constructor); the constructor body then
+// fixes the type recorded by record_exception() since at that point the
+// object does not yet have its final type (typeid() would return this
+// template)
+//
+template<typename B, typename D>
+class declared_exception_t
+    : public B
+{
+public:
+    template<typename ... ARGS>
+    explicit                    declared_exception_t(ARGS && ... args)
+                                    : B(std::forward<ARGS>(args)...)
+                                {
+                                    if constexpr(std::is_convertible_v<B *, std::exception const *>)
+                                    {
+                                        record_exception_type(*this, typeid(D));
+                                    }
+                                }
+};
+
+
 #define DECLARE_LOGIC_ERROR(name)                                       \
     class name : public ::libexcept::logic_exception_t {                \
-    public: name(std::string const & msg) : logic_exception_t(#name ": " + msg) {} }
+    public: static constexpr std::string_view prefix() { return #name ": "; } \
+    name(std::string_view msg, int const stack_trace_depth = ::libexcept::STACK_TRACE_DEPTH) \
+        : logic_exception_t(prefix(), msg, stack_trace_depth) { ::libexcept::record_exception_type(*this); } \
+    name(std::string_view msg, std::exception_ptr cause, int const stack_trace_depth = ::libexcept::STACK_TRACE_DEPTH) \
+        : logic_exception_t(prefix(), msg, cause, stack_trace_depth) { ::libexcept::record_exception_type(*this); } }
 
 #define DECLARE_OUT_OF_RANGE(name)                                      \
     class name : public ::libexcept::out_of_range_t {                   \
-    public: name(std::string const & msg) : out_of_range_t(#name ": " + msg) {} }
+    public: static constexpr std::string_view prefix() { return #name ": "; } \
+    name(std::string_view msg, int const stack_trace_depth = ::libexcept::STACK_TRACE_DEPTH) \
+        : out_of_range_t(prefix(), msg, stack_trace_depth) { ::libexcept::record_exception_type(*this); } \
+    name(std::string_view msg, std::exception_ptr cause, int const stack_trace_depth = ::libexcept::STACK_TRACE_DEPTH) \
+        : out_of_range_t(prefix(), msg, cause, stack_trace_depth) { ::libexcept::record_exception_type(*this); } }
 
 #define DECLARE_MAIN_EXCEPTION(name)                                    \
     class name : public ::libexcept::exception_t {                      \
-    public: name(std::string const & msg) : exception_t(#name ": " + msg) {} }
+    public: static constexpr std::string_view prefix() { return #name ": "; } \
+    name(std::string_view msg, int const stack_trace_depth = ::libexcept::STACK_TRACE_DEPTH) \
+        : exception_t(prefix(), msg, stack_trace_depth) { ::libexcept::record_exception_type(*this); } \
+    name(std::string_view msg, std::exception_ptr cause, int const stack_trace_depth = ::libexcept::STACK_TRACE_DEPTH) \
+        : exception_t(prefix(), msg, cause, stack_trace_depth) { ::libexcept::record_exception_type(*this); } }
 
 #define DECLARE_EXCEPTION(base, name)                                   \
-    class name : public base {                                          \
-    public: name(std::string const & msg) : base(msg) {} }
+    class name : public ::libexcept::declared_exception_t<base, name> { \
+    public: typedef ::libexcept::declared_exception_t<base, name> declared_exception_base_t; \
+    using declared_exception_base_t::declared_exception_base_t; }
 
 
 // a default logic error where I know there is a problem that needs to be
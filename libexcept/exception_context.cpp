@@ -0,0 +1,169 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/exception_context.h"
+
+
+/** \file
+ * \brief Implementation of the scoped exception context.
+ *
+ * The context of an error is often known several frames above the
+ * location where the exception gets raised. For example, a server knows
+ * the request identifier and a parser knows the name of the file being
+ * parsed. Adding that information to the exception means catching it,
+ * calling set_parameter(), and rethrowing it, which costs another unwind.
+ *
+ * Instead, create an exception_context guard on the stack:
+ *
+ * \code
+ *     void process_request(request const & r)
+ *     {
+ *         libexcept::exception_context request_context("request_id", r.id());
+ *         ...
+ *     }
+ * \endcode
+ *
+ * Any libexcept exception created while the guard exists gets a
+ * "request_id" parameter automatically.
+ *
+ * The guards form a linked list on the stack of each thread. Creating
+ * and destroying a guard only saves and restores one thread local
+ * pointer; the strings are not copied until an exception gets created.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The innermost context of this thread.
+ *
+ * This is the top of the linked list of exception_context guards
+ * which exist in this thread.
+ */
+thread_local exception_context *    g_exception_context = nullptr;
+
+
+
+} // no name namespace
+
+
+
+/** \brief Push a context on this thread's stack.
+ *
+ * The \p name and \p value pointers are saved as is. They must remain
+ * valid until the guard gets destroyed.
+ *
+ * When the same name is used by several guards, the innermost one
+ * is used in the exception parameters.
+ *
+ * \param[in] name  The name of the parameter.
+ * \param[in] value  The value of the parameter.
+ */
+exception_context::exception_context(char const * name, char const * value)
+    : f_name(name)
+    , f_value(value)
+    , f_previous(g_exception_context)
+{
+    g_exception_context = this;
+}
+
+
+/** \brief Push a context on this thread's stack.
+ *
+ * This is a convenience constructor. The \p value string must not be
+ * modified or destroyed until the guard gets destroyed. The constructor
+ * taking a temporary string is deleted since that string would be
+ * destroyed before the guard.
+ *
+ * \param[in] name  The name of the parameter.
+ * \param[in] value  The value of the parameter.
+ */
+exception_context::exception_context(char const * name, std::string const & value)
+    : exception_context(name, value.c_str())
+{
+}
+
+
+/** \brief Pop this context from this thread's stack.
+ *
+ * The guards are expected to be destroyed in the reverse order of
+ * their creation, which is always the case for variables on the stack.
+ */
+exception_context::~exception_context()
+{
+    g_exception_context = f_previous;
+}
+
+
+/** \brief Get the name of this context.
+ *
+ * \return The name of the parameter.
+ */
+char const * exception_context::get_name() const
+{
+    return f_name;
+}
+
+
+/** \brief Get the value of this context.
+ *
+ * \return The value of the parameter.
+ */
+char const * exception_context::get_value() const
+{
+    return f_value;
+}
+
+
+/** \brief Get the context which was active before this one.
+ *
+ * \return The previous context or nullptr.
+ */
+exception_context const * exception_context::get_previous() const
+{
+    return f_previous;
+}
+
+
+/** \brief Get the innermost context of this thread.
+ *
+ * Use the get_previous() function to walk the other contexts.
+ *
+ * \return The innermost context or nullptr.
+ */
+exception_context const * get_exception_context()
+{
+    return g_exception_context;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,67 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// C++
+//
+#include    <string>
+
+
+
+/** \file
+ * \brief Declarations of the scoped exception context.
+ *
+ * This file defines a guard used to attach context information (i.e.
+ * a request identifier, a filename...) to all the libexcept exceptions
+ * created while the guard exists.
+ */
+
+
+namespace libexcept
+{
+
+
+class exception_context
+{
+public:
+                                exception_context(char const * name, char const * value);
+                                exception_context(char const * name, std::string const & value);
+                                exception_context(char const * name, std::string && value) = delete;
+                                exception_context(exception_context const &) = delete;
+                                ~exception_context();
+
+    exception_context &         operator = (exception_context const &) = delete;
+
+    char const *                get_name() const;
+    char const *                get_value() const;
+    exception_context const *   get_previous() const;
+
+private:
+    char const *                f_name = nullptr;
+    char const *                f_value = nullptr;
+    exception_context *         f_previous = nullptr;
+};
+
+
+exception_context const *       get_exception_context();
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,143 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/expected.h"
+
+
+/** \file
+ * \brief Implementation of the error object used by expected.
+ *
+ * The expected template is fully defined in the header. This file
+ * implements the error_result_t class which is the default error type of
+ * an expected result.
+ *
+ * A function returning an expected result does not throw:
+ *
+ * \code
+ *     libexcept::expected<int> parse_port(std::string const & s)
+ *     {
+ *         ...
+ *         if(port > 65535)
+ *         {
+ *             libexcept::error_result_t e("port out of range", libexcept::error_kind_t::ERROR_KIND_OUT_OF_RANGE);
+ *             e.set_parameter("port", s);
+ *             return e;
+ *         }
+ *         return port;
+ *     }
+ * \endcode
+ *
+ * The caller checks the result and either handles the error or calls
+ * value() which throws the matching libexcept exception with the same
+ * parameters and stack trace.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+/** \brief Initialize an error.
+ *
+ * The error holds a message and the kind of exception it gets promoted
+ * to when raised.
+ *
+ * By default, no stack trace is collected since the purpose of an error
+ * is to be cheap. Pass a positive \p stack_trace_depth to get one (the
+ * global set_collect_stack() flag still applies).
+ *
+ * \param[in] message  The error message, the `what()` of the exception
+ * once promoted.
+ * \param[in] kind  The kind of exception to raise.
+ * \param[in] stack_trace_depth  The number of lines to grab in our
+ *                               stack trace.
+ */
+error_result_t::error_result_t(
+          std::string const & message
+        , error_kind_t kind
+        , int const stack_trace_depth)
+    : exception_base_t(stack_trace_depth)
+    , f_message(message)
+    , f_kind(kind)
+{
+}
+
+
+/** \brief Get the kind of error.
+ *
+ * \return The kind of exception raise() throws.
+ */
+error_kind_t error_result_t::get_kind() const
+{
+    return f_kind;
+}
+
+
+/** \brief Get the error message.
+ *
+ * \return The message of this error.
+ */
+std::string const & error_result_t::get_message() const
+{
+    return f_message;
+}
+
+
+/** \brief Promote the error to an exception.
+ *
+ * This function throws the libexcept exception matching the kind of
+ * this error. The exception shares the parameters and stack trace of
+ * the error; nothing gets copied and no new stack trace is collected.
+ *
+ * \exception exception_t
+ * Raised for ERROR_KIND_RUNTIME errors.
+ *
+ * \exception logic_exception_t
+ * Raised for ERROR_KIND_LOGIC errors.
+ *
+ * \exception out_of_range_t
+ * Raised for ERROR_KIND_OUT_OF_RANGE errors.
+ */
+void error_result_t::raise() const
+{
+    switch(f_kind)
+    {
+    case error_kind_t::ERROR_KIND_LOGIC:
+        throw logic_exception_t(f_message, *this);
+
+    case error_kind_t::ERROR_KIND_OUT_OF_RANGE:
+        throw out_of_range_t(f_message, *this);
+
+    case error_kind_t::ERROR_KIND_RUNTIME:
+        break;
+
+    }
+
+    throw exception_t(f_message, *this);
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
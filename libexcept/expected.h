@@ -0,0 +1,160 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/exception.h>
+
+
+// C++
+//
+#include    <optional>
+#include    <string>
+#include    <utility>
+#include    <variant>
+
+
+
+/** \file
+ * \brief Declarations of the expected result type.
+ *
+ * This file defines a result type which holds either a value or an
+ * error. The error has the same parameters and optional stack trace
+ * as the libexcept exceptions and it can be promoted to one of those
+ * exceptions when the caller decides to throw.
+ *
+ * This is useful in hot paths where throwing is too costly, while
+ * still sharing the same error model as the rest of the code.
+ */
+
+
+namespace libexcept
+{
+
+
+enum class error_kind_t
+{
+    ERROR_KIND_RUNTIME,         // promoted to exception_t
+    ERROR_KIND_LOGIC,           // promoted to logic_exception_t
+    ERROR_KIND_OUT_OF_RANGE,    // promoted to out_of_range_t
+};
+
+
+class error_result_t
+    : public exception_base_t
+{
+public:
+    explicit                    error_result_t(
+                                      std::string const & message
+                                    , error_kind_t kind = error_kind_t::ERROR_KIND_RUNTIME
+                                    , int const stack_trace_depth = 0);
+
+    error_kind_t                get_kind() const;
+    std::string const &         get_message() const;
+
+    [[noreturn]] void           raise() const;
+
+private:
+    std::string                 f_message = std::string();
+    error_kind_t                f_kind = error_kind_t::ERROR_KIND_RUNTIME;
+};
+
+
+template<typename T, typename E = error_result_t>
+class expected
+{
+public:
+    typedef T                   value_type;
+    typedef E                   error_type;
+
+                                expected(T const & value) : f_value(std::in_place_index<0>, value) {}
+                                expected(T && value) : f_value(std::in_place_index<0>, std::move(value)) {}
+                                expected(E const & error) : f_value(std::in_place_index<1>, error) {}
+                                expected(E && error) : f_value(std::in_place_index<1>, std::move(error)) {}
+
+    bool                        has_value() const { return f_value.index() == 0; }
+    explicit                    operator bool () const { return has_value(); }
+
+    T &                         value() & { check(); return std::get<0>(f_value); }
+    T const &                   value() const & { check(); return std::get<0>(f_value); }
+    T &&                        value() && { check(); return std::get<0>(std::move(f_value)); }
+
+    T &                         operator * () & { return std::get<0>(f_value); }
+    T const &                   operator * () const & { return std::get<0>(f_value); }
+    T *                         operator -> () { return &std::get<0>(f_value); }
+    T const *                   operator -> () const { return &std::get<0>(f_value); }
+
+    template<typename U>
+    T                           value_or(U && default_value) const &
+                                {
+                                    return has_value()
+                                            ? std::get<0>(f_value)
+                                            : static_cast<T>(std::forward<U>(default_value));
+                                }
+
+    E const &                   error() const & { return std::get<1>(f_value); }
+    E &                         error() & { return std::get<1>(f_value); }
+
+private:
+    void                        check() const
+                                {
+                                    if(!has_value())
+                                    {
+                                        std::get<1>(f_value).raise();
+                                    }
+                                }
+
+    std::variant<T, E>          f_value;
+};
+
+
+template<typename E>
+class expected<void, E>
+{
+public:
+    typedef void                value_type;
+    typedef E                   error_type;
+
+                                expected() {}
+                                expected(E const & error) : f_error(error) {}
+                                expected(E && error) : f_error(std::move(error)) {}
+
+    bool                        has_value() const { return !f_error.has_value(); }
+    explicit                    operator bool () const { return has_value(); }
+
+    void                        value() const
+                                {
+                                    if(f_error.has_value())
+                                    {
+                                        f_error->raise();
+                                    }
+                                }
+
+    E const &                   error() const & { return *f_error; }
+    E &                         error() & { return *f_error; }
+
+private:
+    std::optional<E>            f_error = std::optional<E>();
+};
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
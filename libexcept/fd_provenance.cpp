@@ -0,0 +1,305 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/fd_provenance.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstdint>
+#include    <memory>
+#include    <mutex>
+
+
+// C
+//
+#include    <execinfo.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the file descriptor provenance tracker.
+ *
+ * The verify_inherited_files() function tells you which descriptors
+ * leaked and where they point to, but not which code opened them.
+ *
+ * This file manages a table indexed by descriptor. Once
+ * set_track_fd_provenance() was called, each new descriptor gets the
+ * raw addresses of the stack which created it saved in that table.
+ *
+ * The C library functions creating and closing descriptors are replaced
+ * by the except_fd_provenance library (see fd_provenance_hooks.cpp).
+ * That library is opt-in: link your executable against it or load it
+ * with LD_PRELOAD. Without it, the table remains empty.
+ *
+ * Along the frames, the device and inode of the descriptor are saved.
+ * A descriptor closed and reused behind our back (i.e. with a direct
+ * system call) points to a different file, so its stale frames do not
+ * get reported.
+ *
+ * Only raw addresses are saved (no symbols, no allocation) so the
+ * overhead is acceptable in a canary deployment. Use get_fd_provenance()
+ * to get the symbols. The verify_inherited_files() function includes
+ * that trace in its warnings.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+struct slot_t
+{
+    std::atomic<std::uint32_t>  f_count = 0;
+    dev_t                       f_dev = 0;
+    ino_t                       f_ino = 0;
+    void *                      f_frames[FD_PROVENANCE_FRAMES] = {};
+};
+
+
+std::atomic<bool>               g_track_fd_provenance = false;
+std::atomic<slot_t *>           g_slots = nullptr;
+std::size_t                     g_slot_count = 0;
+std::mutex                      g_slots_mutex = std::mutex();
+thread_local bool               g_in_hook = false;
+
+
+
+} // no name namespace
+
+
+
+/** \brief Turn the file descriptor provenance tracker on or off.
+ *
+ * The first time the tracker gets turned on, a table of \p max_fds
+ * entries is allocated with mmap(). The pages only get used as
+ * descriptors are created. Later calls ignore \p max_fds.
+ *
+ * Descriptors larger or equal to \p max_fds are not tracked.
+ *
+ * \param[in] track  Whether to track the creation of file descriptors.
+ * \param[in] max_fds  The size of the table of descriptors.
+ */
+void set_track_fd_provenance(bool track, std::size_t max_fds)
+{
+    if(track)
+    {
+        std::lock_guard<std::mutex> lock(g_slots_mutex);
+        if(g_slots.load() == nullptr
+        && max_fds > 0)
+        {
+            // the first call to backtrace() loads libgcc, which opens
+            // files, do it now instead of inside a hook
+            //
+            void * frame;
+            backtrace(&frame, 1);
+
+            void * ptr(mmap(
+                      nullptr
+                    , max_fds * sizeof(slot_t)
+                    , PROT_READ | PROT_WRITE
+                    , MAP_PRIVATE | MAP_ANONYMOUS
+                    , -1
+                    , 0));
+            if(ptr == MAP_FAILED)
+            {
+                return;
+            }
+            g_slot_count = max_fds;
+            g_slots.store(static_cast<slot_t *>(ptr), std::memory_order_release);
+        }
+    }
+    g_track_fd_provenance.store(track, std::memory_order_relaxed);
+}
+
+
+/** \brief Check whether the creation of file descriptors is tracked.
+ *
+ * \return true if the tracker is on.
+ */
+bool get_track_fd_provenance()
+{
+    return g_track_fd_provenance.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Save the stack which created \p fd.
+ *
+ * The functions of the except_fd_provenance library call this function
+ * each time a new descriptor gets created. You can also call it if you
+ * create a descriptor in a way the library does not intercept (i.e. with
+ * a direct system call).
+ *
+ * Nothing happens unless the tracker was turned on with
+ * set_track_fd_provenance().
+ *
+ * \param[in] fd  The new file descriptor.
+ */
+void record_fd_provenance(int fd)
+{
+    if(fd < 0
+    || !g_track_fd_provenance.load(std::memory_order_relaxed)
+    || g_in_hook)
+    {
+        return;
+    }
+
+    slot_t * slots(g_slots.load(std::memory_order_acquire));
+    if(slots == nullptr
+    || static_cast<std::size_t>(fd) >= g_slot_count)
+    {
+        return;
+    }
+
+    g_in_hook = true;
+    slot_t & slot(slots[fd]);
+    slot.f_count.store(0, std::memory_order_relaxed);
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        g_in_hook = false;
+        return;
+    }
+    slot.f_dev = st.st_dev;
+    slot.f_ino = st.st_ino;
+    int const count(backtrace(slot.f_frames, FD_PROVENANCE_FRAMES));
+    slot.f_count.store(std::max(count, 0), std::memory_order_release);
+    g_in_hook = false;
+}
+
+
+/** \brief Get the raw frames of the stack which created \p fd.
+ *
+ * This function does not allocate memory.
+ *
+ * \param[in] fd  The file descriptor to check.
+ * \param[out] frames  The buffer receiving the frames.
+ * \param[in] size  The number of frames \p frames can hold.
+ *
+ * \return The number of frames saved in \p frames, 0 if \p fd is not
+ * known to the tracker.
+ */
+int get_fd_provenance_frames(int fd, void ** frames, int size)
+{
+    slot_t * slots(g_slots.load(std::memory_order_acquire));
+    if(slots == nullptr
+    || fd < 0
+    || static_cast<std::size_t>(fd) >= g_slot_count
+    || size <= 0)
+    {
+        return 0;
+    }
+
+    slot_t const & slot(slots[fd]);
+    int const count(std::min(static_cast<int>(slot.f_count.load(std::memory_order_acquire)), size));
+    if(count <= 0)
+    {
+        return 0;
+    }
+
+    // the descriptor may have been closed and reused without us knowing
+    //
+    struct stat st;
+    if(fstat(fd, &st) != 0
+    || st.st_dev != slot.f_dev
+    || st.st_ino != slot.f_ino)
+    {
+        return 0;
+    }
+
+    std::copy(slot.f_frames, slot.f_frames + count, frames);
+    return count;
+}
+
+
+/** \brief Forget the stacks of a range of descriptors.
+ *
+ * This function is called when descriptors get closed without going
+ * through close(), i.e. with the close_range() system call. It clears
+ * the entries of the descriptors from \p first to \p last inclusive.
+ *
+ * \param[in] first  The first descriptor to forget.
+ * \param[in] last  The last descriptor to forget.
+ */
+void clear_fd_provenance(unsigned int first, unsigned int last)
+{
+    slot_t * slots(g_slots.load(std::memory_order_acquire));
+    if(slots == nullptr
+    || first >= g_slot_count
+    || first > last)
+    {
+        return;
+    }
+
+    std::size_t const end(std::min<std::size_t>(last, g_slot_count - 1));
+    for(std::size_t fd(first); fd <= end; ++fd)
+    {
+        slots[fd].f_count.store(0, std::memory_order_release);
+    }
+}
+
+
+/** \brief Get the stack which created \p fd.
+ *
+ * This function converts the frames saved by the tracker to a stack
+ * trace the same way as collect_stack_trace() does.
+ *
+ * \param[in] fd  The file descriptor to check.
+ *
+ * \return The stack trace, empty if \p fd is not known to the tracker.
+ */
+stack_trace_t get_fd_provenance(int fd)
+{
+    stack_trace_t stack_trace;
+
+    void * frames[FD_PROVENANCE_FRAMES];
+    int const count(get_fd_provenance_frames(fd, frames, FD_PROVENANCE_FRAMES));
+    if(count > 0)
+    {
+        std::unique_ptr<char *, decltype(&::free)> stack_string_list(backtrace_symbols(frames, count), &::free);
+        if(stack_string_list != nullptr)
+        {
+            for(int idx(0); idx < count; ++idx)
+            {
+                stack_trace.push_back(stack_string_list.get()[idx]);
+            }
+        }
+    }
+
+    return stack_trace;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
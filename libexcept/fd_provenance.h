@@ -0,0 +1,67 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/stack_trace.h>
+
+
+// C++
+//
+#include    <cstddef>
+
+
+
+/** \file
+ * \brief Declarations of the file descriptor provenance tracker.
+ *
+ * This file defines the functions used to record the stack of the code
+ * which opened each file descriptor so leaks can be traced back to
+ * their origin.
+ *
+ * The recording only happens in processes linked against the
+ * except_fd_provenance library or running with it in LD_PRELOAD. That
+ * library replaces the C library functions creating descriptors. It is
+ * separate so linking against libexcept does not replace open(),
+ * close(), etc. in every process.
+ */
+
+
+namespace libexcept
+{
+
+
+constexpr std::size_t const     FD_PROVENANCE_DEFAULT_MAX_FDS = 65536;
+constexpr std::size_t const     FD_PROVENANCE_FRAMES = 16;
+
+
+void                            set_track_fd_provenance(
+                                          bool track
+                                        , std::size_t max_fds = FD_PROVENANCE_DEFAULT_MAX_FDS);
+bool                            get_track_fd_provenance();
+void                            record_fd_provenance(int fd);
+int                             get_fd_provenance_frames(int fd, void ** frames, int size);
+void                            clear_fd_provenance(unsigned int first, unsigned int last);
+stack_trace_t                   get_fd_provenance(int fd);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,495 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// the fortified headers define some of the functions we replace inline
+//
+#undef _FORTIFY_SOURCE
+
+
+// self
+//
+#include    "libexcept/fd_provenance.h"
+
+
+// C++
+//
+#include    <cstdarg>
+#include    <cstring>
+
+
+// C
+//
+#include    <dlfcn.h>
+#include    <fcntl.h>
+#include    <stdlib.h>
+#include    <sys/epoll.h>
+#include    <sys/eventfd.h>
+#include    <sys/inotify.h>
+#include    <sys/mman.h>
+#include    <sys/signalfd.h>
+#include    <sys/socket.h>
+#include    <sys/timerfd.h>
+#include    <sys/uio.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Replacements of the C library functions creating descriptors.
+ *
+ * This file is compiled in its own library, except_fd_provenance, so the
+ * C library functions only get replaced in processes which ask for it,
+ * either by linking against that library or by loading it with
+ * LD_PRELOAD:
+ *
+ * \code
+ *     LD_PRELOAD=libexcept_fd_provenance.so my-daemon
+ * \endcode
+ *
+ * The replaced functions are open(), openat(), creat(), socket(),
+ * socketpair(), accept(), accept4(), recvmsg() with SCM_RIGHTS, pipe(),
+ * pipe2(), dup(), dup2(), dup3(), fcntl() with F_DUPFD, eventfd(),
+ * epoll_create(), epoll_create1(), memfd_create(), timerfd_create(),
+ * signalfd(), inotify_init(), inotify_init1(), close(), and
+ * close_range(). Each one calls the C library version and then records
+ * or forgets the descriptors in the libexcept table (see
+ * record_fd_provenance() and clear_fd_provenance()).
+ *
+ * \note
+ * Only calls going through the dynamic linker are tracked. Descriptors
+ * opened internally by the C library (i.e. fopen()) are not.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Save the descriptors received in a message.
+ *
+ * The descriptors passed with SCM_RIGHTS are new descriptors in this
+ * process.
+ *
+ * \param[in] msg  The message received by recvmsg().
+ */
+void record_received_fds(msghdr const * msg)
+{
+    for(cmsghdr const * cmsg(CMSG_FIRSTHDR(msg));
+        cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(const_cast<msghdr *>(msg), const_cast<cmsghdr *>(cmsg)))
+    {
+        if(cmsg->cmsg_level == SOL_SOCKET
+        && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            std::size_t const count((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            unsigned char const * data(CMSG_DATA(cmsg));
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                int fd;
+                memcpy(&fd, data + idx * sizeof(int), sizeof(int));
+                record_fd_provenance(fd);
+            }
+        }
+    }
+}
+
+
+/** \brief Find the C library version of a function.
+ *
+ * Our replacement functions cannot do their work without the original.
+ * If the dynamic linker does not find it, the process cannot continue
+ * so this function prints an error and aborts.
+ *
+ * \param[in] name  The name of the function to search.
+ *
+ * \return The next definition of the function.
+ */
+template<typename F>
+F next_function(char const * name)
+{
+    F const f(reinterpret_cast<F>(dlsym(RTLD_NEXT, name)));
+    if(f == nullptr)
+    {
+        char const prefix[] = "except_fd_provenance: fatal error: could not find the original ";
+        char const suffix[] = "() function.\n";
+        iovec const iov[3] = {
+            { const_cast<char *>(prefix), sizeof(prefix) - 1 },
+            { const_cast<char *>(name), strlen(name) },
+            { const_cast<char *>(suffix), sizeof(suffix) - 1 },
+        };
+        if(writev(STDERR_FILENO, iov, 3) == -1)
+        {
+            // nothing more we can do, we abort anyway
+        }
+        abort();
+    }
+    return f;
+}
+
+
+
+} // no name namespace
+
+
+
+}
+// namespace libexcept
+
+
+
+// the replacement functions; each one calls the C library version and
+// records the new descriptor(s)
+//
+extern "C" {
+
+
+int open(char const * path, int flags, ...)
+{
+    mode_t mode(0);
+    if((flags & O_CREAT) != 0
+    || (flags & O_TMPFILE) == O_TMPFILE)
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    static auto const g_open(libexcept::next_function<int (*)(char const *, int, ...)>("open"));
+    int const fd(g_open(path, flags, mode));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int open64(char const * path, int flags, ...)
+{
+    mode_t mode(0);
+    if((flags & O_CREAT) != 0
+    || (flags & O_TMPFILE) == O_TMPFILE)
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    static auto const g_open64(libexcept::next_function<int (*)(char const *, int, ...)>("open64"));
+    int const fd(g_open64(path, flags, mode));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int openat(int dirfd, char const * path, int flags, ...)
+{
+    mode_t mode(0);
+    if((flags & O_CREAT) != 0
+    || (flags & O_TMPFILE) == O_TMPFILE)
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    static auto const g_openat(libexcept::next_function<int (*)(int, char const *, int, ...)>("openat"));
+    int const fd(g_openat(dirfd, path, flags, mode));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int openat64(int dirfd, char const * path, int flags, ...)
+{
+    mode_t mode(0);
+    if((flags & O_CREAT) != 0
+    || (flags & O_TMPFILE) == O_TMPFILE)
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    static auto const g_openat64(libexcept::next_function<int (*)(int, char const *, int, ...)>("openat64"));
+    int const fd(g_openat64(dirfd, path, flags, mode));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int creat(char const * path, mode_t mode)
+{
+    static auto const g_creat(libexcept::next_function<int (*)(char const *, mode_t)>("creat"));
+    int const fd(g_creat(path, mode));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int socket(int domain, int type, int protocol) noexcept
+{
+    static auto const g_socket(libexcept::next_function<int (*)(int, int, int)>("socket"));
+    int const fd(g_socket(domain, type, protocol));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int socketpair(int domain, int type, int protocol, int sv[2]) noexcept
+{
+    static auto const g_socketpair(libexcept::next_function<int (*)(int, int, int, int *)>("socketpair"));
+    int const r(g_socketpair(domain, type, protocol, sv));
+    if(r == 0)
+    {
+        libexcept::record_fd_provenance(sv[0]);
+        libexcept::record_fd_provenance(sv[1]);
+    }
+    return r;
+}
+
+
+int accept(int sockfd, sockaddr * addr, socklen_t * addrlen)
+{
+    static auto const g_accept(libexcept::next_function<int (*)(int, sockaddr *, socklen_t *)>("accept"));
+    int const fd(g_accept(sockfd, addr, addrlen));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int accept4(int sockfd, sockaddr * addr, socklen_t * addrlen, int flags)
+{
+    static auto const g_accept4(libexcept::next_function<int (*)(int, sockaddr *, socklen_t *, int)>("accept4"));
+    int const fd(g_accept4(sockfd, addr, addrlen, flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int pipe(int fds[2]) noexcept
+{
+    static auto const g_pipe(libexcept::next_function<int (*)(int *)>("pipe"));
+    int const r(g_pipe(fds));
+    if(r == 0)
+    {
+        libexcept::record_fd_provenance(fds[0]);
+        libexcept::record_fd_provenance(fds[1]);
+    }
+    return r;
+}
+
+
+int pipe2(int fds[2], int flags) noexcept
+{
+    static auto const g_pipe2(libexcept::next_function<int (*)(int *, int)>("pipe2"));
+    int const r(g_pipe2(fds, flags));
+    if(r == 0)
+    {
+        libexcept::record_fd_provenance(fds[0]);
+        libexcept::record_fd_provenance(fds[1]);
+    }
+    return r;
+}
+
+
+int dup(int oldfd) noexcept
+{
+    static auto const g_dup(libexcept::next_function<int (*)(int)>("dup"));
+    int const fd(g_dup(oldfd));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int dup2(int oldfd, int newfd) noexcept
+{
+    static auto const g_dup2(libexcept::next_function<int (*)(int, int)>("dup2"));
+    int const fd(g_dup2(oldfd, newfd));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int dup3(int oldfd, int newfd, int flags) noexcept
+{
+    static auto const g_dup3(libexcept::next_function<int (*)(int, int, int)>("dup3"));
+    int const fd(g_dup3(oldfd, newfd, flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int fcntl(int fd, int cmd, ...)
+{
+    va_list ap;
+    va_start(ap, cmd);
+    void * arg(va_arg(ap, void *));
+    va_end(ap);
+    static auto const g_fcntl(libexcept::next_function<int (*)(int, int, ...)>("fcntl"));
+    int const r(g_fcntl(fd, cmd, arg));
+    if(cmd == F_DUPFD
+    || cmd == F_DUPFD_CLOEXEC)
+    {
+        libexcept::record_fd_provenance(r);
+    }
+    return r;
+}
+
+
+int fcntl64(int fd, int cmd, ...)
+{
+    va_list ap;
+    va_start(ap, cmd);
+    void * arg(va_arg(ap, void *));
+    va_end(ap);
+    static auto const g_fcntl64(libexcept::next_function<int (*)(int, int, ...)>("fcntl64"));
+    int const r(g_fcntl64(fd, cmd, arg));
+    if(cmd == F_DUPFD
+    || cmd == F_DUPFD_CLOEXEC)
+    {
+        libexcept::record_fd_provenance(r);
+    }
+    return r;
+}
+
+
+ssize_t recvmsg(int sockfd, msghdr * msg, int flags)
+{
+    static auto const g_recvmsg(libexcept::next_function<ssize_t (*)(int, msghdr *, int)>("recvmsg"));
+    ssize_t const r(g_recvmsg(sockfd, msg, flags));
+    if(r >= 0)
+    {
+        libexcept::record_received_fds(msg);
+    }
+    return r;
+}
+
+
+int eventfd(unsigned int count, int flags) noexcept
+{
+    static auto const g_eventfd(libexcept::next_function<int (*)(unsigned int, int)>("eventfd"));
+    int const fd(g_eventfd(count, flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int epoll_create(int size) noexcept
+{
+    static auto const g_epoll_create(libexcept::next_function<int (*)(int)>("epoll_create"));
+    int const fd(g_epoll_create(size));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int epoll_create1(int flags) noexcept
+{
+    static auto const g_epoll_create1(libexcept::next_function<int (*)(int)>("epoll_create1"));
+    int const fd(g_epoll_create1(flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int memfd_create(char const * name, unsigned int flags) noexcept
+{
+    static auto const g_memfd_create(libexcept::next_function<int (*)(char const *, unsigned int)>("memfd_create"));
+    int const fd(g_memfd_create(name, flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int timerfd_create(clockid_t clock_id, int flags) noexcept
+{
+    static auto const g_timerfd_create(libexcept::next_function<int (*)(clockid_t, int)>("timerfd_create"));
+    int const fd(g_timerfd_create(clock_id, flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int signalfd(int fd, sigset_t const * mask, int flags) noexcept
+{
+    static auto const g_signalfd(libexcept::next_function<int (*)(int, sigset_t const *, int)>("signalfd"));
+    int const r(g_signalfd(fd, mask, flags));
+    if(fd == -1)
+    {
+        // only a new descriptor, not when changing the mask of an existing one
+        //
+        libexcept::record_fd_provenance(r);
+    }
+    return r;
+}
+
+
+int inotify_init() noexcept
+{
+    static auto const g_inotify_init(libexcept::next_function<int (*)()>("inotify_init"));
+    int const fd(g_inotify_init());
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int inotify_init1(int flags) noexcept
+{
+    static auto const g_inotify_init1(libexcept::next_function<int (*)(int)>("inotify_init1"));
+    int const fd(g_inotify_init1(flags));
+    libexcept::record_fd_provenance(fd);
+    return fd;
+}
+
+
+int close(int fd)
+{
+    static auto const g_close(libexcept::next_function<int (*)(int)>("close"));
+    if(fd >= 0)
+    {
+        libexcept::clear_fd_provenance(fd, fd);
+    }
+    return g_close(fd);
+}
+
+
+#if __GLIBC_PREREQ(2, 34)
+int close_range(unsigned int first, unsigned int last, int flags) noexcept
+{
+    static auto const g_close_range(libexcept::next_function<int (*)(unsigned int, unsigned int, int)>("close_range"));
+    int const r(g_close_range(first, last, flags));
+    if(r == 0
+    && (flags & CLOSE_RANGE_CLOEXEC) == 0)
+    {
+        libexcept::clear_fd_provenance(first, last);
+    }
+    return r;
+}
+#endif
+
+
+} // extern "C"
+
+
+// vim: ts=4 sw=4 et
@@ -21,10 +21,12 @@
 //
 #include    "libexcept/file_inheritance.h"
 
+#include    "libexcept/fd_provenance.h"
+
 
 // C++
 //
-#include    <fstream>
+#include    <algorithm>
 #include    <iostream>
 #include    <list>
 #include    <memory>
@@ -33,7 +35,14 @@
 // C
 //
 #include    <dirent.h>
+#include    <errno.h>
+#include    <fcntl.h>
+#include    <limits.h>
+#include    <stdio.h>
+#include    <stdlib.h>
 #include    <string.h>
+#include    <sys/stat.h>
+#include    <sys/syscall.h>
 #include    <unistd.h>
 
 
@@ -51,10 +60,659 @@ namespace libexcept
 
 
 
+namespace
+{
+
+
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC     (1U << 2)
+#endif
+
+
+/** \brief Close or mark a range of file descriptors.
+ *
+ * This function calls the close_range() system call on the range
+ * [\p first .. \p last]. It is used to remediate large numbers of leaked
+ * file descriptors at once.
+ *
+ * \param[in] first  The first file descriptor of the range.
+ * \param[in] last  The last file descriptor of the range (inclusive).
+ * \param[in] remediation  Whether to close or mark the descriptors.
+ *
+ * \return true if the system call succeeded, false if it is not
+ * available (old kernel) or failed.
+ */
+bool apply_close_range(unsigned int first, unsigned int last, fd_remediation_t remediation)
+{
+#ifdef SYS_close_range
+    unsigned int const flags(remediation == fd_remediation_t::FD_REMEDIATION_CLOEXEC
+                                    ? CLOSE_RANGE_CLOEXEC
+                                    : 0);
+    if(syscall(SYS_close_range, first, last, flags) != 0)
+    {
+        return false;
+    }
+    if(flags == 0)
+    {
+        clear_fd_provenance(first, last);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/** \brief Close or mark one file descriptor.
+ *
+ * This is the fallback used when close_range() is not available.
+ *
+ * \param[in] fd  The file descriptor to remediate.
+ * \param[in] remediation  Whether to close or mark the descriptor.
+ */
+void apply_remediation(int fd, fd_remediation_t remediation)
+{
+    switch(remediation)
+    {
+    case fd_remediation_t::FD_REMEDIATION_NONE:
+        break;
+
+    case fd_remediation_t::FD_REMEDIATION_CLOSE:
+        close(fd);
+        break;
+
+    case fd_remediation_t::FD_REMEDIATION_CLOEXEC:
+        {
+            int const flags(fcntl(fd, F_GETFD));
+            if(flags >= 0
+            && (flags & FD_CLOEXEC) == 0)
+            {
+                fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+            }
+        }
+        break;
+
+    }
+}
+
+
+/** \brief Read the cmdline file of a process.
+ *
+ * This function reads /proc/\<pid>/cmdline in \p buffer. The buffer
+ * is reused between calls so once it is large enough, no more memory
+ * gets allocated. In most cases, a single read() is enough.
+ *
+ * \param[in] pid  The process identifier.
+ * \param[in,out] buffer  The buffer receiving the file content.
+ *
+ * \return The number of bytes read, 0 if the file cannot be read.
+ */
+std::size_t read_cmdline(pid_t pid, std::vector<char> & buffer)
+{
+    char filename[32];
+    snprintf(filename, sizeof(filename), "/proc/%d/cmdline", pid);
+    int const fd(open(filename, O_RDONLY | O_CLOEXEC));
+    if(fd < 0)
+    {
+        return 0;
+    }
+
+    if(buffer.size() < 4096)
+    {
+        buffer.resize(4096);
+    }
+    std::size_t size(0);
+    for(;;)
+    {
+        if(size == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t const r(read(fd, buffer.data() + size, buffer.size() - size));
+        if(r < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            size = 0;
+            break;
+        }
+        if(r == 0)
+        {
+            break;
+        }
+        size += r;
+    }
+
+    close(fd);
+    return size;
+}
+
+
+/** \brief Split a cmdline buffer in arguments.
+ *
+ * \param[in] buffer  The buffer holding the NUL separated arguments.
+ * \param[in] size  The number of bytes in \p buffer.
+ *
+ * \return The list of arguments.
+ */
+command_line_t split_cmdline(std::vector<char> const & buffer, std::size_t size)
+{
+    command_line_t args;
+    char const * s(buffer.data());
+    char const * end(s + size);
+    while(s < end)
+    {
+        char const * e(static_cast<char const *>(memchr(s, '\0', end - s)));
+        if(e == nullptr)
+        {
+            e = end;
+        }
+        args.emplace_back(s, e - s);
+        s = e + 1;
+    }
+    return args;
+}
+
+
+/** \brief Call \p f for each file descriptor opened by a process.
+ *
+ * This function reads the /proc/\<pid>/fd directory with getdents64() in
+ * a buffer on the stack. The directory is opened once and the entries
+ * are parsed in place so the scan is linear and does not allocate
+ * memory, even in processes with tens of thousands of descriptors.
+ *
+ * The callback receives the file descriptor of the directory (to use
+ * with the *at() functions, such as readlinkat()), the file descriptor
+ * number found in the directory, and its name in the directory.
+ *
+ * When scanning this process (\p pid is 0), the file descriptor used to
+ * read the directory is not reported.
+ *
+ * \param[in] pid  The process to scan, 0 for this process.
+ * \param[in] f  The function called with each file descriptor.
+ *
+ * \return false if the directory could not be opened or read.
+ */
+template<typename F>
+bool for_each_fd(pid_t pid, F f)
+{
+    char path[32];
+    if(pid == 0)
+    {
+        strcpy(path, "/proc/self/fd");
+    }
+    else
+    {
+        snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+    }
+    int const dir(open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(dir < 0)
+    {
+        return false;
+    }
+
+    alignas(dirent64) char buffer[8192];
+    bool result(true);
+    for(;;)
+    {
+        ssize_t const size(getdents64(dir, buffer, sizeof(buffer)));
+        if(size <= 0)
+        {
+            result = size == 0;
+            break;
+        }
+        for(ssize_t pos(0); pos < size; )
+        {
+            dirent64 const * ent(reinterpret_cast<dirent64 const *>(buffer + pos));
+            pos += ent->d_reclen;
+
+            // convert the name, which also skips "." and ".."
+            //
+            char const * name(ent->d_name);
+            if(*name < '0' || *name > '9')
+            {
+                continue;
+            }
+            int fd(0);
+            for(char const * n(name); *n >= '0' && *n <= '9'; ++n)
+            {
+                fd = fd * 10 + *n - '0';
+            }
+            if(pid != 0
+            || fd != dir)
+            {
+                f(dir, fd, name);
+            }
+        }
+    }
+
+    close(dir);
+    return result;
+}
+
+
+/** \brief Convert a file mode to a file descriptor type.
+ *
+ * \param[in] mode  The st_mode of a stat structure.
+ *
+ * \return The corresponding file descriptor type.
+ */
+fd_type_t fd_type_from_mode(mode_t mode)
+{
+    switch(mode & S_IFMT)
+    {
+    case S_IFREG:
+        return fd_type_t::FD_TYPE_FILE;
+
+    case S_IFDIR:
+        return fd_type_t::FD_TYPE_DIRECTORY;
+
+    case S_IFCHR:
+    case S_IFBLK:
+        return fd_type_t::FD_TYPE_DEVICE;
+
+    case S_IFIFO:
+        return fd_type_t::FD_TYPE_PIPE;
+
+    case S_IFSOCK:
+        return fd_type_t::FD_TYPE_SOCKET;
+
+    }
+
+    return fd_type_t::FD_TYPE_UNKNOWN;
+}
+
+
+/** \brief Gather the information about one file descriptor.
+ *
+ * This function reads the target of the link found in /proc/self/fd
+ * and queries the descriptor with fcntl(), lseek(), and fstat() to
+ * fill \p info.
+ *
+ * \param[in] dir  The /proc/self/fd directory descriptor.
+ * \param[in] fd  The file descriptor to describe.
+ * \param[in] name  The name of \p fd in \p dir.
+ * \param[out] info  The structure receiving the information.
+ */
+void load_fd_info(int dir, int fd, char const * name, fd_info_t & info)
+{
+    info.f_fd = fd;
+
+    char link[PATH_MAX];
+    ssize_t const l(readlinkat(dir, name, link, sizeof(link)));
+    if(l > 0)
+    {
+        info.f_target.assign(link, l);
+    }
+
+    int const flags(fcntl(fd, F_GETFL));
+    info.f_flags = flags < 0 ? 0 : flags;
+    int const fd_flags(fcntl(fd, F_GETFD));
+    info.f_cloexec = fd_flags >= 0 && (fd_flags & FD_CLOEXEC) != 0;
+    info.f_position = lseek(fd, 0, SEEK_CUR);
+
+    if(info.f_target.compare(0, 11, "anon_inode:") == 0)
+    {
+        info.f_type = fd_type_t::FD_TYPE_ANON_INODE;
+        return;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) == 0)
+    {
+        info.f_type = fd_type_from_mode(st.st_mode);
+    }
+}
+
+
+/** \brief Gather the information about a descriptor of another process.
+ *
+ * The descriptors of another process cannot be queried directly. This
+ * function reads the /proc/\<pid>/fdinfo/\<fd> file for the position
+ * and the flags and uses fstatat() on the link for the type.
+ *
+ * If the link or the fdinfo file cannot be read, the flags, the
+ * position, and the target are unknown. The function then returns false
+ * so the caller does not take the default values (i.e. f_cloexec false)
+ * as the state of the descriptor.
+ *
+ * \param[in] dir  The /proc/\<pid>/fd directory descriptor.
+ * \param[in] fd  The file descriptor to describe.
+ * \param[in] name  The name of \p fd in \p dir.
+ * \param[out] info  The structure receiving the information.
+ *
+ * \return true if the details were read, false otherwise; in that case
+ * errno says why (i.e. ENOENT if the descriptor was closed meanwhile).
+ */
+bool load_remote_fd_info(int dir, int fd, char const * name, fd_info_t & info)
+{
+    info.f_fd = fd;
+
+    char link[PATH_MAX];
+    ssize_t const l(readlinkat(dir, name, link, sizeof(link)));
+    if(l <= 0)
+    {
+        return false;
+    }
+    info.f_target.assign(link, l);
+
+    char fdinfo[32];
+    snprintf(fdinfo, sizeof(fdinfo), "../fdinfo/%d", fd);
+    int const in(openat(dir, fdinfo, O_RDONLY | O_CLOEXEC));
+    if(in < 0)
+    {
+        return false;
+    }
+    char buffer[512];
+    ssize_t const size(read(in, buffer, sizeof(buffer) - 1));
+    int const e(errno);
+    close(in);
+    if(size <= 0)
+    {
+        errno = size == 0 ? ENODATA : e;
+        return false;
+    }
+    buffer[size] = '\0';
+    char const * flags(strstr(buffer, "flags:"));
+    if(flags == nullptr)
+    {
+        errno = ENODATA;
+        return false;
+    }
+    int const value(static_cast<int>(strtol(flags + 6, nullptr, 8)));
+    info.f_cloexec = (value & O_CLOEXEC) != 0;
+    info.f_flags = value & ~O_CLOEXEC;
+    char const * pos(strstr(buffer, "pos:"));
+    if(pos != nullptr)
+    {
+        info.f_position = strtoll(pos + 4, nullptr, 10);
+    }
+
+    if(info.f_target.compare(0, 11, "anon_inode:") == 0)
+    {
+        info.f_type = fd_type_t::FD_TYPE_ANON_INODE;
+        return true;
+    }
+
+    struct stat st;
+    if(fstatat(dir, name, &st, 0) == 0)
+    {
+        info.f_type = fd_type_from_mode(st.st_mode);
+    }
+
+    // fdinfo shows 0 for streams, use -1 like lseek() does
+    //
+    if(info.f_type == fd_type_t::FD_TYPE_PIPE
+    || info.f_type == fd_type_t::FD_TYPE_SOCKET)
+    {
+        info.f_position = -1;
+    }
+
+    return true;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize an empty bitmap of allowed file descriptors.
+ *
+ * The bitmap is an alternative to the allowed_fds_t set. Checking
+ * whether a file descriptor is allowed is a single bit test.
+ */
+allowed_fds_bitmap_t::allowed_fds_bitmap_t()
+{
+}
+
+
+/** \brief Initialize a bitmap from a set of file descriptors.
+ *
+ * \param[in] fds  The file descriptors to allow.
+ */
+allowed_fds_bitmap_t::allowed_fds_bitmap_t(allowed_fds_t const & fds)
+{
+    if(!fds.empty())
+    {
+        int const last(*fds.rbegin());
+        if(last >= 0)
+        {
+            f_bits.resize(last / 64 + 1);
+        }
+    }
+    for(auto const & fd : fds)
+    {
+        set(fd);
+    }
+}
+
+
+/** \brief Allow the specified file descriptor.
+ *
+ * The bitmap grows as required. Negative numbers are ignored.
+ *
+ * \param[in] fd  The file descriptor to allow.
+ */
+void allowed_fds_bitmap_t::set(int fd)
+{
+    if(fd < 0)
+    {
+        return;
+    }
+    std::size_t const idx(fd / 64);
+    if(idx >= f_bits.size())
+    {
+        f_bits.resize(idx + 1);
+    }
+    f_bits[idx] |= std::uint64_t(1) << (fd % 64);
+}
+
+
+/** \brief Disallow the specified file descriptor.
+ *
+ * \param[in] fd  The file descriptor to remove from the bitmap.
+ */
+void allowed_fds_bitmap_t::clear(int fd)
+{
+    if(fd < 0)
+    {
+        return;
+    }
+    std::size_t const idx(fd / 64);
+    if(idx < f_bits.size())
+    {
+        f_bits[idx] &= ~(std::uint64_t(1) << (fd % 64));
+    }
+}
+
+
+/** \brief Check whether a file descriptor is allowed.
+ *
+ * \param[in] fd  The file descriptor to check.
+ *
+ * \return true if \p fd was set in this bitmap.
+ */
+bool allowed_fds_bitmap_t::contains(int fd) const
+{
+    if(fd < 0)
+    {
+        return false;
+    }
+    std::size_t const idx(fd / 64);
+    return idx < f_bits.size()
+        && (f_bits[idx] & (std::uint64_t(1) << (fd % 64))) != 0;
+}
+
+
+/** \brief Convert a file descriptor type to a string.
+ *
+ * \param[in] type  The type to convert.
+ *
+ * \return A static string naming \p type.
+ */
+char const * fd_type_to_string(fd_type_t type)
+{
+    switch(type)
+    {
+    case fd_type_t::FD_TYPE_UNKNOWN:
+        break;
+
+    case fd_type_t::FD_TYPE_FILE:
+        return "file";
+
+    case fd_type_t::FD_TYPE_DIRECTORY:
+        return "directory";
+
+    case fd_type_t::FD_TYPE_DEVICE:
+        return "device";
+
+    case fd_type_t::FD_TYPE_PIPE:
+        return "pipe";
+
+    case fd_type_t::FD_TYPE_SOCKET:
+        return "socket";
+
+    case fd_type_t::FD_TYPE_ANON_INODE:
+        return "anon_inode";
+
+    }
+
+    return "unknown";
+}
+
+
+/** \brief Get the list of file descriptors opened by a process.
+ *
+ * This function reads the /proc/\<pid>/fd directory once and describes
+ * each file descriptor: its type, its target (as shown in /proc), its
+ * open flags, whether FD_CLOEXEC is set, and its position.
+ *
+ * For this process (\p pid is 0, the default), the descriptors are
+ * queried directly with fcntl() and lseek(). For other processes, the
+ * information comes from the /proc/\<pid>/fdinfo files, which requires
+ * the same permissions as reading the /proc/\<pid>/fd directory.
+ *
+ * The result is sorted by file descriptor. The descriptor used to read
+ * the directory is not included. If the directory cannot be read (the
+ * process does not exist or permission is denied) the list is empty.
+ * A descriptor of another process whose details cannot be read has its
+ * f_error set to the errno of the failure; its other fields, other than
+ * f_fd, are then not meaningful. A descriptor closed while being read
+ * is not included.
+ *
+ * This function can be called periodically to track the growth of the
+ * number of descriptors in long running daemons.
+ *
+ * \param[in] pid  The process to describe, 0 for this process.
+ *
+ * \return The list of opened file descriptors.
+ */
+fd_inventory_t get_fd_inventory(pid_t pid)
+{
+    fd_inventory_t inventory;
+    get_fd_inventory(pid, inventory);
+    return inventory;
+}
+
+
+/** \brief Get the list of file descriptors opened by a process.
+ *
+ * This function is the same as get_fd_inventory(pid_t) except that it
+ * tells you whether the process could be read. An empty list is valid
+ * for a process without any descriptor, but the other function also
+ * returns an empty list when the process exited or cannot be read.
+ *
+ * \param[in] pid  The process to describe, 0 for this process.
+ * \param[out] inventory  The list of opened file descriptors.
+ *
+ * \return true if the directory was read, false otherwise; in that
+ * case errno says why (i.e. ENOENT if the process exited or EACCES if
+ * we do not have permission to read its descriptors).
+ */
+bool get_fd_inventory(pid_t pid, fd_inventory_t & inventory)
+{
+    inventory.clear();
+    bool const result(for_each_fd(pid, [&inventory, pid](int dir, int fd, char const * name)
+        {
+            inventory.emplace_back();
+            if(pid == 0)
+            {
+                load_fd_info(dir, fd, name, inventory.back());
+            }
+            else if(!load_remote_fd_info(dir, fd, name, inventory.back()))
+            {
+                if(errno == ENOENT)
+                {
+                    // closed since we read the directory
+                    //
+                    inventory.pop_back();
+                }
+                else
+                {
+                    inventory.back().f_error = errno;
+                }
+            }
+        }));
+    int const e(errno);
+    std::sort(
+          inventory.begin()
+        , inventory.end()
+        , [](fd_info_t const & a, fd_info_t const & b)
+            {
+                return a.f_fd < b.f_fd;
+            });
+    errno = e;
+    return result;
+}
+
+
+/** \brief Find the next allowed file descriptor.
+ *
+ * This function searches the bitmap for the first allowed file
+ * descriptor larger or equal to \p fd. It skips 64 descriptors at
+ * a time when a word of the bitmap is empty.
+ *
+ * \param[in] fd  The file descriptor where the search starts.
+ *
+ * \return The next allowed file descriptor or -1 if there are none.
+ */
+int allowed_fds_bitmap_t::next(int fd) const
+{
+    if(fd < 0)
+    {
+        fd = 0;
+    }
+    std::size_t idx(fd / 64);
+    if(idx >= f_bits.size())
+    {
+        return -1;
+    }
+    std::uint64_t word(f_bits[idx] & (~std::uint64_t(0) << (fd % 64)));
+    for(;;)
+    {
+        if(word != 0)
+        {
+            return static_cast<int>(idx * 64 + __builtin_ctzll(word));
+        }
+        ++idx;
+        if(idx >= f_bits.size())
+        {
+            return -1;
+        }
+        word = f_bits[idx];
+    }
+}
+
+
 /** \brief Load the command line of the specified process.
  *
- * This function loads the cmdline file of the specified process. If an
- * error occurs, the function returns an empty string. Some processes do
+ * This function loads the cmdline file of the specified process and
+ * returns the first argument (the name of the program). If an error
+ * occurs, the function returns an empty string. Some processes do
  * not have a command line.
  *
  * If your program can include cppprocess (see eventdispatcher,) then I
@@ -64,16 +722,97 @@ namespace libexcept
  * \param[in] pid  The process identifier.
  *
  * \return The command line of the \p pid process.
+ *
+ * \sa get_command_line_arguments()
  */
 std::string get_command_line(pid_t pid)
 {
-    std::string filename("/proc/");
-    filename += std::to_string(pid);
-    filename += "/cmdline";
-    std::ifstream cmdline(filename);
-    std::string line;
-    std::getline(cmdline, line, '\0');
-    return line;
+    thread_local std::vector<char> buffer;
+    std::size_t const size(read_cmdline(pid, buffer));
+    if(size == 0)
+    {
+        return std::string();
+    }
+    return std::string(buffer.data(), strnlen(buffer.data(), size));
+}
+
+
+/** \brief Load all the arguments of the specified process.
+ *
+ * This function reads the cmdline file of the specified process with
+ * a single read() (unless the command line is very long) and returns
+ * all the arguments.
+ *
+ * If you need the command line of the same processes multiple times,
+ * use a command_line_cache_t object instead.
+ *
+ * \param[in] pid  The process identifier.
+ *
+ * \return The list of arguments, empty if not available.
+ */
+command_line_t get_command_line_arguments(pid_t pid)
+{
+    thread_local std::vector<char> buffer;
+    std::size_t const size(read_cmdline(pid, buffer));
+    return split_cmdline(buffer, size);
+}
+
+
+/** \brief Convert a list of arguments to one string.
+ *
+ * The arguments are separated by one space. They are not quoted.
+ *
+ * \param[in] args  The arguments to join.
+ *
+ * \return The arguments in one string.
+ */
+std::string command_line_to_string(command_line_t const & args)
+{
+    std::string result;
+    for(auto const & a : args)
+    {
+        if(!result.empty())
+        {
+            result += ' ';
+        }
+        result += a;
+    }
+    return result;
+}
+
+
+/** \brief Get the arguments of a process, loading them once.
+ *
+ * The first time a \p pid is requested, its cmdline file gets read in
+ * a buffer which is reused for all the processes. Further requests for
+ * the same \p pid return the cached arguments.
+ *
+ * Process identifiers get reused, so the cache is expected to live for
+ * the duration of one scan. Call clear() before the next scan.
+ *
+ * \param[in] pid  The process identifier.
+ *
+ * \return A reference to the cached arguments of \p pid.
+ */
+command_line_t const & command_line_cache_t::get(pid_t pid)
+{
+    auto it(f_cache.find(pid));
+    if(it == f_cache.end())
+    {
+        std::size_t const size(read_cmdline(pid, f_buffer));
+        it = f_cache.emplace(pid, split_cmdline(f_buffer, size)).first;
+    }
+    return it->second;
+}
+
+
+/** \brief Forget all the cached command lines.
+ *
+ * The read buffer is kept for the next scan.
+ */
+void command_line_cache_t::clear()
+{
+    f_cache.clear();
 }
 
 
@@ -95,75 +834,78 @@ std::string get_command_line(pid_t pid)
  */
 void verify_inherited_files(allowed_fds_t allowed)
 {
-    auto closedir = [](DIR * d)
-    {
-        ::closedir(d);
-    };
-
-    int errcnt(0);
-
-    std::string path("/proc/");
-    path += std::to_string(getpid());
-    path += "/fd";
-    DIR * d(opendir(path.c_str()));
-    std::unique_ptr<DIR, decltype(closedir)> auto_close(d, closedir);
-
-    for(;;)
-    {
-        dirent const * ent(readdir(d));
-        if(ent == nullptr)
-        {
-            break;
-        }
-
-        char const * basename(ent->d_name);
-        if(basename[0] == '.')
-        {
-            // ignore all hidden files
-            continue;
-        }
+    verify_inherited_files(allowed_fds_bitmap_t(allowed));
+}
 
-        if(basename[0] >= '0'
-        && basename[0] <= '2'
-        && basename[1] == '\0')
-        {
-            // skip stdin, stdout, stderr
-            continue;
-        }
 
-        int const fd(std::atoi(basename));
-        if(fd == dirfd(d))
-        {
-            // ignore the opendir() file descriptor
-            // (it is currently open since we are reading the directory)
-            //
-            continue;
-        }
+/** \brief Check the list of files opened in this process.
+ *
+ * This function works like the verify_inherited_files() function with
+ * a set of allowed file descriptors, except that the check is a single
+ * bit test per descriptor. The stdin, stdout, and stderr descriptors are
+ * always allowed.
+ *
+ * The directory is read with getdents64() and the leaked descriptors
+ * are described the same way as in get_fd_inventory(), with readlinkat()
+ * relative to the directory, so the scan does not allocate memory unless
+ * a leak is found.
+ *
+ * If the descriptor provenance tracker is turned on (see
+ * set_track_fd_provenance()), the stack which opened each leaked
+ * descriptor is included in the warning.
+ *
+ * When \p remediation is not FD_REMEDIATION_NONE, the leaked descriptors
+ * get closed or marked close-on-exec with remediate_inherited_files()
+ * after the warnings were written. In that case the function does not
+ * throw in Debug mode since the leaks were handled.
+ *
+ * \param[in] allowed  Additional allowed input streams.
+ * \param[in] remediation  What to do with the leaked descriptors.
+ */
+void verify_inherited_files(
+          allowed_fds_bitmap_t const & allowed
+        , fd_remediation_t remediation)
+{
+    int errcnt(0);
+    command_line_cache_t command_lines;
 
-        if(allowed.find(fd) == allowed.end())
+    for_each_fd(0, [&](int dir, int fd, char const * name)
         {
-            char link[256];
-            ssize_t const l(readlink((path + '/' + basename).c_str(), link, sizeof(link) - 1));
-            if(l <= 0)
-            {
-                link[0] = '\0';
-            }
-            else
+            if(fd <= 2
+            || allowed.contains(fd))
             {
-                link[l] = '\0';
+                // skip stdin, stdout, stderr and the allowed descriptors
+                //
+                return;
             }
+
+            fd_info_t info;
+            load_fd_info(dir, fd, name, info);
             std::cerr
                 << "warning: file descriptor "
                 << fd
                 << " ("
-                << link
+                << info.f_target
+                << ", "
+                << fd_type_to_string(info.f_type)
+                << (info.f_cloexec ? ", close-on-exec" : "")
                 << ") leaked on invocation. Parent PID "
                 << getppid()
                 << ": "
-                << get_command_line(getppid())
+                << command_line_to_string(command_lines.get(getppid()))
                 << '\n';
+            for(auto const & frame : get_fd_provenance(fd))
+            {
+                std::cerr << "  opened at: " << frame << '\n';
+            }
             ++errcnt;
-        }
+        });
+
+    if(errcnt > 0
+    && remediation != fd_remediation_t::FD_REMEDIATION_NONE)
+    {
+        remediate_inherited_files(allowed, remediation);
+        return;
     }
 
 #ifdef _DEBUG
@@ -178,6 +920,77 @@ void verify_inherited_files(allowed_fds_t allowed)
 
 
 
+/** \brief Close or mark all the file descriptors which are not allowed.
+ *
+ * This function closes (FD_REMEDIATION_CLOSE) or marks close-on-exec
+ * (FD_REMEDIATION_CLOEXEC) all the file descriptors other than stdin,
+ * stdout, stderr, and the descriptors found in \p allowed.
+ *
+ * The function uses the close_range() system call on each contiguous
+ * range of descriptors between the allowed ones. The last range goes to
+ * the largest possible descriptor, so the descriptors do not even need
+ * to be enumerated. On processes with large descriptor tables, this is
+ * much faster than closing each descriptor one by one.
+ *
+ * On kernels without close_range() (before 5.9, or 5.11 for the
+ * close-on-exec flag), the function falls back to enumerating the
+ * descriptors and remediating each one individually.
+ *
+ * \param[in] allowed  The descriptors to leave alone.
+ * \param[in] remediation  Whether to close or mark the descriptors.
+ *
+ * \return true if the remediation was applied, false if the descriptors
+ * could not be enumerated.
+ */
+bool remediate_inherited_files(
+          allowed_fds_bitmap_t const & allowed
+        , fd_remediation_t remediation)
+{
+    if(remediation == fd_remediation_t::FD_REMEDIATION_NONE)
+    {
+        return true;
+    }
+
+    bool use_close_range(true);
+    int first(3);
+    for(;;)
+    {
+        int const next(allowed.next(first));
+        unsigned int const last(next == -1 ? ~0U : static_cast<unsigned int>(next - 1));
+        if(next == -1
+        || next > first)
+        {
+            if(!apply_close_range(first, last, remediation))
+            {
+                use_close_range = false;
+                break;
+            }
+        }
+        if(next == -1)
+        {
+            break;
+        }
+        first = next + 1;
+    }
+    if(use_close_range)
+    {
+        return true;
+    }
+
+    // fallback for older kernels
+    //
+    return for_each_fd(0, [&allowed, remediation](int, int fd, char const *)
+        {
+            if(fd > 2
+            && !allowed.contains(fd))
+            {
+                apply_remediation(fd, remediation);
+            }
+        });
+}
+
+
+
 }
 // namespace libexcept
 // vim: ts=4 sw=4 et
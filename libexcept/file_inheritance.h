@@ -25,8 +25,16 @@
 
 // C++
 //
+#include    <cstdint>
+#include    <map>
 #include    <set>
 #include    <string>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/types.h>
 
 
 
@@ -46,8 +54,86 @@ DECLARE_LOGIC_ERROR(file_inherited);
 
 typedef std::set<int>           allowed_fds_t;
 
+
+class allowed_fds_bitmap_t
+{
+public:
+                                allowed_fds_bitmap_t();
+    explicit                    allowed_fds_bitmap_t(allowed_fds_t const & fds);
+
+    void                        set(int fd);
+    void                        clear(int fd);
+    bool                        contains(int fd) const;
+    int                         next(int fd) const;
+
+private:
+    std::vector<std::uint64_t>  f_bits = std::vector<std::uint64_t>();
+};
+
+
+enum class fd_type_t
+{
+    FD_TYPE_UNKNOWN,
+    FD_TYPE_FILE,
+    FD_TYPE_DIRECTORY,
+    FD_TYPE_DEVICE,
+    FD_TYPE_PIPE,
+    FD_TYPE_SOCKET,
+    FD_TYPE_ANON_INODE,
+};
+
+
+struct fd_info_t
+{
+    int                         f_fd = -1;
+    fd_type_t                   f_type = fd_type_t::FD_TYPE_UNKNOWN;
+    int                         f_flags = 0;            // F_GETFL
+    bool                        f_cloexec = false;      // F_GETFD & FD_CLOEXEC
+    off_t                       f_position = -1;        // -1 if not seekable
+    std::string                 f_target = std::string();
+    int                         f_error = 0;            // errno if the details could not be read
+};
+
+typedef std::vector<fd_info_t>  fd_inventory_t;
+
+
+enum class fd_remediation_t
+{
+    FD_REMEDIATION_NONE,        // only report the leaks
+    FD_REMEDIATION_CLOSE,       // close the leaked descriptors
+    FD_REMEDIATION_CLOEXEC,     // mark the leaked descriptors FD_CLOEXEC
+};
+
+
+typedef std::vector<std::string>    command_line_t;
+
+
+class command_line_cache_t
+{
+public:
+    command_line_t const &      get(pid_t pid);
+    void                        clear();
+
+private:
+    std::map<pid_t, command_line_t>
+                                f_cache = std::map<pid_t, command_line_t>();
+    std::vector<char>           f_buffer = std::vector<char>();
+};
+
+
+char const *                    fd_type_to_string(fd_type_t type);
+fd_inventory_t                  get_fd_inventory(pid_t pid = 0);
+bool                            get_fd_inventory(pid_t pid, fd_inventory_t & inventory);
 std::string                     get_command_line(pid_t pid);
+command_line_t                  get_command_line_arguments(pid_t pid);
+std::string                     command_line_to_string(command_line_t const & args);
 void                            verify_inherited_files(allowed_fds_t allowed = allowed_fds_t());
+void                            verify_inherited_files(
+                                          allowed_fds_bitmap_t const & allowed
+                                        , fd_remediation_t remediation = fd_remediation_t::FD_REMEDIATION_NONE);
+bool                            remediate_inherited_files(
+                                          allowed_fds_bitmap_t const & allowed
+                                        , fd_remediation_t remediation);
 
 
 }
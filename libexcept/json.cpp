@@ -0,0 +1,626 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/json.h"
+
+#include    "libexcept/exception.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <cxxabi.h>
+#include    <typeinfo>
+
+
+// C
+//
+#include    <errno.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the JSON exception writer.
+ *
+ * This file includes the json_writer class which converts exceptions to
+ * JSON. Each exception is written as one object on a single line:
+ *
+ * \code
+ *     {"type":"libexcept::exception_t","message":"...",
+ *      "parameters":{"name":"value",...},"stack_trace":["...",...]}
+ * \endcode
+ *
+ * (shown on two lines here for clarity.)
+ *
+ * Other records can be written with begin_object(), the write_...()
+ * functions, and end_object(). Each record is also one object on a
+ * single line.
+ *
+ * The writer does not build any intermediate string. The data is escaped
+ * and copied directly to the caller's buffer or to a fixed buffer which
+ * gets flushed to the file descriptor each time it is full.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+constexpr char const    g_hex[] = "0123456789abcdef";
+
+
+/** \brief Get the length of a valid UTF-8 sequence.
+ *
+ * This function checks the sequence starting at \p s as defined in
+ * RFC 3629: no overlong forms, no surrogates, and no code points over
+ * U+10FFFF.
+ *
+ * \param[in] s  The first byte of the sequence (0x80 or more).
+ * \param[in] e  The end of the string.
+ *
+ * \return The number of bytes in the sequence or 0 if it is not valid.
+ */
+std::size_t utf8_sequence_length(unsigned char const * s, unsigned char const * e)
+{
+    std::size_t length(0);
+    unsigned char min(0x80);
+    unsigned char max(0xBF);
+    if(s[0] >= 0xC2 && s[0] <= 0xDF)
+    {
+        length = 2;
+    }
+    else if(s[0] >= 0xE0 && s[0] <= 0xEF)
+    {
+        length = 3;
+        if(s[0] == 0xE0)
+        {
+            min = 0xA0;
+        }
+        else if(s[0] == 0xED)
+        {
+            max = 0x9F;
+        }
+    }
+    else if(s[0] >= 0xF0 && s[0] <= 0xF4)
+    {
+        length = 4;
+        if(s[0] == 0xF0)
+        {
+            min = 0x90;
+        }
+        else if(s[0] == 0xF4)
+        {
+            max = 0x8F;
+        }
+    }
+    else
+    {
+        return 0;
+    }
+
+    if(static_cast<std::size_t>(e - s) < length
+    || s[1] < min
+    || s[1] > max)
+    {
+        return 0;
+    }
+    for(std::size_t idx(2); idx < length; ++idx)
+    {
+        if(s[idx] < 0x80
+        || s[idx] > 0xBF)
+        {
+            return 0;
+        }
+    }
+
+    return length;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize a writer sending its output to a buffer.
+ *
+ * The JSON is written to \p buffer. If the buffer is too small, the
+ * output gets truncated and the is_truncated() function returns true.
+ * The output is not NUL terminated; use get_size() to know how many
+ * bytes were written.
+ *
+ * \param[in] buffer  The buffer where the JSON gets saved.
+ * \param[in] size  The size of \p buffer in bytes.
+ */
+json_writer::json_writer(char * buffer, std::size_t size)
+    : f_buffer(buffer)
+    , f_capacity(size)
+{
+}
+
+
+/** \brief Initialize a writer sending its output to a file descriptor.
+ *
+ * The JSON is first saved in a buffer of JSON_WRITER_BUFFER_SIZE bytes
+ * which gets written to \p fd each time it is full, when flush() is
+ * called, and when the writer gets destroyed.
+ *
+ * The writer does not take ownership of \p fd.
+ *
+ * \param[in] fd  The file descriptor where the JSON gets written.
+ */
+json_writer::json_writer(int fd)
+    : f_fd(fd)
+    , f_buffer(f_fd_buffer)
+    , f_capacity(sizeof(f_fd_buffer))
+{
+}
+
+
+/** \brief Flush and clean up the writer.
+ *
+ * In file descriptor mode, the remaining data is flushed.
+ */
+json_writer::~json_writer()
+{
+    flush();
+    free(f_demangle_buffer);
+}
+
+
+/** \brief Write an exception as a JSON object.
+ *
+ * The object includes the demangled type of the exception and its
+ * `what()` message. If the exception derives from exception_base_t,
+ * the parameters and stack trace are included too.
+ *
+ * The object is followed by a newline character so the output can be
+ * used as a stream of JSON lines.
+ *
+ * The type gets demangled with the same ABI function as
+ * demangle_cpp_name(), but the writer reuses its own buffer so after
+ * the first few calls no memory gets allocated.
+ *
+ * \param[in] e  The exception to write.
+ *
+ * \return true if the whole object was written, false if the output
+ * was truncated or a write to the file descriptor failed.
+ */
+bool json_writer::write_exception(std::exception const & e)
+{
+    char const * type(typeid(e).name());
+    int status(0);
+    char * demangled(abi::__cxa_demangle(type, f_demangle_buffer, &f_demangle_size, &status));
+    if(status == 0)
+    {
+        f_demangle_buffer = demangled;
+        type = demangled;
+    }
+
+    append("{\"type\":", 8);
+    append_string(type);
+    append(",\"message\":", 11);
+    append_string(e.what());
+
+    exception_base_t const * base(dynamic_cast<exception_base_t const *>(&e));
+    if(base != nullptr)
+    {
+        append(",\"parameters\":{", 15);
+        char sep('\0');
+        for(auto const & p : base->get_parameters())
+        {
+            if(sep != '\0')
+            {
+                append_char(sep);
+            }
+            sep = ',';
+            append_string(p.first.c_str(), p.first.length());
+            append_char(':');
+            append_string(p.second.c_str(), p.second.length());
+        }
+        append("},\"stack_trace\":[", 17);
+        sep = '\0';
+        for(auto const & frame : base->get_stack_trace())
+        {
+            if(sep != '\0')
+            {
+                append_char(sep);
+            }
+            sep = ',';
+            append_string(frame.c_str(), frame.length());
+        }
+        append_char(']');
+    }
+
+    append("}\n", 2);
+
+    return !f_truncated;
+}
+
+
+/** \brief Start a new JSON object.
+ *
+ * This function writes the opening brace. Then call the write_...()
+ * functions to add the members and end_object() to close the object.
+ *
+ * \code
+ *     libexcept::json_writer writer(STDOUT_FILENO);
+ *     writer.begin_object();
+ *     writer.write_integer("pid", getpid());
+ *     writer.write_string("command", "/usr/bin/daemon");
+ *     writer.write_boolean("cloexec", false);
+ *     writer.end_object();
+ * \endcode
+ */
+void json_writer::begin_object()
+{
+    append_char('{');
+    f_first_member = true;
+}
+
+
+/** \brief Write a string member.
+ *
+ * The \p value gets escaped as required by JSON.
+ *
+ * \param[in] name  The name of the member.
+ * \param[in] value  The value of the member.
+ * \param[in] size  The number of bytes in \p value.
+ */
+void json_writer::write_string(char const * name, char const * value, std::size_t size)
+{
+    append_name(name);
+    append_string(value, size);
+}
+
+
+/** \brief Write a NUL terminated string member.
+ *
+ * \param[in] name  The name of the member.
+ * \param[in] value  The value of the member.
+ */
+void json_writer::write_string(char const * name, char const * value)
+{
+    write_string(name, value, strlen(value));
+}
+
+
+/** \brief Write an integer member.
+ *
+ * \param[in] name  The name of the member.
+ * \param[in] value  The value of the member.
+ */
+void json_writer::write_integer(char const * name, std::int64_t value)
+{
+    append_name(name);
+
+    char digits[24];
+    char * d(digits + sizeof(digits));
+    std::uint64_t v(value < 0 ? -static_cast<std::uint64_t>(value) : value);
+    do
+    {
+        --d;
+        *d = static_cast<char>('0' + v % 10);
+        v /= 10;
+    }
+    while(v != 0);
+    if(value < 0)
+    {
+        --d;
+        *d = '-';
+    }
+    append(d, digits + sizeof(digits) - d);
+}
+
+
+/** \brief Write a Boolean member.
+ *
+ * \param[in] name  The name of the member.
+ * \param[in] value  The value of the member.
+ */
+void json_writer::write_boolean(char const * name, bool value)
+{
+    append_name(name);
+    if(value)
+    {
+        append("true", 4);
+    }
+    else
+    {
+        append("false", 5);
+    }
+}
+
+
+/** \brief Close the current JSON object.
+ *
+ * The object is followed by a newline character, the same as with
+ * write_exception().
+ *
+ * \return true if the whole object was written, false if the output
+ * was truncated or a write to the file descriptor failed.
+ */
+bool json_writer::end_object()
+{
+    append("}\n", 2);
+    return !f_truncated;
+}
+
+
+/** \brief Write the buffered data to the file descriptor.
+ *
+ * In buffer mode, this function does nothing.
+ *
+ * \return true if all the data was written, false otherwise.
+ */
+bool json_writer::flush()
+{
+    if(f_fd == -1)
+    {
+        return !f_truncated;
+    }
+
+    char const * s(f_buffer);
+    while(f_size > 0)
+    {
+        ssize_t const r(::write(f_fd, s, f_size));
+        if(r < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            f_size = 0;
+            f_truncated = true;
+            return false;
+        }
+        s += r;
+        f_size -= r;
+    }
+
+    return !f_truncated;
+}
+
+
+/** \brief Get the number of bytes in the buffer.
+ *
+ * In buffer mode, this is the total number of bytes written so far.
+ * In file descriptor mode, it is the number of bytes not yet flushed.
+ *
+ * \return The number of bytes in the buffer.
+ */
+std::size_t json_writer::get_size() const
+{
+    return f_size;
+}
+
+
+/** \brief Check whether some output was lost.
+ *
+ * In buffer mode, this happens when the buffer is too small. In file
+ * descriptor mode, it happens when write() fails.
+ *
+ * \return true if some of the output was lost.
+ */
+bool json_writer::is_truncated() const
+{
+    return f_truncated;
+}
+
+
+/** \brief Append raw bytes to the output.
+ *
+ * In buffer mode, once the output was truncated, nothing more gets
+ * appended, so the output never has a hole in its middle.
+ *
+ * \param[in] s  The bytes to append.
+ * \param[in] size  The number of bytes to append.
+ */
+void json_writer::append(char const * s, std::size_t size)
+{
+    while(size > 0)
+    {
+        if(f_size >= f_capacity
+        || (f_truncated && f_fd == -1))
+        {
+            if(f_fd == -1)
+            {
+                f_truncated = true;
+                return;
+            }
+            flush();
+        }
+        std::size_t const l(std::min(size, f_capacity - f_size));
+        memcpy(f_buffer + f_size, s, l);
+        f_size += l;
+        s += l;
+        size -= l;
+    }
+}
+
+
+/** \brief Append bytes which cannot be split.
+ *
+ * An escape sequence or a UTF-8 sequence cut in the middle makes the
+ * output invalid. In buffer mode, if the bytes do not all fit, none are
+ * appended and the output is marked as truncated. In file descriptor
+ * mode, the buffer gets flushed first so the bytes end up in the same
+ * write().
+ *
+ * \param[in] s  The bytes to append.
+ * \param[in] size  The number of bytes to append.
+ */
+void json_writer::append_unit(char const * s, std::size_t size)
+{
+    if(f_capacity - f_size < size)
+    {
+        if(f_fd == -1)
+        {
+            f_truncated = true;
+            return;
+        }
+        flush();
+    }
+    append(s, size);
+}
+
+
+/** \brief Append one character to the output.
+ *
+ * \param[in] c  The character to append.
+ */
+void json_writer::append_char(char c)
+{
+    if(f_size < f_capacity
+    && (!f_truncated || f_fd != -1))
+    {
+        f_buffer[f_size] = c;
+        ++f_size;
+    }
+    else
+    {
+        append(&c, 1);
+    }
+}
+
+
+/** \brief Append a JSON string.
+ *
+ * This function adds the quotes and escapes the characters as required
+ * by JSON: the quote, the backslash, and the control characters. Valid
+ * UTF-8 sequences are copied as is. Bytes which are not part of a valid
+ * UTF-8 sequence are each replaced by `\ufffd` (the replacement
+ * character) so the output is always valid JSON.
+ *
+ * If the output gets truncated, it is cut between two characters, never
+ * inside an escape or a UTF-8 sequence.
+ *
+ * \param[in] s  The string to append.
+ * \param[in] size  The number of bytes in \p s.
+ */
+void json_writer::append_string(char const * s, std::size_t size)
+{
+    append_char('"');
+    char const * e(s + size);
+    char const * start(s);
+    while(s < e)
+    {
+        unsigned char const c(*s);
+        if(c >= 0x20
+        && c < 0x80
+        && c != '"'
+        && c != '\\')
+        {
+            ++s;
+            continue;
+        }
+        append(start, s - start);
+
+        if(c >= 0x80)
+        {
+            std::size_t const l(utf8_sequence_length(
+                      reinterpret_cast<unsigned char const *>(s)
+                    , reinterpret_cast<unsigned char const *>(e)));
+            if(l == 0)
+            {
+                append_unit("\\ufffd", 6);
+                ++s;
+            }
+            else
+            {
+                append_unit(s, l);
+                s += l;
+            }
+            start = s;
+            continue;
+        }
+        ++s;
+        start = s;
+
+        char escape[6] = { '\\', '\0' };
+        switch(c)
+        {
+        case '"':  escape[1] = '"';  break;
+        case '\\': escape[1] = '\\'; break;
+        case '\b': escape[1] = 'b';  break;
+        case '\f': escape[1] = 'f';  break;
+        case '\n': escape[1] = 'n';  break;
+        case '\r': escape[1] = 'r';  break;
+        case '\t': escape[1] = 't';  break;
+
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = g_hex[c >> 4];
+            escape[5] = g_hex[c & 15];
+            append_unit(escape, 6);
+            continue;
+
+        }
+        append_unit(escape, 2);
+    }
+    append(start, s - start);
+    append_char('"');
+}
+
+
+/** \brief Append a NUL terminated JSON string.
+ *
+ * \param[in] s  The string to append.
+ */
+void json_writer::append_string(char const * s)
+{
+    append_string(s, strlen(s));
+}
+
+
+/** \brief Append the name of a member.
+ *
+ * The name is preceded by a comma unless it is the first member of
+ * the object.
+ *
+ * \param[in] name  The name of the member.
+ */
+void json_writer::append_name(char const * name)
+{
+    if(!f_first_member)
+    {
+        append_char(',');
+    }
+    f_first_member = false;
+    append_string(name);
+    append_char(':');
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
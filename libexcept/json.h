@@ -0,0 +1,88 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// C++
+//
+#include    <cstddef>
+#include    <cstdint>
+#include    <exception>
+
+
+
+/** \file
+ * \brief Declarations of the JSON exception writer.
+ *
+ * This file defines a class used to write exceptions, or other flat
+ * records, as JSON objects to a buffer or a file descriptor.
+ */
+
+
+namespace libexcept
+{
+
+
+constexpr std::size_t const     JSON_WRITER_BUFFER_SIZE = 4096;
+
+
+class json_writer
+{
+public:
+                                json_writer(char * buffer, std::size_t size);
+    explicit                    json_writer(int fd);
+                                json_writer(json_writer const &) = delete;
+                                ~json_writer();
+
+    json_writer &               operator = (json_writer const &) = delete;
+
+    bool                        write_exception(std::exception const & e);
+    void                        begin_object();
+    void                        write_string(char const * name, char const * value, std::size_t size);
+    void                        write_string(char const * name, char const * value);
+    void                        write_integer(char const * name, std::int64_t value);
+    void                        write_boolean(char const * name, bool value);
+    bool                        end_object();
+    bool                        flush();
+
+    std::size_t                 get_size() const;
+    bool                        is_truncated() const;
+
+private:
+    void                        append(char const * s, std::size_t size);
+    void                        append_unit(char const * s, std::size_t size);
+    void                        append_char(char c);
+    void                        append_string(char const * s, std::size_t size);
+    void                        append_string(char const * s);
+    void                        append_name(char const * name);
+
+    int                         f_fd = -1;
+    char *                      f_buffer = nullptr;
+    std::size_t                 f_capacity = 0;
+    std::size_t                 f_size = 0;
+    bool                        f_truncated = false;
+    bool                        f_first_member = true;
+    char *                      f_demangle_buffer = nullptr;
+    std::size_t                 f_demangle_size = 0;
+    char                        f_fd_buffer[JSON_WRITER_BUFFER_SIZE] = {};
+};
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
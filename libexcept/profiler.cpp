@@ -0,0 +1,730 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/profiler.h"
+
+#include    "libexcept/demangle.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstdio>
+#include    <cstdlib>
+#include    <cstring>
+#include    <map>
+#include    <mutex>
+#include    <sstream>
+#include    <vector>
+
+
+// C
+//
+#include    <dirent.h>
+#include    <dlfcn.h>
+#include    <errno.h>
+#include    <fcntl.h>
+#include    <execinfo.h>
+#include    <sched.h>
+#include    <signal.h>
+#include    <sys/mman.h>
+#include    <time.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the sampling profiler.
+ *
+ * The profiler creates one POSIX timer per thread, each measuring the
+ * CPU time of its thread (the thread CPU clock) and sending SIGPROF to
+ * that very thread (SIGEV_THREAD_ID). The threads therefore get sampled
+ * in proportion of the CPU they use. A single process wide timer
+ * (CLOCK_PROCESS_CPUTIME_ID) is not used because kernels before 6.3
+ * deliver its signal to the main thread most of the time, whichever
+ * thread used the processor. The handler saves the raw frames of the
+ * interrupted thread in a sample buffer; it does not resolve any symbol.
+ *
+ * The threads are listed from /proc/self/task when the profiler starts
+ * and again each time it gets drained. A thread created in between is
+ * only sampled after the next drain_profiler().
+ *
+ * There are two sample buffers. The handler reserves a sample in the
+ * active buffer with an atomic increment, so it never takes a lock.
+ * drain_profiler() makes the other buffer active, waits for the
+ * handlers still writing to the previous one, and aggregates its
+ * samples. The profiler can therefore be drained while running. When
+ * the active buffer is full, new samples are dropped and counted. The
+ * handlers also count themselves before checking that the profiler is
+ * running, so once stopped, the buffers can be unmapped as soon as that
+ * count drops to zero.
+ *
+ * The output is in the folded stack format: one line per distinct
+ * stack, the frames from the root to the leaf separated by semicolons,
+ * followed by a space and the number of samples. This is the input
+ * format of the flame graph tools:
+ *
+ * \code
+ *     libexcept::start_profiler();
+ *     ...
+ *     std::ofstream out("profile.folded");
+ *     libexcept::drain_profiler(out);
+ *
+ *     // then: flamegraph.pl profile.folded > profile.svg
+ * \endcode
+ */
+
+
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id  _sigev_un._tid
+#endif
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+struct sample_t
+{
+    std::atomic<bool>           f_ready = false;
+    pid_t                       f_tid = 0;
+    int                         f_frame_count = 0;
+    void *                      f_frames[PROFILER_FRAMES] = {};
+};
+
+
+struct buffer_t
+{
+    std::atomic<sample_t *>     f_samples = nullptr;
+    std::atomic<std::size_t>    f_next = 0;
+    std::atomic<int>            f_writers = 0;
+};
+
+
+std::mutex                      g_profiler_mutex = std::mutex();
+buffer_t                        g_buffers[2] = {};
+std::atomic<std::size_t>        g_capacity = 0;
+std::atomic<int>                g_active = 0;
+std::atomic<bool>               g_running = false;
+std::atomic<int>                g_handlers = 0;
+std::atomic<std::uint64_t>      g_dropped = 0;
+bool                            g_handler_installed = false;
+int                             g_frequency = 0;
+struct thread_timer_t
+{
+    std::uint64_t               f_start_time = 0;
+    timer_t                     f_timer = timer_t();
+};
+
+
+std::map<pid_t, thread_timer_t> g_timers = std::map<pid_t, thread_timer_t>();
+
+
+/** \brief Save a sample of the interrupted thread.
+ *
+ * The handler first counts itself in g_handlers, then checks whether
+ * the profiler is running. That way, once stop_profiler() cleared
+ * g_running, free_buffers() only has to wait for g_handlers to drop to
+ * zero before it can unmap the buffers.
+ *
+ * After incrementing the number of writers of the active buffer, the
+ * handler checks that the buffer is still the active one. If not,
+ * drain_profiler() may already be reading it so the handler moves to
+ * the new active buffer.
+ */
+void profiler_handler(int sig, siginfo_t * info, void * context)
+{
+    static_cast<void>(sig);
+    static_cast<void>(info);
+
+    int const saved_errno(errno);
+    g_handlers.fetch_add(1);
+    if(g_running.load())
+    {
+        for(;;)
+        {
+            int const active(g_active.load());
+            buffer_t & buffer(g_buffers[active]);
+            buffer.f_writers.fetch_add(1);
+            if(g_active.load() != active)
+            {
+                buffer.f_writers.fetch_sub(1);
+                continue;
+            }
+
+            std::size_t const idx(buffer.f_next.fetch_add(1));
+            if(idx < g_capacity.load())
+            {
+                sample_t & sample(buffer.f_samples.load()[idx]);
+                sample.f_tid = gettid();
+                sample.f_frame_count = collect_signal_frames(context, sample.f_frames, PROFILER_FRAMES);
+                sample.f_ready.store(true, std::memory_order_release);
+            }
+            else
+            {
+                g_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            buffer.f_writers.fetch_sub(1);
+            break;
+        }
+    }
+    g_handlers.fetch_sub(1);
+    errno = saved_errno;
+}
+
+
+void wait_for_writers(buffer_t const & buffer)
+{
+    while(buffer.f_writers.load() != 0)
+    {
+        sched_yield();
+    }
+}
+
+
+/** \brief Release the sample buffers.
+ *
+ * This function must be called while the profiler is stopped. A
+ * handler may still be running (i.e. a signal sent just before the
+ * timers were deleted) so the function waits for all of them to return
+ * before unmapping the buffers.
+ */
+void free_buffers()
+{
+    while(g_handlers.load() != 0)
+    {
+        sched_yield();
+    }
+
+    std::size_t const capacity(g_capacity.exchange(0));
+    for(auto & b : g_buffers)
+    {
+        sample_t * const samples(b.f_samples.exchange(nullptr));
+        if(samples != nullptr)
+        {
+            munmap(samples, capacity * sizeof(sample_t));
+        }
+        b.f_next.store(0);
+    }
+}
+
+
+void allocate_buffers(std::size_t max_samples)
+{
+    for(auto & b : g_buffers)
+    {
+        // mmap() gives us zeroed memory which is a valid array of
+        // samples (f_ready is false)
+        //
+        void * const ptr(mmap(
+                  nullptr
+                , max_samples * sizeof(sample_t)
+                , PROT_READ | PROT_WRITE
+                , MAP_PRIVATE | MAP_ANONYMOUS
+                , -1
+                , 0));
+        if(ptr == MAP_FAILED)
+        {
+            free_buffers();
+            throw profiler_error("could not allocate the profiler sample buffers.");
+        }
+        b.f_samples.store(reinterpret_cast<sample_t *>(ptr));
+        g_capacity.store(max_samples);
+    }
+}
+
+
+/** \brief Get the CPU clock of a thread of this process.
+ *
+ * This is the clock pthread_getcpuclockid() returns, computed from the
+ * thread identifier since we do not have a pthread_t for the threads
+ * found in /proc/self/task.
+ *
+ * \param[in] tid  The thread identifier.
+ *
+ * \return The clock measuring the CPU time used by \p tid.
+ */
+clockid_t thread_cpu_clock(pid_t tid)
+{
+    // same as MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED) in the kernel
+    //
+    return static_cast<clockid_t>((~static_cast<unsigned int>(tid) << 3) | 6);
+}
+
+
+/** \brief Create and arm the timer sampling one thread.
+ *
+ * \param[in] tid  The thread to sample.
+ * \param[out] timer  The new timer.
+ *
+ * \return true if the timer was created and armed.
+ */
+bool create_thread_timer(pid_t tid, timer_t & timer)
+{
+    sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = tid;
+    if(timer_create(thread_cpu_clock(tid), &event, &timer) != 0)
+    {
+        return false;
+    }
+
+    long const interval(1'000'000'000L / g_frequency);
+    itimerspec spec = {};
+    spec.it_interval.tv_sec = interval / 1'000'000'000L;
+    spec.it_interval.tv_nsec = interval % 1'000'000'000L;
+    spec.it_value = spec.it_interval;
+    if(timer_settime(timer, 0, &spec, nullptr) != 0)
+    {
+        timer_delete(timer);
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Get the start time of a thread of this process.
+ *
+ * The thread identifiers get reused. The start time, field 22 of the
+ * /proc/self/task/\<tid>/stat file, tells whether a thread is still the
+ * one for which a timer was created.
+ *
+ * \param[in] tid  The thread identifier.
+ * \param[out] start_time  The start time of the thread in clock ticks.
+ *
+ * \return false if the thread is gone or the file could not be parsed.
+ */
+bool get_thread_start_time(pid_t tid, std::uint64_t & start_time)
+{
+    char filename[64];
+    snprintf(filename, sizeof(filename), "/proc/self/task/%d/stat", tid);
+    int const fd(open(filename, O_RDONLY | O_CLOEXEC));
+    if(fd == -1)
+    {
+        return false;
+    }
+    char buffer[1024];
+    ssize_t const size(read(fd, buffer, sizeof(buffer) - 1));
+    close(fd);
+    if(size <= 0)
+    {
+        return false;
+    }
+    buffer[size] = '\0';
+
+    // the command name (field 2) may include spaces and parenthesis so
+    // we start after the last ')'; the next field is field 3
+    //
+    char const * s(strrchr(buffer, ')'));
+    if(s == nullptr)
+    {
+        return false;
+    }
+    for(int field(2); field < 22; ++field)
+    {
+        s = strchr(s + 1, ' ');
+        if(s == nullptr)
+        {
+            return false;
+        }
+    }
+    start_time = strtoull(s + 1, nullptr, 10);
+    return true;
+}
+
+
+/** \brief Create a timer for each new thread and delete the others.
+ *
+ * The list of threads comes from /proc/self/task. Threads which are
+ * gone get their timer deleted. A thread which exits while its timer
+ * is being created is simply skipped.
+ *
+ * The timers are attached to a thread identifier and its start time.
+ * If a thread exited and its identifier got reused by a new thread,
+ * the start times differ, so the timer of the old thread, which does
+ * not fire anymore, gets replaced by a timer for the new thread.
+ *
+ * \return false if /proc/self/task could not be read.
+ */
+bool update_thread_timers()
+{
+    DIR * d(opendir("/proc/self/task"));
+    if(d == nullptr)
+    {
+        return false;
+    }
+    std::map<pid_t, std::uint64_t> threads;
+    for(dirent const * ent(readdir(d)); ent != nullptr; ent = readdir(d))
+    {
+        if(ent->d_name[0] >= '1'
+        && ent->d_name[0] <= '9')
+        {
+            pid_t const tid(std::atoi(ent->d_name));
+            std::uint64_t start_time(0);
+            if(get_thread_start_time(tid, start_time))
+            {
+                threads[tid] = start_time;
+            }
+        }
+    }
+    closedir(d);
+
+    for(auto it(g_timers.begin()); it != g_timers.end(); )
+    {
+        auto const t(threads.find(it->first));
+        if(t != threads.end()
+        && t->second == it->second.f_start_time)
+        {
+            ++it;
+        }
+        else
+        {
+            timer_delete(it->second.f_timer);
+            it = g_timers.erase(it);
+        }
+    }
+
+    for(auto const & t : threads)
+    {
+        if(g_timers.find(t.first) == g_timers.end())
+        {
+            thread_timer_t timer;
+            timer.f_start_time = t.second;
+            if(create_thread_timer(t.first, timer.f_timer))
+            {
+                g_timers[t.first] = timer;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Delete all the thread timers.
+ */
+void delete_thread_timers()
+{
+    for(auto const & t : g_timers)
+    {
+        timer_delete(t.second.f_timer);
+    }
+    g_timers.clear();
+}
+
+
+/** \brief Get the name of a frame.
+ *
+ * For all the frames except the leaf, the address is a return address
+ * so the symbol is searched at the address minus one, which is part of
+ * the call instruction. That way a call at the very end of a function
+ * is not attributed to the next function.
+ *
+ * \param[in] address  The address of the frame.
+ * \param[in] leaf  Whether this is the interrupted instruction.
+ * \param[in] format  How to name the frame.
+ *
+ * \return The name of the frame.
+ */
+std::string frame_name(void * address, bool leaf, profiler_frame_format_t format)
+{
+    char const * lookup(reinterpret_cast<char const *>(address) - (leaf ? 0 : 1));
+
+    Dl_info info = {};
+    if(dladdr(lookup, &info) == 0
+    || info.dli_fname == nullptr)
+    {
+        std::stringstream ss;
+        ss << "[unknown]+0x" << std::hex << reinterpret_cast<std::uintptr_t>(address);
+        return ss.str();
+    }
+
+    if(format == profiler_frame_format_t::PROFILER_FRAME_FORMAT_SYMBOL
+    && info.dli_sname != nullptr)
+    {
+        return demangle_cpp_name(info.dli_sname);
+    }
+
+    char const * module(strrchr(info.dli_fname, '/'));
+    module = module == nullptr ? info.dli_fname : module + 1;
+    std::stringstream ss;
+    ss << module
+       << "+0x"
+       << std::hex
+       << (reinterpret_cast<std::uintptr_t>(address) - reinterpret_cast<std::uintptr_t>(info.dli_fbase));
+    return ss.str();
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Start sampling the threads of this process.
+ *
+ * This function installs a SIGPROF handler and starts one timer per
+ * thread, each expiring \p frequency times per second of CPU used by
+ * its thread. Each expiration saves the raw frames of that thread.
+ * Nothing gets resolved while sampling so the overhead is limited to
+ * one backtrace() per sample.
+ *
+ * At most \p max_samples samples are kept between two calls to
+ * drain_profiler(). Extra samples are dropped and counted (see
+ * get_profiler_dropped_samples()).
+ *
+ * The default frequency, 99 Hz, avoids sampling in lockstep with code
+ * running at a round frequency.
+ *
+ * \warning
+ * Only the threads which exist when this function gets called are
+ * sampled. A thread created later gets its timer on the next call to
+ * drain_profiler() and its CPU use is not sampled until then. To
+ * profile short lived threads, start the profiler after creating them
+ * or drain it regularly.
+ *
+ * \note
+ * Once installed, the SIGPROF handler stays in place, even after
+ * stop_profiler(), since a signal may still be in flight. It ignores
+ * the signals received while the profiler is stopped.
+ *
+ * \exception profiler_error
+ * Raised if the profiler is already running, if a parameter is out of
+ * range, or if the buffers, the handler, or the timer cannot be set up.
+ *
+ * \param[in] frequency  The number of samples per second of CPU time,
+ * from 1 to 10,000.
+ * \param[in] max_samples  The number of samples kept between drains.
+ */
+void start_profiler(int frequency, std::size_t max_samples)
+{
+    if(frequency < 1
+    || frequency > 10'000)
+    {
+        throw profiler_error("the profiler frequency must be between 1 and 10000.");
+    }
+    if(max_samples == 0)
+    {
+        throw profiler_error("the profiler needs room for at least one sample.");
+    }
+
+    std::lock_guard<std::mutex> lock(g_profiler_mutex);
+
+    if(g_running.load())
+    {
+        throw profiler_error("the profiler is already running.");
+    }
+
+    // the first call to backtrace() loads libgcc which is not signal safe
+    //
+    void * frame(nullptr);
+    backtrace(&frame, 1);
+
+    if(g_capacity.load() != max_samples)
+    {
+        free_buffers();
+        allocate_buffers(max_samples);
+    }
+
+    if(!g_handler_installed)
+    {
+        struct sigaction action = {};
+        action.sa_sigaction = profiler_handler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if(sigaction(SIGPROF, &action, nullptr) != 0)
+        {
+            throw profiler_error("sigaction() failed to install the SIGPROF handler.");
+        }
+        g_handler_installed = true;
+    }
+
+    g_frequency = frequency;
+    g_running.store(true);
+    if(!update_thread_timers()
+    || g_timers.empty())
+    {
+        g_running.store(false);
+        delete_thread_timers();
+        throw profiler_error("could not create the profiler timers.");
+    }
+}
+
+
+/** \brief Stop sampling.
+ *
+ * The timers get deleted. The samples already taken remain available
+ * to drain_profiler().
+ *
+ * Calling this function when the profiler is not running has no effect.
+ */
+void stop_profiler()
+{
+    std::lock_guard<std::mutex> lock(g_profiler_mutex);
+
+    if(!g_running.load())
+    {
+        return;
+    }
+    g_running.store(false);
+    delete_thread_timers();
+}
+
+
+/** \brief Check whether the profiler is running.
+ *
+ * \return true between start_profiler() and stop_profiler().
+ */
+bool is_profiler_running()
+{
+    return g_running.load();
+}
+
+
+/** \brief Write the samples taken so far as folded stacks.
+ *
+ * This function takes the samples saved since the last drain,
+ * aggregates them by stack, and writes one line per distinct stack to
+ * \p out. The samples are aggregated by address first so each address
+ * gets resolved only once.
+ *
+ * With PROFILER_FRAME_FORMAT_OFFSET, each frame is written as the name
+ * of its module followed by the offset in that module (i.e.
+ * `libfoo.so+0x1a2b`). Such output can be symbolized later, on another
+ * computer, with addr2line. With PROFILER_FRAME_FORMAT_SYMBOL, the frames
+ * with a dynamic symbol are written as the demangled name of the
+ * function, the others as with PROFILER_FRAME_FORMAT_OFFSET. Executables
+ * need to be linked with `-rdynamic` for their functions to be named.
+ *
+ * The profiler can be drained while running. In that case, the threads
+ * created since the last call get their own timer so they get sampled
+ * from now on.
+ *
+ * \param[in] out  The stream receiving the folded stacks.
+ * \param[in] format  How to name the frames.
+ *
+ * \return The number of samples written.
+ */
+std::size_t drain_profiler(std::ostream & out, profiler_frame_format_t format)
+{
+    std::lock_guard<std::mutex> lock(g_profiler_mutex);
+
+    std::size_t const capacity(g_capacity.load());
+    if(capacity == 0)
+    {
+        return 0;
+    }
+
+    // sample the threads created since the last call
+    //
+    if(g_running.load())
+    {
+        update_thread_timers();
+    }
+
+    int const previous(g_active.load());
+    g_active.store(previous ^ 1);
+    buffer_t & buffer(g_buffers[previous]);
+    wait_for_writers(buffer);
+
+    std::size_t const count(std::min(buffer.f_next.load(), capacity));
+    sample_t * const samples(buffer.f_samples.load());
+    std::map<std::vector<void *>, std::size_t> by_address;
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        sample_t & sample(samples[idx]);
+        if(!sample.f_ready.load(std::memory_order_acquire))
+        {
+            continue;
+        }
+        ++by_address[std::vector<void *>(sample.f_frames, sample.f_frames + sample.f_frame_count)];
+        sample.f_ready.store(false, std::memory_order_relaxed);
+    }
+    buffer.f_next.store(0);
+
+    // different addresses may have the same name (i.e. two addresses in
+    // the same function with PROFILER_FRAME_FORMAT_SYMBOL)
+    //
+    std::map<void *, std::string> leaf_names;
+    std::map<void *, std::string> caller_names;
+    std::map<std::string, std::size_t> folded;
+    std::size_t total(0);
+    for(auto const & stack : by_address)
+    {
+        std::string line;
+        for(std::size_t idx(stack.first.size()); idx > 0; --idx)
+        {
+            void * const address(stack.first[idx - 1]);
+            bool const leaf(idx == 1);
+            auto & names(leaf ? leaf_names : caller_names);
+            auto it(names.find(address));
+            if(it == names.end())
+            {
+                it = names.emplace(address, frame_name(address, leaf, format)).first;
+            }
+            if(!line.empty())
+            {
+                line += ';';
+            }
+            line += it->second;
+        }
+        folded[line] += stack.second;
+        total += stack.second;
+    }
+
+    for(auto const & f : folded)
+    {
+        out << f.first << ' ' << f.second << '\n';
+    }
+
+    return total;
+}
+
+
+/** \brief Get the number of samples dropped so far.
+ *
+ * A sample gets dropped when the buffer is full, meaning that
+ * drain_profiler() was not called often enough for the frequency and
+ * the number of samples specified to start_profiler().
+ *
+ * \return The number of samples dropped since the process started.
+ */
+std::uint64_t get_profiler_dropped_samples()
+{
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
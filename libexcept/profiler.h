@@ -0,0 +1,75 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/thread_stacks.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <cstdint>
+#include    <iostream>
+
+
+
+/** \file
+ * \brief Declarations of the sampling profiler.
+ *
+ * This file defines the functions used to sample the stacks of the
+ * running threads with SIGPROF and to write the result as folded
+ * stacks, the input format of flame graph tools.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(profiler_error);
+
+
+constexpr int const             PROFILER_DEFAULT_FREQUENCY = 99;
+constexpr std::size_t const     PROFILER_DEFAULT_SAMPLES = 4096;
+constexpr std::size_t const     PROFILER_FRAMES = THREAD_STACKS_FRAMES;
+
+
+enum class profiler_frame_format_t
+{
+    PROFILER_FRAME_FORMAT_OFFSET,       // module+0x1234
+    PROFILER_FRAME_FORMAT_SYMBOL,       // demangled function name if available
+};
+
+
+void                            start_profiler(
+                                          int frequency = PROFILER_DEFAULT_FREQUENCY
+                                        , std::size_t max_samples = PROFILER_DEFAULT_SAMPLES);
+void                            stop_profiler();
+bool                            is_profiler_running();
+std::size_t                     drain_profiler(
+                                          std::ostream & out
+                                        , profiler_frame_format_t format = profiler_frame_format_t::PROFILER_FRAME_FORMAT_SYMBOL);
+std::uint64_t                   get_profiler_dropped_samples();
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
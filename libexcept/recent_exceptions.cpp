@@ -0,0 +1,372 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/recent_exceptions.h"
+
+#include    "libexcept/crash_journal.h"
+#include    "libexcept/signal_safe_writer.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstdint>
+#include    <cstring>
+#include    <typeinfo>
+
+
+// C
+//
+#include    <execinfo.h>
+#include    <time.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the recent exceptions recorder.
+ *
+ * When a daemon crashes, the exceptions it raised just before are often
+ * the best hint about what went wrong. This file implements a recorder
+ * which saves the last few exceptions of each thread in a ring buffer
+ * and a function to dump those rings from a signal handler.
+ *
+ * The rings are allocated in a static pool. A thread gets a ring the
+ * first time it records an exception and releases it when it exits.
+ * The entries of a released ring remain available to the dump until
+ * another thread reuses that ring. Only the owner writes to a ring so
+ * no lock is necessary. Each entry has a sequence number which is odd
+ * while the entry is being written so the dump can skip entries which
+ * are not complete.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+struct entry_t
+{
+    std::atomic<std::uint32_t>  f_sequence = 0;
+    pid_t                       f_tid = 0;
+    char const *                f_type = nullptr;
+    timespec                    f_time = timespec();
+    int                         f_frame_count = 0;
+    void *                      f_frames[RECENT_EXCEPTION_FRAMES] = {};
+    char                        f_message[RECENT_EXCEPTION_MESSAGE_SIZE] = {};
+};
+
+
+struct ring_t
+{
+    std::atomic<pid_t>          f_owner = 0;
+    std::atomic<std::uint32_t>  f_next = 0;
+    entry_t                     f_entries[RECENT_EXCEPTIONS_PER_THREAD] = {};
+};
+
+
+ring_t                          g_rings[RECENT_EXCEPTIONS_THREADS] = {};
+std::atomic<bool>               g_record_exceptions = false;
+
+
+class thread_ring
+{
+public:
+    ~thread_ring()
+    {
+        if(f_ring != nullptr)
+        {
+            f_ring->f_owner.store(0, std::memory_order_release);
+        }
+    }
+
+    ring_t * get()
+    {
+        if(f_ring == nullptr
+        && !f_full)
+        {
+            pid_t const tid(gettid());
+            for(auto & r : g_rings)
+            {
+                pid_t expected(0);
+                if(r.f_owner.compare_exchange_strong(expected, tid))
+                {
+                    f_ring = &r;
+                    return f_ring;
+                }
+            }
+
+            // all the rings are in use, do not try again on each exception
+            //
+            f_full = true;
+        }
+
+        return f_ring;
+    }
+
+private:
+    ring_t *                    f_ring = nullptr;
+    bool                        f_full = false;
+};
+
+
+thread_local thread_ring        g_thread_ring;
+thread_local std::exception const *
+                                g_last_exception = nullptr;
+thread_local entry_t *          g_last_entry = nullptr;
+
+
+
+} // no name namespace
+
+
+
+/** \brief Turn the recording of exceptions on or off.
+ *
+ * By default, exceptions are not recorded. Once this function is called
+ * with true, each libexcept exception gets saved in a ring buffer owned
+ * by the thread creating it. On a crash, the report_signal() handler
+ * dumps those rings.
+ *
+ * The recording saves the type, the first RECENT_EXCEPTION_MESSAGE_SIZE - 1
+ * characters of the message, the time, and the innermost
+ * RECENT_EXCEPTION_FRAMES frames (raw addresses). Nothing gets allocated
+ * and no lock is used so it can remain turned on in production.
+ *
+ * \param[in] record  Whether to record exceptions.
+ *
+ * \sa dump_recent_exceptions()
+ */
+void set_record_exceptions(bool record)
+{
+    g_record_exceptions.store(record, std::memory_order_relaxed);
+}
+
+
+/** \brief Check whether exceptions are being recorded.
+ *
+ * \return true if the exceptions get recorded.
+ */
+bool get_record_exceptions()
+{
+    return g_record_exceptions.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Record an exception in the ring of the current thread.
+ *
+ * The libexcept exceptions call this function from their constructor.
+ * You can also call it for other exceptions you catch.
+ *
+ * If a crash journal is open, the exception is also saved in that
+ * journal (see open_crash_journal()).
+ *
+ * If the recording is turned off or all the rings are already in use
+ * by other threads, the function returns immediately.
+ *
+ * \param[in] e  The exception to record.
+ */
+void record_exception(std::exception const & e)
+{
+    journal_exception(e);
+
+    g_last_exception = &e;
+    g_last_entry = nullptr;
+
+    if(!g_record_exceptions.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    ring_t * ring(g_thread_ring.get());
+    if(ring == nullptr)
+    {
+        return;
+    }
+
+    std::uint32_t const next(ring->f_next.load(std::memory_order_relaxed));
+    entry_t & entry(ring->f_entries[next % RECENT_EXCEPTIONS_PER_THREAD]);
+
+    std::uint32_t const sequence(entry.f_sequence.load(std::memory_order_relaxed));
+    entry.f_sequence.store(sequence | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.f_tid = ring->f_owner.load(std::memory_order_relaxed);
+    entry.f_type = typeid(e).name();
+    clock_gettime(CLOCK_REALTIME, &entry.f_time);
+    strncpy(entry.f_message, e.what(), sizeof(entry.f_message) - 1);
+    entry.f_message[sizeof(entry.f_message) - 1] = '\0';
+    entry.f_frame_count = backtrace(entry.f_frames, RECENT_EXCEPTION_FRAMES);
+
+    entry.f_sequence.store((sequence | 1) + 1, std::memory_order_release);
+    ring->f_next.store(next + 1, std::memory_order_relaxed);
+
+    g_last_entry = &entry;
+}
+
+
+/** \brief Fix the type of the last recorded exception.
+ *
+ * The base class constructors call record_exception(), at which point
+ * typeid() returns the base class and not the type being constructed.
+ * The constructors of the classes created by the DECLARE_...() macros
+ * call this function once the object has its final type so the entry
+ * gets updated instead of showing the base class name.
+ *
+ * The update only happens if \p e is the last exception recorded by this
+ * thread and the recorded message matches. Otherwise nothing happens.
+ *
+ * The name saved in the crash journal gets fixed the same way.
+ *
+ * \param[in] e  The exception which was just recorded.
+ */
+void record_exception_type(std::exception const & e)
+{
+    record_exception_type(e, typeid(e));
+}
+
+
+/** \brief Fix the type of the last recorded exception.
+ *
+ * This function is the same as record_exception_type(std::exception const &)
+ * except that the type is given explicitly. This is used by the classes
+ * created by DECLARE_EXCEPTION() which fix the type from a base class
+ * constructor, before \p e has its final type.
+ *
+ * \param[in] e  The exception which was just recorded.
+ * \param[in] type  The final type of \p e.
+ */
+void record_exception_type(std::exception const & e, std::type_info const & type)
+{
+    journal_exception_type(e, type);
+
+    if(g_last_exception != &e
+    || g_last_entry == nullptr
+    || strncmp(g_last_entry->f_message, e.what(), sizeof(g_last_entry->f_message) - 1) != 0)
+    {
+        return;
+    }
+
+    entry_t & entry(*g_last_entry);
+    std::uint32_t const sequence(entry.f_sequence.load(std::memory_order_relaxed));
+    entry.f_sequence.store(sequence | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.f_type = type.name();
+
+    entry.f_sequence.store((sequence | 1) + 1, std::memory_order_release);
+}
+
+
+/** \brief Write the recorded exceptions to a file descriptor.
+ *
+ * This function writes the exceptions found in all the rings, from the
+ * oldest to the newest for each thread. It only uses async-signal-safe
+ * functions so it can be called from a signal handler. The type is the
+ * mangled name since demangling allocates memory.
+ *
+ * The output looks like this:
+ *
+ * \code
+ *     recent exception: tid=123 time=1700000000.123456789 type=N9libexcept11exception_tE message="..."
+ *       frame 0x7f3d5f4b1a2c
+ *       ...
+ * \endcode
+ *
+ * Entries being written at the time the dump happens are skipped.
+ *
+ * \param[in] fd  The file descriptor where the dump gets written.
+ */
+void dump_recent_exceptions(int fd)
+{
+    signal_safe_writer out(fd);
+
+    for(auto const & ring : g_rings)
+    {
+        std::uint32_t const next(ring.f_next.load(std::memory_order_acquire));
+        std::uint32_t const count(std::min<std::uint32_t>(next, RECENT_EXCEPTIONS_PER_THREAD));
+        for(std::uint32_t idx(next - count); idx != next; ++idx)
+        {
+            entry_t const & entry(ring.f_entries[idx % RECENT_EXCEPTIONS_PER_THREAD]);
+
+            std::uint32_t const sequence(entry.f_sequence.load(std::memory_order_acquire));
+            if(sequence == 0
+            || (sequence & 1) != 0)
+            {
+                continue;
+            }
+
+            pid_t const tid(entry.f_tid);
+            char const * type(entry.f_type);
+            timespec const time(entry.f_time);
+            int const frame_count(std::min<int>(entry.f_frame_count, RECENT_EXCEPTION_FRAMES));
+            void * frames[RECENT_EXCEPTION_FRAMES];
+            memcpy(frames, entry.f_frames, sizeof(frames));
+            char message[RECENT_EXCEPTION_MESSAGE_SIZE];
+            memcpy(message, entry.f_message, sizeof(message));
+            message[sizeof(message) - 1] = '\0';
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(entry.f_sequence.load(std::memory_order_relaxed) != sequence)
+            {
+                continue;
+            }
+
+            out.append("recent exception: tid=");
+            out.append_decimal(tid);
+            out.append(" time=");
+            out.append_decimal(time.tv_sec);
+            out.append(".");
+            char nsec[10];
+            long n(time.tv_nsec);
+            for(int i(8); i >= 0; --i)
+            {
+                nsec[i] = '0' + n % 10;
+                n /= 10;
+            }
+            out.append(nsec, 9);
+            out.append(" type=");
+            out.append(type == nullptr ? "<unknown>" : type);
+            out.append(" message=\"");
+            out.append(message);
+            out.append("\"\n");
+            for(int f(0); f < frame_count; ++f)
+            {
+                out.append("  frame ");
+                out.append_hex(reinterpret_cast<std::uintptr_t>(frames[f]));
+                out.append("\n");
+            }
+        }
+    }
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
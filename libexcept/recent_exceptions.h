@@ -0,0 +1,58 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// C++
+//
+#include    <cstddef>
+#include    <exception>
+#include    <typeinfo>
+
+
+
+/** \file
+ * \brief Declarations of the recent exceptions recorder.
+ *
+ * This file defines the functions used to record the exceptions created
+ * by each thread in a ring buffer and to dump those rings, generally on
+ * a crash.
+ */
+
+
+namespace libexcept
+{
+
+
+constexpr std::size_t const     RECENT_EXCEPTIONS_THREADS = 128;
+constexpr std::size_t const     RECENT_EXCEPTIONS_PER_THREAD = 16;
+constexpr std::size_t const     RECENT_EXCEPTION_MESSAGE_SIZE = 80;
+constexpr std::size_t const     RECENT_EXCEPTION_FRAMES = 8;
+
+
+void                            set_record_exceptions(bool record);
+bool                            get_record_exceptions();
+void                            record_exception(std::exception const & e);
+void                            record_exception_type(std::exception const & e);
+void                            record_exception_type(std::exception const & e, std::type_info const & type);
+void                            dump_recent_exceptions(int fd);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -21,11 +21,16 @@
 //
 #include    "libexcept/report_signal.h"
 
+#include    "libexcept/crash_journal.h"
+#include    "libexcept/recent_exceptions.h"
+#include    "libexcept/signal_safe_writer.h"
 #include    "libexcept/stack_trace.h"
+#include    "libexcept/thread_stacks.h"
 
 
 // C++
 //
+#include    <atomic>
 #include    <cstdint>
 #include    <iostream>
 #include    <memory>
@@ -33,7 +38,13 @@
 
 // C
 //
+#include    <errno.h>
+#include    <execinfo.h>
+#include    <fcntl.h>
 #include    <signal.h>
+#include    <sys/syscall.h>
+#include    <sys/ucontext.h>
+#include    <unistd.h>
 
 
 /** \file
@@ -43,6 +54,19 @@
  * signals such as SEGV. This allows your software to report the stack trace
  * even in a release version.
  *
+ * If a crash journal is open (see open_crash_journal()), the crash is
+ * first saved in that journal.
+ *
+ * Optionally, the handler also writes a crash report to a file descriptor
+ * opened ahead of time (see set_crash_report_fd()). That report includes
+ * the signal information, the registers, the list of threads, the memory
+ * maps and the raw stack frames. It is written using only async-signal-safe
+ * functions.
+ *
+ * Most crashes caused by races are better understood by looking at the
+ * other threads. If init_thread_stacks() was called, the handler also
+ * dumps the stacks of all the other threads (see dump_thread_stacks()).
+ *
  * \note
  * If you can link against the eventdispatcher library too, you should instead
  * consider using that library signal handlers.
@@ -62,15 +86,223 @@ typedef struct sigaction                sigaction_t;
 typedef std::shared_ptr<sigaction_t>    sigaction_ptr_t;
 
 sigaction_ptr_t             g_signal_actions[64] = {};
+std::atomic<int>            g_crash_report_fd = -1;
+
+
+struct register_name_t
+{
+    char const *        f_name = nullptr;
+    int                 f_index = 0;
+};
+
+
+#if defined(__x86_64__)
+constexpr register_name_t const g_registers[] =
+{
+    { "rax", REG_RAX },
+    { "rbx", REG_RBX },
+    { "rcx", REG_RCX },
+    { "rdx", REG_RDX },
+    { "rsi", REG_RSI },
+    { "rdi", REG_RDI },
+    { "rbp", REG_RBP },
+    { "rsp", REG_RSP },
+    { "r8", REG_R8 },
+    { "r9", REG_R9 },
+    { "r10", REG_R10 },
+    { "r11", REG_R11 },
+    { "r12", REG_R12 },
+    { "r13", REG_R13 },
+    { "r14", REG_R14 },
+    { "r15", REG_R15 },
+    { "rip", REG_RIP },
+    { "eflags", REG_EFL },
+    { "err", REG_ERR },
+    { "trapno", REG_TRAPNO },
+    { "cr2", REG_CR2 },
+};
+#endif
+
+
+void write_registers(signal_safe_writer & out, void * context)
+{
+    if(context == nullptr)
+    {
+        return;
+    }
+    ucontext_t const * uc(reinterpret_cast<ucontext_t const *>(context));
+
+#if defined(__x86_64__)
+    for(auto const & r : g_registers)
+    {
+        out.append("register ");
+        out.append(r.f_name);
+        out.append("=");
+        out.append_hex(uc->uc_mcontext.gregs[r.f_index]);
+        out.append("\n");
+    }
+#elif defined(__aarch64__)
+    for(std::size_t idx(0); idx < std::size(uc->uc_mcontext.regs); ++idx)
+    {
+        out.append("register x");
+        out.append_decimal(idx);
+        out.append("=");
+        out.append_hex(uc->uc_mcontext.regs[idx]);
+        out.append("\n");
+    }
+    out.append("register sp=");
+    out.append_hex(uc->uc_mcontext.sp);
+    out.append("\nregister pc=");
+    out.append_hex(uc->uc_mcontext.pc);
+    out.append("\nregister pstate=");
+    out.append_hex(uc->uc_mcontext.pstate);
+    out.append("\n");
+#else
+    static_cast<void>(uc);
+    out.append("register unsupported\n");
+#endif
+}
+
+
+void write_threads(signal_safe_writer & out)
+{
+    // opendir() allocates memory, so read the directory with getdents64
+    //
+    struct linux_dirent64_t
+    {
+        ino64_t         d_ino;
+        off64_t         d_off;
+        unsigned short  d_reclen;
+        unsigned char   d_type;
+        char            d_name[];
+    };
+
+    int const dir(open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(dir < 0)
+    {
+        return;
+    }
+    alignas(linux_dirent64_t) char buf[1024];
+    for(;;)
+    {
+        long const r(syscall(SYS_getdents64, dir, buf, sizeof(buf)));
+        if(r <= 0)
+        {
+            break;
+        }
+        for(long pos(0); pos < r;)
+        {
+            linux_dirent64_t const * ent(reinterpret_cast<linux_dirent64_t const *>(buf + pos));
+            pos += ent->d_reclen;
+            if(ent->d_name[0] != '.')
+            {
+                out.append("thread ");
+                out.append(ent->d_name);
+                out.append("\n");
+            }
+        }
+    }
+    close(dir);
+}
+
+
+void write_maps(signal_safe_writer & out)
+{
+    int const maps(open("/proc/self/maps", O_RDONLY | O_CLOEXEC));
+    if(maps < 0)
+    {
+        return;
+    }
+    out.append("maps:\n");
+    char buf[1024];
+    for(;;)
+    {
+        ssize_t const r(read(maps, buf, sizeof(buf)));
+        if(r <= 0)
+        {
+            if(r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        out.append(buf, r);
+    }
+    close(maps);
+    out.append("end maps\n");
+}
+
+
+void write_crash_report(
+          int fd
+        , int sig
+        , siginfo_t * info
+        , void * context
+        , void * const * frames
+        , int frame_count)
+{
+    signal_safe_writer out(fd);
+
+    out.append("crash: signal=");
+    out.append_decimal(sig);
+    out.append(" pid=");
+    out.append_decimal(getpid());
+    out.append(" tid=");
+    out.append_decimal(gettid());
+    out.append("\n");
+
+    if(info != nullptr)
+    {
+        out.append("code=");
+        out.append_decimal(info->si_code);
+        out.append(" errno=");
+        out.append_decimal(info->si_errno);
+        out.append(" fault_address=");
+        out.append_hex(reinterpret_cast<std::uintptr_t>(info->si_addr));
+        out.append("\n");
+    }
+
+    write_registers(out, context);
+    write_threads(out);
+    write_maps(out);
+
+    for(int idx(0); idx < frame_count; ++idx)
+    {
+        out.append("frame ");
+        out.append_hex(reinterpret_cast<std::uintptr_t>(frames[idx]));
+        out.append("\n");
+    }
+
+    out.flush();
+    dump_thread_stacks(fd);
+
+    if(get_record_exceptions())
+    {
+        out.flush();
+        dump_recent_exceptions(fd);
+    }
+
+    out.append("end crash\n");
+}
+
 
 void report_signal(
           int sig
         , siginfo_t * info
         , void * context)
 {
-    // unused parameters
-    static_cast<void>(info);
-    static_cast<void>(context);
+    void * frames[STACK_TRACE_DEPTH * 5];
+    int const frame_count(backtrace(frames, std::size(frames)));
+
+    // the journal comes first since it is the most likely to survive
+    //
+    journal_crash(sig, info, frames, frame_count);
+
+    int const fd(g_crash_report_fd.load());
+    if(fd != -1)
+    {
+        write_crash_report(fd, sig, info, context, frames, frame_count);
+    }
 
     auto const trace(collect_stack_trace());
     for(auto const & stack_line : trace)
@@ -83,6 +315,15 @@ void report_signal(
             << "\n";
     }
 
+    if(fd == -1)
+    {
+        dump_thread_stacks(STDERR_FILENO);
+        if(get_record_exceptions())
+        {
+            dump_recent_exceptions(STDERR_FILENO);
+        }
+    }
+
     // Abort
     //
     abort();
@@ -110,9 +351,17 @@ void report_signal(
  *
  * \warning
  * This code is not thread safe.
+ *
+ * \sa set_crash_report_fd()
  */
 void init_report_signal()
 {
+    // the first call to backtrace() loads libgcc which is not signal safe
+    // so make sure that happens now instead of in the signal handler
+    //
+    void * frame(nullptr);
+    backtrace(&frame, 1);
+
     constexpr std::int64_t sigs(
               (1 << SIGHUP)
             | (1 << SIGILL)
@@ -136,6 +385,54 @@ void init_report_signal()
 }
 
 
+/** \brief Request a crash report to be written to a file.
+ *
+ * When one of the signals captured by init_report_signal() is received,
+ * the handler writes a crash report to \p fd. The report is a text file
+ * with the following information:
+ *
+ * \li the signal number, process and thread identifiers;
+ * \li the signal code and fault address (from the `siginfo_t`);
+ * \li the registers found in the `ucontext` (x86_64 and aarch64);
+ * \li the identifiers of all the threads of the process;
+ * \li a copy of `/proc/self/maps`, required to convert the frames
+ *     to module offsets;
+ * \li the raw frame addresses of the crashing thread;
+ * \li the raw frame addresses of the other threads if
+ *     init_thread_stacks() was called;
+ * \li the recent exceptions if set_record_exceptions() was turned on.
+ *
+ * The file descriptor must be opened before the crash since opening a
+ * file from a signal handler is not a good idea (the file system may
+ * not be the problem, but the path may have to be computed...) The
+ * report only uses async-signal-safe functions (write(), read(), etc.)
+ *
+ * The report gets appended at the current position of \p fd. Opening
+ * the file with `O_APPEND` is a good idea if multiple processes share
+ * the file.
+ *
+ * The library does not take ownership of \p fd. Use -1 to stop writing
+ * crash reports.
+ *
+ * \param[in] fd  The file descriptor where the crash report gets written
+ * or -1.
+ */
+void set_crash_report_fd(int fd)
+{
+    g_crash_report_fd.store(fd);
+}
+
+
+/** \brief Retrieve the crash report file descriptor.
+ *
+ * \return The file descriptor set with set_crash_report_fd() or -1.
+ */
+int get_crash_report_fd()
+{
+    return g_crash_report_fd.load();
+}
+
+
 
 }
 // namespace libexcept
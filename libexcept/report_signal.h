@@ -39,6 +39,8 @@ namespace libexcept
 
 
 void     init_report_signal();
+void     set_crash_report_fd(int fd);
+int      get_crash_report_fd();
 
 
 }
@@ -26,12 +26,14 @@
 
 // C++
 //
+#include    <atomic>
 #include    <iostream>
 
 
 // C
 //
 #include    <dlfcn.h>
+#include    <pthread.h>
 #include    <signal.h>
 
 
@@ -39,6 +41,13 @@
  * \brief Handle sigmask in a scoped manner (RAII).
  *
  * This class is used to manage the signal mask in a scoped manner.
+ *
+ * Blocking signals costs two system calls per scope. For signals which
+ * libexcept manages (see set_lazy_signal_handler()), the scope can
+ * instead be lazy: entering it only marks the signals as deferred in a
+ * thread local mask. If such a signal arrives while deferred, the
+ * libexcept handler records it as pending and returns. Leaving the scope
+ * calls the handler of each pending signal.
  */
 
 
@@ -53,7 +62,7 @@ namespace
 
 
 
-constexpr int const g_incompatible_signals[] = {
+constexpr signal_set_t const g_incompatible_signals{
     SIGHUP,
     SIGINT,
     SIGILL,
@@ -70,8 +79,82 @@ constexpr int const g_incompatible_signals[] = {
 };
 
 
-bool g_has_sanitizer_defined = false;
-bool g_has_sanitizer = false;
+// signals which cannot be deferred: the synchronous ones would be
+// raised again as soon as the handler returns
+//
+constexpr signal_set_t const g_non_deferrable_signals{
+    SIGILL,
+    SIGTRAP,
+    SIGBUS,
+    SIGFPE,
+    SIGKILL,
+    SIGSEGV,
+    SIGSTOP,
+};
+
+
+std::atomic<lazy_signal_handler_t>  g_lazy_handlers[65] = {};
+struct sigaction                    g_lazy_previous_actions[65] = {};
+std::atomic<std::uint64_t>          g_lazy_signals = 0;
+thread_local std::atomic<std::uint64_t> g_lazy_mask = 0;
+thread_local std::atomic<std::uint64_t> g_lazy_pending = 0;
+
+
+/** \brief Call the handlers of the pending signals which are not deferred.
+ *
+ * While a handler runs, its signal is deferred so a new occurrence
+ * does not recursively call the same handler. It gets called again
+ * once the handler returns.
+ */
+void replay_pending_signals()
+{
+    for(;;)
+    {
+        std::uint64_t const mask(g_lazy_mask.load(std::memory_order_relaxed));
+        std::uint64_t const ready(g_lazy_pending.fetch_and(mask) & ~mask);
+        if(ready == 0)
+        {
+            return;
+        }
+        for(std::uint64_t bits(ready); bits != 0; bits &= bits - 1)
+        {
+            int const sig(__builtin_ctzll(bits) + 1);
+            lazy_signal_handler_t const handler(g_lazy_handlers[sig].load());
+            if(handler != nullptr)
+            {
+                g_lazy_mask.store(mask | (std::uint64_t(1) << (sig - 1)), std::memory_order_relaxed);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                handler(sig);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                g_lazy_mask.store(mask, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+
+/** \brief The handler installed for lazy signals.
+ *
+ * If the signal is deferred by a lazy scoped_signal_mask of this thread,
+ * it gets marked as pending. Otherwise the user handler is called.
+ *
+ * \param[in] sig  The signal received.
+ */
+void lazy_signal_trampoline(int sig)
+{
+    std::uint64_t const bit(std::uint64_t(1) << (sig - 1));
+    if((g_lazy_mask.load(std::memory_order_relaxed) & bit) != 0)
+    {
+        g_lazy_pending.fetch_or(bit);
+        return;
+    }
+
+    lazy_signal_handler_t const handler(g_lazy_handlers[sig].load());
+    if(handler != nullptr)
+    {
+        handler(sig);
+    }
+}
 
 
 
@@ -79,55 +162,213 @@ bool g_has_sanitizer = false;
 
 
 
+/** \brief Convert the set to a sigset_t.
+ *
+ * The \p set is cleared and then each signal of this set is added
+ * to it.
+ *
+ * \param[out] set  The sigset_t to fill.
+ */
+void signal_set_t::to_sigset(sigset_t & set) const
+{
+    sigemptyset(&set);
+    for(std::uint64_t mask(f_mask); mask != 0; mask &= mask - 1)
+    {
+        sigaddset(&set, __builtin_ctzll(mask) + 1);
+    }
+}
+
+
 /** \brief Set signal mask.
  *
  * This constructor blocks the specified \p block_signals and the
  * destructor restores the flags as expected once the object is
  * out of scope.
  *
- * If the \p block_signals list is empty, then all the signals get
+ * If the \p block_signals set is empty, then all the signals get
  * blocked. This is particularly useful to start a new thread.
  *
- * \param[in] block_signals  The list of signals to block or empty
+ * The mask is changed with pthread_sigmask() so only the calling
+ * thread is affected. The set can be a constant built at compile
+ * time so entering the scope does not allocate memory.
+ *
+ * \exception fixme
+ * Raised if the set includes an invalid signal number or if the mask
+ * cannot be changed.
+ *
+ * \param[in] block_signals  The set of signals to block or empty
  * to block them all.
  */
-scoped_signal_mask::scoped_signal_mask(sig_list_t block_signals)
+scoped_signal_mask::scoped_signal_mask(signal_set_t const & block_signals)
 {
-    sigset_t set;
-    sigemptyset(&set);
+    block(block_signals);
+}
 
-    if(block_signals.empty())
+
+/** \brief Set signal mask with the specified mode.
+ *
+ * With SIGNAL_MASK_BLOCK, this is the same as the other constructors.
+ *
+ * With SIGNAL_MASK_LAZY, the signals of \p block_signals which have a
+ * handler installed with set_lazy_signal_handler() are only marked as
+ * deferred in a thread local mask; no system call is made. If one of
+ * those signals arrives in this thread while deferred, it is recorded
+ * as pending and its handler gets called when the scope ends. The other
+ * signals of \p block_signals are blocked with pthread_sigmask() as
+ * usual.
+ *
+ * \note
+ * A process directed signal deferred by a thread is not redirected to
+ * another thread as the kernel would do for a blocked signal. It is
+ * handled by the thread which deferred it once its scope ends.
+ *
+ * \param[in] block_signals  The set of signals to block or empty
+ * to block them all.
+ * \param[in] mode  Whether to block or defer the managed signals.
+ */
+scoped_signal_mask::scoped_signal_mask(
+          signal_set_t const & block_signals
+        , signal_mask_mode_t mode)
+{
+    if(mode != signal_mask_mode_t::SIGNAL_MASK_LAZY)
     {
-        // sigfillset() does not set the few signals that should never be
-        // blocked (would be ignored by the command below)
-        //
-        sigfillset(&set);
+        block(block_signals);
+        return;
     }
-    else
+
+    if(block_signals.get_invalid() != 0)
+    {
+        throw fixme("sigaddset() failed to set signal " + std::to_string(block_signals.get_invalid()));
+    }
+
+    std::uint64_t const lazy_signals(g_lazy_signals.load(std::memory_order_relaxed));
+    std::uint64_t const requested(block_signals.empty() ? ~std::uint64_t(0) : block_signals.get_mask());
+
+    f_lazy = true;
+    f_lazy_previous = g_lazy_mask.load(std::memory_order_relaxed);
+    g_lazy_mask.store(f_lazy_previous | (requested & lazy_signals), std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    // signals which libexcept does not manage still need to be blocked
+    //
+    if(block_signals.empty())
     {
-        for(auto const & sig : block_signals)
+        if(lazy_signals != 0)
         {
-            if(sigaddset(&set, sig) != 0)
+            std::uint64_t skip(lazy_signals);
+            if(has_sanitizer())
             {
-                throw fixme("sigaddset() failed to set signal " + std::to_string(sig));
+                skip |= g_incompatible_signals.get_mask();
             }
+            sigset_t set;
+            sigfillset(&set);
+            for(std::uint64_t mask(skip); mask != 0; mask &= mask - 1)
+            {
+                sigdelset(&set, __builtin_ctzll(mask) + 1);
+            }
+            if(pthread_sigmask(SIG_BLOCK, &set, &f_original_mask) != 0)
+            {
+                throw fixme("pthread_sigmask() failed to block signals.");
+            }
+            f_set = true;
+        }
+        else
+        {
+            block(block_signals);
         }
     }
+    else
+    {
+        signal_set_t others(block_signals);
+        for(std::uint64_t mask(lazy_signals); mask != 0; mask &= mask - 1)
+        {
+            others.remove(__builtin_ctzll(mask) + 1);
+        }
+        if(!others.empty())
+        {
+            block(others);
+        }
+    }
+}
+
 
-    if(has_sanitizer())
+/** \brief Set signal mask from a list of signals.
+ *
+ * This constructor accepts a braced list of signals such as
+ * `{ SIGPIPE, SIGCHLD }`. The list lives on the stack so no memory
+ * gets allocated.
+ *
+ * \param[in] block_signals  The list of signals to block or empty
+ * to block them all.
+ */
+scoped_signal_mask::scoped_signal_mask(std::initializer_list<int> block_signals)
+{
+    block(signal_set_t(block_signals));
+}
+
+
+/** \brief Set signal mask from a list of signals.
+ *
+ * This constructor is kept for backward compatibility. Prefer the
+ * signal_set_t version which does not require a list.
+ *
+ * \param[in] block_signals  The list of signals to block or empty
+ * to block them all.
+ */
+scoped_signal_mask::scoped_signal_mask(sig_list_t const & block_signals)
+{
+    signal_set_t set;
+    for(auto const & sig : block_signals)
     {
-        for(auto const & sig : g_incompatible_signals)
+        set.add(sig);
+    }
+    block(set);
+}
+
+
+/** \brief Block the signals.
+ *
+ * This function is the implementation of the constructors.
+ *
+ * \param[in] block_signals  The set of signals to block or empty
+ * to block them all.
+ */
+void scoped_signal_mask::block(signal_set_t const & block_signals)
+{
+    if(block_signals.get_invalid() != 0)
+    {
+        throw fixme("sigaddset() failed to set signal " + std::to_string(block_signals.get_invalid()));
+    }
+
+    sigset_t set;
+    if(block_signals.empty())
+    {
+        // sigfillset() does not set the few signals that should never be
+        // blocked (would be ignored by the command below)
+        //
+        sigfillset(&set);
+        if(has_sanitizer())
         {
-            if(sigdelset(&set, sig) != 0)
+            for(std::uint64_t mask(g_incompatible_signals.get_mask()); mask != 0; mask &= mask - 1)
             {
-                throw fixme("sigdelset() failed to delete signal " + std::to_string(sig));
+                sigdelset(&set, __builtin_ctzll(mask) + 1);
             }
         }
     }
+    else if(has_sanitizer())
+    {
+        signal_set_t compatible(block_signals);
+        compatible.remove(g_incompatible_signals).to_sigset(set);
+    }
+    else
+    {
+        block_signals.to_sigset(set);
+    }
 
-    if(sigprocmask(SIG_BLOCK, &set, &f_original_mask) != 0)
+    int const r(pthread_sigmask(SIG_BLOCK, &set, &f_original_mask));
+    if(r != 0)
     {
-        throw fixme("sigprocmask() failed to block signals.");
+        throw fixme("pthread_sigmask() failed to block signals.");
     }
 
     f_set = true;
@@ -138,26 +379,114 @@ scoped_signal_mask::scoped_signal_mask(sig_list_t block_signals)
  *
  * This function restores the signals as they were before the
  * scoped_signal_mask was created.
+ *
+ * In lazy mode, the handlers of the signals received while deferred
+ * get called.
  */
 scoped_signal_mask::~scoped_signal_mask()
 {
+    if(f_lazy)
+    {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        g_lazy_mask.store(f_lazy_previous, std::memory_order_relaxed);
+        replay_pending_signals();
+    }
     if(f_set)
     {
-        if(sigprocmask(SIG_SETMASK, &f_original_mask, nullptr) != 0)
+        if(pthread_sigmask(SIG_SETMASK, &f_original_mask, nullptr) != 0)
         {
-            std::cerr << "fatal error: sigprocmask() failed to block signals.\n";
+            std::cerr << "fatal error: pthread_sigmask() failed to restore signals.\n";
             std::terminate();
         }
     }
 }
 
 
+/** \brief Let libexcept manage a signal so it can be deferred.
+ *
+ * This function installs a libexcept handler for \p sig which calls
+ * \p handler. Such a signal can be deferred without a system call by
+ * a scoped_signal_mask created in SIGNAL_MASK_LAZY mode.
+ *
+ * The \p handler is called either from the signal handler or from the
+ * destructor of the scoped_signal_mask which deferred the signal. It
+ * must be written as a signal handler.
+ *
+ * Pass nullptr to remove the handler. The action which was in place
+ * before the first call gets restored.
+ *
+ * \warning
+ * This function is not thread safe. Call it before starting threads.
+ *
+ * \exception fixme
+ * Raised if \p sig is not a valid signal or is a synchronous signal
+ * such as SIGSEGV which cannot be deferred.
+ *
+ * \param[in] sig  The signal to manage.
+ * \param[in] handler  The function to call when \p sig is received.
+ */
+void set_lazy_signal_handler(int sig, lazy_signal_handler_t handler)
+{
+    if(sig < 1
+    || sig > 64
+    || g_non_deferrable_signals.contains(sig))
+    {
+        throw fixme("signal " + std::to_string(sig) + " cannot be managed lazily.");
+    }
+
+    std::uint64_t const bit(std::uint64_t(1) << (sig - 1));
+    bool const installed((g_lazy_signals.load() & bit) != 0);
+    if(handler == nullptr)
+    {
+        if(installed)
+        {
+            g_lazy_signals.fetch_and(~bit);
+            sigaction(sig, &g_lazy_previous_actions[sig], nullptr);
+            g_lazy_handlers[sig].store(nullptr);
+        }
+        return;
+    }
+
+    g_lazy_handlers[sig].store(handler);
+    if(!installed)
+    {
+        struct sigaction action = {};
+        action.sa_handler = lazy_signal_trampoline;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if(sigaction(sig, &action, &g_lazy_previous_actions[sig]) != 0)
+        {
+            g_lazy_handlers[sig].store(nullptr);
+            throw fixme("sigaction() failed to install the handler of signal " + std::to_string(sig) + ".");
+        }
+        g_lazy_signals.fetch_or(bit);
+    }
+}
+
+
+/** \brief Get the signals managed by libexcept.
+ *
+ * \return The set of signals with a handler installed by
+ * set_lazy_signal_handler().
+ */
+signal_set_t get_lazy_signals()
+{
+    signal_set_t result;
+    for(std::uint64_t mask(g_lazy_signals.load()); mask != 0; mask &= mask - 1)
+    {
+        result.add(__builtin_ctzll(mask) + 1);
+    }
+    return result;
+}
+
+
 /** \brief Check whether this instance is running with the sanitizer.
  *
  * This funciton returns true if the software was compiled with the
- * sanitizer. This test happens at runtime. The test results are saved
- * in global variables. To make it thread safe, it should be called
- * once before starting any thread.
+ * sanitizer. This test happens at runtime, the first time the function
+ * is called. The result is saved in a static variable which C++
+ * initializes in a thread safe manner so the function can be called
+ * from any thread.
  *
  * Note that by default the sanitizer is enabled, but it is possible
  * to disable it using the __lsan_disable() function. There is no
@@ -168,12 +497,7 @@ scoped_signal_mask::~scoped_signal_mask()
  */
 bool has_sanitizer()
 {
-    if(!g_has_sanitizer_defined)
-    {
-        g_has_sanitizer_defined = true;
-        g_has_sanitizer = dlsym(RTLD_DEFAULT, "__lsan_enable") != nullptr;
-    }
-
+    static bool const g_has_sanitizer(dlsym(RTLD_DEFAULT, "__lsan_enable") != nullptr);
     return g_has_sanitizer;
 }
 
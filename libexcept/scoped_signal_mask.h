@@ -31,6 +31,8 @@
 
 // C++
 //
+#include    <cstdint>
+#include    <initializer_list>
 #include    <list>
 #include    <memory>
 
@@ -49,20 +51,113 @@ namespace libexcept
 typedef std::list<int>                  sig_list_t;
 
 
+/** \brief A set of signals which can be built at compile time.
+ *
+ * A sigset_t cannot be manipulated in a constexpr function. This
+ * class holds the standard and real-time signals (1 to 64) in a bit
+ * mask so a set of signals can be defined as a constant:
+ *
+ * \code
+ *     constexpr libexcept::signal_set_t g_io_signals{ SIGPIPE, SIGCHLD };
+ * \endcode
+ *
+ * An invalid signal number is remembered and reported by the
+ * scoped_signal_mask constructor.
+ */
+class signal_set_t
+{
+public:
+    constexpr                       signal_set_t() = default;
+    constexpr                       signal_set_t(std::initializer_list<int> signals)
+                                    {
+                                        for(int const sig : signals)
+                                        {
+                                            add(sig);
+                                        }
+                                    }
+
+    constexpr signal_set_t &        add(int sig)
+                                    {
+                                        if(sig < 1 || sig > 64)
+                                        {
+                                            f_invalid = sig;
+                                        }
+                                        else
+                                        {
+                                            f_mask |= std::uint64_t(1) << (sig - 1);
+                                        }
+                                        return *this;
+                                    }
+    constexpr signal_set_t &        remove(int sig)
+                                    {
+                                        if(sig >= 1 && sig <= 64)
+                                        {
+                                            f_mask &= ~(std::uint64_t(1) << (sig - 1));
+                                        }
+                                        return *this;
+                                    }
+    constexpr signal_set_t &        remove(signal_set_t const & signals)
+                                    {
+                                        f_mask &= ~signals.f_mask;
+                                        return *this;
+                                    }
+    constexpr bool                  contains(int sig) const
+                                    {
+                                        return sig >= 1
+                                            && sig <= 64
+                                            && (f_mask & (std::uint64_t(1) << (sig - 1))) != 0;
+                                    }
+    constexpr bool                  empty() const { return f_mask == 0; }
+    constexpr std::uint64_t         get_mask() const { return f_mask; }
+    constexpr int                   get_invalid() const { return f_invalid; }
+
+    void                            to_sigset(sigset_t & set) const;
+
+private:
+    std::uint64_t                   f_mask = 0;
+    int                             f_invalid = 0;
+};
+
+
+enum class signal_mask_mode_t
+{
+    SIGNAL_MASK_BLOCK,          // block with pthread_sigmask()
+    SIGNAL_MASK_LAZY,           // defer signals managed by libexcept
+};
+
+
+typedef void (*lazy_signal_handler_t)(int sig);
+
+
 class scoped_signal_mask
 {
 public:
     typedef std::shared_ptr<scoped_signal_mask> pointer_t;
 
-                    scoped_signal_mask(sig_list_t block_signals = sig_list_t());
+                    scoped_signal_mask(signal_set_t const & block_signals = signal_set_t());
+                    scoped_signal_mask(
+                              signal_set_t const & block_signals
+                            , signal_mask_mode_t mode);
+                    scoped_signal_mask(std::initializer_list<int> block_signals);
+                    scoped_signal_mask(sig_list_t const & block_signals);
+                    scoped_signal_mask(scoped_signal_mask const &) = delete;
                     ~scoped_signal_mask();
 
+    scoped_signal_mask &
+                    operator = (scoped_signal_mask const &) = delete;
+
 private:
+    void            block(signal_set_t const & block_signals);
+
     bool            f_set = false;
+    bool            f_lazy = false;
+    std::uint64_t   f_lazy_previous = 0;
     sigset_t        f_original_mask = sigset_t();
 };
 
 
+void set_lazy_signal_handler(int sig, lazy_signal_handler_t handler);
+signal_set_t get_lazy_signals();
 bool has_sanitizer();
 
 
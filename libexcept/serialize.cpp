@@ -0,0 +1,392 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/serialize.h"
+
+#include    "libexcept/demangle.h"
+
+
+// C++
+//
+#include    <cstring>
+#include    <typeinfo>
+
+
+/** \file
+ * \brief Implementation of the binary serialization of exceptions.
+ *
+ * This file includes a function used to serialize an exception in a
+ * compact binary format and a reader which gives access to the fields
+ * of such a buffer without copying them.
+ *
+ * The format is versioned. It is composed of:
+ *
+ * \code
+ *     'L' 'X' 'E' <version>
+ *     <type>                           mangled typeid() name
+ *     <message>                        what()
+ *     <count> (<name> <value>)*        parameters
+ *     <count> (<frame>)*               stack trace
+ * \endcode
+ *
+ * Numbers (counts and sizes) are saved as unsigned LEB128 (7 bits per
+ * byte, the most significant bit set when another byte follows). Strings
+ * are saved as their size followed by their bytes, without a terminating
+ * NUL character.
+ *
+ * The frames are the stack trace strings as saved in the exception, so
+ * a frame includes the module name and offset or the symbol string,
+ * depending on how the stack trace was collected.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::uint8_t const    g_magic[3] = { 'L', 'X', 'E' };
+
+
+void append_number(serialized_exception_t & out, std::size_t n)
+{
+    while(n >= 0x80)
+    {
+        out.push_back(static_cast<std::uint8_t>(n | 0x80));
+        n >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(n));
+}
+
+
+void append_string(serialized_exception_t & out, char const * s, std::size_t size)
+{
+    append_number(out, size);
+    out.insert(out.end(), s, s + size);
+}
+
+
+void append_string(serialized_exception_t & out, std::string const & s)
+{
+    append_string(out, s.c_str(), s.length());
+}
+
+
+std::size_t read_number(std::uint8_t const * & pos, std::uint8_t const * end)
+{
+    std::size_t result(0);
+    for(int shift(0);; shift += 7)
+    {
+        if(pos >= end)
+        {
+            throw invalid_serialization("number goes beyond the end of the buffer.");
+        }
+        if(shift >= 64)
+        {
+            throw invalid_serialization("number is too large.");
+        }
+        std::uint8_t const c(*pos);
+        ++pos;
+        result |= static_cast<std::size_t>(c & 0x7F) << shift;
+        if((c & 0x80) == 0)
+        {
+            return result;
+        }
+    }
+}
+
+
+std::string_view read_string(std::uint8_t const * & pos, std::uint8_t const * end)
+{
+    std::size_t const size(read_number(pos, end));
+    if(size > static_cast<std::size_t>(end - pos))
+    {
+        throw invalid_serialization("string goes beyond the end of the buffer.");
+    }
+    std::string_view const result(reinterpret_cast<char const *>(pos), size);
+    pos += size;
+    return result;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Serialize an exception in a compact binary buffer.
+ *
+ * This function appends the binary representation of \p e to the \p out
+ * buffer. The type, the message, the parameters and the stack trace are
+ * saved. The last two are only available if \p e derives from
+ * exception_base_t; other exceptions are saved with zero parameters and
+ * zero frames.
+ *
+ * Since the data is appended, the same buffer can be reused (call
+ * `clear()` on it first) or used to save multiple exceptions one
+ * after the other. The exception_reader::get_size() function tells
+ * you where the next exception starts.
+ *
+ * The output can be read back with the exception_reader class.
+ *
+ * \param[in] e  The exception to serialize.
+ * \param[in,out] out  The buffer where the exception gets appended.
+ */
+void serialize_exception(std::exception const & e, serialized_exception_t & out)
+{
+    out.insert(out.end(), std::begin(g_magic), std::end(g_magic));
+    out.push_back(SERIALIZATION_VERSION);
+
+    char const * type(typeid(e).name());
+    append_string(out, type, strlen(type));
+
+    char const * what(e.what());
+    append_string(out, what, strlen(what));
+
+    exception_base_t const * base(dynamic_cast<exception_base_t const *>(&e));
+    if(base == nullptr)
+    {
+        append_number(out, 0);
+        append_number(out, 0);
+        return;
+    }
+
+    parameter_t const & parameters(base->get_parameters());
+    append_number(out, parameters.size());
+    for(auto const & p : parameters)
+    {
+        append_string(out, p.first);
+        append_string(out, p.second);
+    }
+
+    stack_trace_t const & stack_trace(base->get_stack_trace());
+    append_number(out, stack_trace.size());
+    for(auto const & frame : stack_trace)
+    {
+        append_string(out, frame);
+    }
+}
+
+
+/** \brief Initialize a reader of a serialized exception.
+ *
+ * The constructor verifies the header and all the sizes found in the
+ * buffer so the other functions cannot later fail while reading the
+ * fields. Nothing gets copied: the strings returned by the reader
+ * point directly inside the buffer which must remain valid for as long
+ * as the reader and the returned strings are in use.
+ *
+ * The buffer can be larger than the serialized exception. The get_size()
+ * function returns the number of bytes actually used.
+ *
+ * \exception invalid_serialization
+ * This exception is raised if the buffer is not a valid serialized
+ * exception or uses an unsupported version.
+ *
+ * \param[in] data  A pointer to the serialized exception.
+ * \param[in] size  The number of bytes available in \p data.
+ */
+exception_reader::exception_reader(void const * data, std::size_t size)
+    : f_start(reinterpret_cast<std::uint8_t const *>(data))
+{
+    std::uint8_t const * end(f_start + size);
+    if(size < std::size(g_magic) + 1
+    || f_start[0] != g_magic[0]
+    || f_start[1] != g_magic[1]
+    || f_start[2] != g_magic[2])
+    {
+        throw invalid_serialization("buffer does not start with a serialized exception magic.");
+    }
+    f_version = f_start[3];
+    if(f_version != SERIALIZATION_VERSION)
+    {
+        throw invalid_serialization(
+                  "unsupported serialized exception version "
+                + std::to_string(f_version)
+                + ".");
+    }
+
+    std::uint8_t const * pos(f_start + 4);
+    f_type = read_string(pos, end);
+    f_message = read_string(pos, end);
+
+    f_parameter_count = read_number(pos, end);
+    f_parameter_pos = pos;
+    for(std::size_t idx(0); idx < f_parameter_count; ++idx)
+    {
+        read_string(pos, end);
+        read_string(pos, end);
+    }
+
+    f_frame_count = read_number(pos, end);
+    f_frame_pos = pos;
+    for(std::size_t idx(0); idx < f_frame_count; ++idx)
+    {
+        read_string(pos, end);
+    }
+
+    f_end = pos;
+}
+
+
+/** \brief Get the size of the serialized exception.
+ *
+ * This function returns the number of bytes used by this serialized
+ * exception. If you saved several exceptions one after the other, the
+ * next one starts at that offset.
+ *
+ * \return The size of the serialized exception in bytes.
+ */
+std::size_t exception_reader::get_size() const
+{
+    return f_end - f_start;
+}
+
+
+/** \brief Get the version of the serialized data.
+ *
+ * \return The version found in the header, at this time always
+ * SERIALIZATION_VERSION.
+ */
+int exception_reader::get_version() const
+{
+    return f_version;
+}
+
+
+/** \brief Get the mangled type of the exception.
+ *
+ * This function returns the `typeid(e).name()` of the exception as it
+ * was serialized. Use get_demangled_type() to get a readable name.
+ *
+ * \return The mangled type name.
+ */
+std::string_view exception_reader::get_type() const
+{
+    return f_type;
+}
+
+
+/** \brief Get the demangled type of the exception.
+ *
+ * This function converts the type with demangle_cpp_name(). Contrary to
+ * the other functions of the reader, this one allocates a string.
+ *
+ * \return The demangled type name.
+ */
+std::string exception_reader::get_demangled_type() const
+{
+    return demangle_cpp_name(std::string(f_type).c_str());
+}
+
+
+/** \brief Get the message of the exception.
+ *
+ * This is the string returned by `what()` at the time the exception was
+ * serialized.
+ *
+ * \return The exception message.
+ */
+std::string_view exception_reader::get_message() const
+{
+    return f_message;
+}
+
+
+/** \brief Get the number of parameters.
+ *
+ * \return The number of parameters saved in the serialized exception.
+ */
+std::size_t exception_reader::get_parameter_count() const
+{
+    return f_parameter_count;
+}
+
+
+/** \brief Read the next parameter.
+ *
+ * Each call returns the next parameter, in the same order as the exception
+ * get_parameters() map (i.e. sorted by name).
+ *
+ * \param[out] name  The name of the parameter.
+ * \param[out] value  The value of the parameter.
+ *
+ * \return true if a parameter was returned, false once all the parameters
+ * were read.
+ */
+bool exception_reader::next_parameter(std::string_view & name, std::string_view & value)
+{
+    if(f_parameter_index >= f_parameter_count)
+    {
+        return false;
+    }
+    ++f_parameter_index;
+
+    name = read_string(f_parameter_pos, f_end);
+    value = read_string(f_parameter_pos, f_end);
+    return true;
+}
+
+
+/** \brief Get the number of frames.
+ *
+ * \return The number of stack trace frames saved in the serialized
+ * exception.
+ */
+std::size_t exception_reader::get_frame_count() const
+{
+    return f_frame_count;
+}
+
+
+/** \brief Read the next frame.
+ *
+ * Each call returns the next frame of the stack trace, starting with the
+ * innermost frame.
+ *
+ * \param[out] frame  The frame string.
+ *
+ * \return true if a frame was returned, false once all the frames were
+ * read.
+ */
+bool exception_reader::next_frame(std::string_view & frame)
+{
+    if(f_frame_index >= f_frame_count)
+    {
+        return false;
+    }
+    ++f_frame_index;
+
+    frame = read_string(f_frame_pos, f_end);
+    return true;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,94 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/exception.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string_view>
+#include    <vector>
+
+
+
+/** \file
+ * \brief Declarations of the binary serialization of exceptions.
+ *
+ * This file defines a function to transform an exception in a compact
+ * binary buffer and a reader class to extract the fields of such a
+ * buffer without copying them.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(invalid_serialization);
+
+
+constexpr std::uint8_t const    SERIALIZATION_VERSION = 1;
+
+typedef std::vector<std::uint8_t>   serialized_exception_t;
+
+
+void                            serialize_exception(
+                                          std::exception const & e
+                                        , serialized_exception_t & out);
+
+
+class exception_reader
+{
+public:
+                                exception_reader(void const * data, std::size_t size);
+
+    std::size_t                 get_size() const;
+    int                         get_version() const;
+    std::string_view            get_type() const;
+    std::string                 get_demangled_type() const;
+    std::string_view            get_message() const;
+
+    std::size_t                 get_parameter_count() const;
+    bool                        next_parameter(std::string_view & name, std::string_view & value);
+
+    std::size_t                 get_frame_count() const;
+    bool                        next_frame(std::string_view & frame);
+
+private:
+    std::uint8_t const *        f_start = nullptr;
+    std::uint8_t const *        f_end = nullptr;
+    int                         f_version = 0;
+    std::string_view            f_type = std::string_view();
+    std::string_view            f_message = std::string_view();
+    std::size_t                 f_parameter_count = 0;
+    std::size_t                 f_parameter_index = 0;
+    std::uint8_t const *        f_parameter_pos = nullptr;
+    std::size_t                 f_frame_count = 0;
+    std::size_t                 f_frame_index = 0;
+    std::uint8_t const *        f_frame_pos = nullptr;
+};
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
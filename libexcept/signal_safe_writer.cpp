@@ -0,0 +1,189 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/signal_safe_writer.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+
+
+// C
+//
+#include    <errno.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the signal_safe_writer class.
+ *
+ * A signal handler cannot use iostream or printf() since those may
+ * allocate memory or lock a mutex held by the interrupted thread. The
+ * signal_safe_writer class formats strings and numbers in a fixed buffer
+ * and sends it to a file descriptor with write().
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+/** \brief Initialize the writer.
+ *
+ * The writer does not take ownership of \p fd.
+ *
+ * \param[in] fd  The file descriptor where the data gets written.
+ */
+signal_safe_writer::signal_safe_writer(int fd)
+    : f_fd(fd)
+{
+}
+
+
+/** \brief Flush the remaining data.
+ *
+ * The destructor makes sure that the data still in the buffer gets
+ * written to the file descriptor.
+ */
+signal_safe_writer::~signal_safe_writer()
+{
+    flush();
+}
+
+
+/** \brief Append a string of bytes.
+ *
+ * \param[in] s  The bytes to append.
+ * \param[in] size  The number of bytes to append.
+ */
+void signal_safe_writer::append(char const * s, std::size_t size)
+{
+    while(size > 0)
+    {
+        if(f_size >= sizeof(f_buffer))
+        {
+            flush();
+        }
+        std::size_t const l(std::min(size, sizeof(f_buffer) - f_size));
+        memcpy(f_buffer + f_size, s, l);
+        f_size += l;
+        s += l;
+        size -= l;
+    }
+}
+
+
+/** \brief Append a NUL terminated string.
+ *
+ * \param[in] s  The string to append.
+ */
+void signal_safe_writer::append(char const * s)
+{
+    append(s, strlen(s));
+}
+
+
+/** \brief Append a number in decimal.
+ *
+ * \param[in] value  The number to append.
+ */
+void signal_safe_writer::append_decimal(std::int64_t value)
+{
+    char buf[24];
+    char * e(buf + sizeof(buf));
+    char * d(e);
+    std::uint64_t v(value < 0 ? -static_cast<std::uint64_t>(value) : value);
+    do
+    {
+        --d;
+        *d = '0' + v % 10;
+        v /= 10;
+    }
+    while(v != 0);
+    if(value < 0)
+    {
+        --d;
+        *d = '-';
+    }
+    append(d, e - d);
+}
+
+
+/** \brief Append a number in hexadecimal.
+ *
+ * The number is written with the "0x" introducer and lowercase digits.
+ *
+ * \param[in] value  The number to append.
+ */
+void signal_safe_writer::append_hex(std::uint64_t value)
+{
+    char buf[18];
+    char * e(buf + sizeof(buf));
+    char * d(e);
+    do
+    {
+        --d;
+        *d = "0123456789abcdef"[value & 15];
+        value >>= 4;
+    }
+    while(value != 0);
+    --d;
+    *d = 'x';
+    --d;
+    *d = '0';
+    append(d, e - d);
+}
+
+
+/** \brief Write the buffer to the file descriptor.
+ *
+ * If the write fails, the data gets lost. There is not much else we
+ * can do from within a signal handler.
+ */
+void signal_safe_writer::flush()
+{
+    char const * s(f_buffer);
+    while(f_size > 0)
+    {
+        ssize_t const r(::write(f_fd, s, f_size));
+        if(r <= 0)
+        {
+            if(r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        s += r;
+        f_size -= r;
+    }
+    f_size = 0;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,65 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// C++
+//
+#include    <cstddef>
+#include    <cstdint>
+
+
+
+/** \file
+ * \brief Declaration of an output class usable in signal handlers.
+ *
+ * This file declares a class used to format text with only
+ * async-signal-safe functions.
+ */
+
+
+namespace libexcept
+{
+
+
+class signal_safe_writer
+{
+public:
+                        signal_safe_writer(int fd);
+                        signal_safe_writer(signal_safe_writer const &) = delete;
+                        ~signal_safe_writer();
+
+    signal_safe_writer &
+                        operator = (signal_safe_writer const &) = delete;
+
+    void                append(char const * s, std::size_t size);
+    void                append(char const * s);
+    void                append_decimal(std::int64_t value);
+    void                append_hex(std::uint64_t value);
+    void                flush();
+
+private:
+    int                 f_fd = -1;
+    char                f_buffer[1024] = {};
+    std::size_t         f_size = 0;
+};
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,380 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/spawn.h"
+
+#include    "libexcept/fd_provenance.h"
+
+
+// C++
+//
+#include    <cstring>
+#include    <iostream>
+#include    <vector>
+
+
+// C
+//
+#include    <errno.h>
+#include    <fcntl.h>
+#include    <signal.h>
+#include    <spawn.h>
+#include    <sys/resource.h>
+#include    <sys/syscall.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the leak free spawn helper.
+ *
+ * The verify_inherited_files() function detects leaked descriptors
+ * after the fact, in the child. The spawn_process() function prevents
+ * the leaks by construction: the child closes all the descriptors
+ * except stdin, stdout, stderr, and the allowed ones before calling
+ * execve().
+ *
+ * The child is created without copying the page tables of the parent.
+ * When only stdin, stdout, and stderr are inherited, the function uses
+ * posix_spawn() with a closefrom() action. Otherwise it uses vfork()
+ * and closes the gaps between the allowed descriptors with close_range().
+ * In both cases, the cost does not depend on the size of the parent.
+ */
+
+
+extern char ** environ;
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Close the descriptors which are not allowed, in the child.
+ *
+ * This function runs between vfork() and execve() so it cannot
+ * allocate memory or take locks. It calls close_range() on each gap
+ * between the allowed descriptors. If close_range() is not available,
+ * it closes the descriptors one by one up to \p max_fd.
+ *
+ * The allowed descriptors get their FD_CLOEXEC flag removed since they
+ * are expected to be inherited.
+ *
+ * \param[in] allowed  The descriptors to keep.
+ * \param[in] max_fd  The limit used when close_range() is not available.
+ */
+void close_in_child(allowed_fds_bitmap_t const & allowed, int max_fd)
+{
+    int first(3);
+    for(;;)
+    {
+        int const next(allowed.next(first));
+        if(next == -1
+        || next > first)
+        {
+            unsigned int const last(next == -1 ? ~0U : static_cast<unsigned int>(next - 1));
+            bool closed(false);
+#ifdef SYS_close_range
+            closed = syscall(SYS_close_range, first, last, 0) == 0;
+#endif
+            if(!closed)
+            {
+                int const end(next == -1 ? max_fd : next);
+                for(int fd(first); fd < end; ++fd)
+                {
+                    syscall(SYS_close, fd);
+                }
+            }
+        }
+        if(next == -1)
+        {
+            break;
+        }
+        int const flags(fcntl(next, F_GETFD));
+        if(flags > 0
+        && (flags & FD_CLOEXEC) != 0)
+        {
+            fcntl(next, F_SETFD, flags & ~FD_CLOEXEC);
+        }
+        first = next + 1;
+    }
+}
+
+
+/** \brief Get the limit used to close descriptors one by one.
+ *
+ * \return The soft RLIMIT_NOFILE limit or 1024 if not available.
+ */
+int get_max_fd()
+{
+    rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0
+    && limit.rlim_cur != RLIM_INFINITY)
+    {
+        return static_cast<int>(limit.rlim_cur);
+    }
+    return 1024;
+}
+
+
+/** \brief Reset the signal handlers in the child.
+ *
+ * The child shares the memory of the parent until execve(). A handler
+ * of the parent running in the child could corrupt that memory, so the
+ * caught signals get their default action back, the same way glibc does
+ * in posix_spawn(). The ignored signals remain ignored.
+ */
+void reset_signal_handlers_in_child()
+{
+    for(int sig(1); sig < NSIG; ++sig)
+    {
+        struct sigaction action;
+        if(sigaction(sig, nullptr, &action) == 0
+        && action.sa_handler != SIG_IGN
+        && action.sa_handler != SIG_DFL)
+        {
+            action.sa_handler = SIG_DFL;
+            action.sa_flags = 0;
+            sigemptyset(&action.sa_mask);
+            sigaction(sig, &action, nullptr);
+        }
+    }
+}
+
+
+/** \brief Start the child with vfork() and execve().
+ *
+ * The child shares the memory of the parent until execve() so on
+ * failure it saves errno in \p exec_errno which the parent can read
+ * once vfork() returns.
+ *
+ * All the signals are blocked around vfork() so no handler runs in the
+ * child while it shares the parent's memory. The child resets the
+ * handlers to their default and restores the signal mask of the caller
+ * just before execve().
+ *
+ * \param[in] path  The path to the executable.
+ * \param[in] argv  The null terminated list of arguments.
+ * \param[in] allowed  The descriptors to keep.
+ * \param[in] max_fd  The limit used when close_range() is not available.
+ * \param[out] exec_errno  The errno of execve() if it fails.
+ *
+ * \return The process identifier of the child or -1 if vfork() fails.
+ */
+pid_t vfork_exec(
+      char const * path
+    , char * const * argv
+    , allowed_fds_bitmap_t const & allowed
+    , int max_fd
+    , int & exec_errno)
+{
+    sigset_t all;
+    sigfillset(&all);
+    sigset_t previous;
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+
+    int volatile child_errno(0);
+    pid_t const pid(vfork());
+    if(pid == 0)
+    {
+        reset_signal_handlers_in_child();
+        close_in_child(allowed, max_fd);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        execve(path, argv, environ);
+        child_errno = errno;
+        _exit(127);
+    }
+    int const vfork_errno(errno);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    errno = vfork_errno;
+
+    exec_errno = child_errno;
+    return pid;
+}
+
+
+/** \brief Report the descriptors which would have leaked.
+ *
+ * This function lists the descriptors of this process which are not
+ * marked close-on-exec and are not allowed. Those would have been
+ * inherited by the child if it were started with fork() and exec().
+ *
+ * \param[in] path  The path of the child being started.
+ * \param[in] allowed  The descriptors the child inherits.
+ */
+void report_would_leak(std::string const & path, allowed_fds_bitmap_t const & allowed)
+{
+    for(auto const & info : get_fd_inventory())
+    {
+        if(info.f_fd <= 2
+        || info.f_cloexec
+        || allowed.contains(info.f_fd))
+        {
+            continue;
+        }
+        std::cerr
+            << "warning: file descriptor "
+            << info.f_fd
+            << " ("
+            << info.f_target
+            << ", "
+            << fd_type_to_string(info.f_type)
+            << ") is not close-on-exec and would leak to "
+            << path
+            << '\n';
+        for(auto const & frame : get_fd_provenance(info.f_fd))
+        {
+            std::cerr << "  opened at: " << frame << '\n';
+        }
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Start a child process without leaking file descriptors.
+ *
+ * This function starts \p path with the arguments \p args (where
+ * `args[0]` is the name of the program as seen by the child). The
+ * PATH variable is not searched and the child inherits the environment
+ * of the parent.
+ *
+ * The child only inherits stdin, stdout, stderr, and the descriptors
+ * found in \p allowed. All the other descriptors get closed before
+ * execve() is called, whether or not they are marked close-on-exec.
+ *
+ * When \p report_leaks is true, the descriptors which would have leaked
+ * without this function (i.e. not allowed and not close-on-exec) are
+ * reported on stderr, with the stack which opened them if the provenance
+ * tracker is on. This is the equivalent of calling verify_inherited_files()
+ * in the child, without the child having to do it.
+ *
+ * \exception spawn_error
+ * Raised if the child cannot be created or if execve() fails.
+ *
+ * \param[in] path  The path to the executable.
+ * \param[in] args  The arguments of the child, starting with argv[0].
+ * \param[in] allowed  Descriptors other than 0, 1, 2 to pass to the child.
+ * \param[in] report_leaks  Whether to report the descriptors which would
+ * otherwise have leaked.
+ *
+ * \return The process identifier of the child.
+ */
+pid_t spawn_process(
+      std::string const & path
+    , command_line_t const & args
+    , allowed_fds_bitmap_t const & allowed
+    , bool report_leaks)
+{
+    if(report_leaks)
+    {
+        report_would_leak(path, allowed);
+    }
+
+    // everything the child needs is prepared here, the child cannot
+    // allocate memory
+    //
+    std::vector<char *> argv;
+    argv.reserve(args.size() + 1);
+    for(auto const & a : args)
+    {
+        argv.push_back(const_cast<char *>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid(-1);
+    int error(0);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    if(allowed.next(3) == -1)
+    {
+        posix_spawn_file_actions_t actions;
+        error = posix_spawn_file_actions_init(&actions);
+        if(error != 0)
+        {
+            throw spawn_error(
+                      "could not initialize the file actions to start \""
+                    + path
+                    + "\": "
+                    + strerror(error));
+        }
+        error = posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+        if(error != 0)
+        {
+            posix_spawn_file_actions_destroy(&actions);
+            throw spawn_error(
+                      "could not add the closefrom action to start \""
+                    + path
+                    + "\": "
+                    + strerror(error));
+        }
+        error = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if(error != 0)
+        {
+            throw spawn_error(
+                      "could not start \""
+                    + path
+                    + "\": "
+                    + strerror(error));
+        }
+        return pid;
+    }
+#endif
+
+    int exec_errno(0);
+    pid = vfork_exec(path.c_str(), argv.data(), allowed, get_max_fd(), exec_errno);
+    if(pid < 0)
+    {
+        error = errno;
+        throw spawn_error(
+                  "could not create a child process for \""
+                + path
+                + "\": "
+                + strerror(error));
+    }
+    if(exec_errno != 0)
+    {
+        error = exec_errno;
+        waitpid(pid, nullptr, 0);
+        throw spawn_error(
+                  "could not start \""
+                + path
+                + "\": "
+                + strerror(error));
+    }
+
+    return pid;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,51 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/file_inheritance.h>
+
+
+
+/** \file
+ * \brief Declarations of the leak free spawn helper.
+ *
+ * This file defines a function used to start a child process which
+ * only inherits the file descriptors it is expected to inherit.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(spawn_error);
+
+
+pid_t                           spawn_process(
+                                          std::string const & path
+                                        , command_line_t const & args
+                                        , allowed_fds_bitmap_t const & allowed = allowed_fds_bitmap_t()
+                                        , bool report_leaks = false);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,239 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/thread_exception.h"
+
+
+// C
+//
+#include    <pthread.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the cross thread exception transport.
+ *
+ * A thread pool generally catches the exceptions raised by its workers
+ * and rethrows them in the thread waiting for the results using an
+ * std::exception_ptr. Doing so loses the information about which
+ * thread failed and who submitted the work.
+ *
+ * The submitter saves its location in a call_site_t object, which only
+ * copies two pointers and an integer, so the success path is not
+ * impacted:
+ *
+ * \code
+ *     libexcept::call_site_t const site;     // captures file, line, function
+ *     pool.submit([site]()
+ *         {
+ *             try
+ *             {
+ *                 ...
+ *             }
+ *             catch(...)
+ *             {
+ *                 return libexcept::capture_thread_exception(site);
+ *             }
+ *         });
+ *     ...
+ *     if(result.f_exception != nullptr)
+ *     {
+ *         libexcept::rethrow_thread_exception(result);
+ *     }
+ * \endcode
+ *
+ * By default, the worker's exception itself gets rethrown, so the
+ * joining thread catches it with its own type. When it is a libexcept
+ * exception, the worker thread and the call site get attached to it
+ * as parameters.
+ *
+ * Alternatively, the rethrown exception can be a thread_exception with
+ * its own stack trace (the joining thread) and the original exception
+ * attached as its cause, which holds the worker's stack trace. The
+ * original exception is shared, not copied.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Attach the details of the worker thread to an exception.
+ *
+ * \param[in,out] e  The exception receiving the parameters.
+ * \param[in] captured  The captured exception details.
+ */
+void set_origin_parameters(exception_base_t & e, captured_exception_t const & captured)
+{
+    e.set_parameter("origin_thread_id", std::to_string(captured.f_thread_id));
+    e.set_parameter("origin_thread_name", captured.f_thread_name);
+    e.set_parameter("call_site", captured.f_call_site.to_string());
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Convert the call site to a string.
+ *
+ * The string looks like `"file.cpp:123 in function"`.
+ *
+ * \return The call site as a string or an empty string if undefined.
+ */
+std::string call_site_t::to_string() const
+{
+    if(f_file == nullptr)
+    {
+        return std::string();
+    }
+
+    std::string result(f_file);
+    result += ':';
+    result += std::to_string(f_line);
+    if(f_function != nullptr)
+    {
+        result += " in ";
+        result += f_function;
+    }
+    return result;
+}
+
+
+/** \brief Capture the current exception along with the thread details.
+ *
+ * This function must be called from a catch() block of a worker thread.
+ * It saves the current exception, the identifier and name of the
+ * current thread, and the \p call_site of the code which submitted
+ * the work.
+ *
+ * \param[in] call_site  The location where the work was submitted.
+ *
+ * \return The captured exception to send to the joining thread.
+ */
+captured_exception_t capture_thread_exception(call_site_t const & call_site)
+{
+    captured_exception_t captured;
+    captured.f_exception = std::current_exception();
+    captured.f_thread_id = gettid();
+    captured.f_call_site = call_site;
+
+    char name[16];
+    if(pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+    {
+        captured.f_thread_name = name;
+    }
+
+    return captured;
+}
+
+
+/** \brief Rethrow a captured exception in the joining thread.
+ *
+ * By default (THREAD_RETHROW_ORIGINAL), this function rethrows the
+ * captured exception itself, so a `catch()` of its type in the joining
+ * thread works as if the exception had been thrown there. If it is
+ * derived from exception_base_t, the following parameters are added to
+ * it first:
+ *
+ * \li "origin_thread_id" -- the identifier of the worker thread
+ * \li "origin_thread_name" -- the name of the worker thread
+ * \li "call_site" -- where the work was submitted
+ *
+ * Other exceptions cannot hold these details and are rethrown as is.
+ *
+ * With THREAD_RETHROW_WRAPPED, the function throws a thread_exception.
+ * Its stack trace is the one of the calling (joining) thread and its
+ * cause is the captured exception, so get_exception_chain() and
+ * get_root_stack_trace() give access to the worker details. The
+ * parameters listed above are added to the thread_exception. Its
+ * message includes the message of the captured exception, which costs
+ * one more rethrow.
+ *
+ * In both cases, if \p captured does not hold an exception, the
+ * function throws a thread_exception without a cause.
+ *
+ * \exception thread_exception
+ * This exception is thrown when wrapping or when there is nothing to
+ * rethrow.
+ *
+ * \param[in] captured  The exception captured by capture_thread_exception().
+ * \param[in] mode  Whether to rethrow the original or a thread_exception.
+ */
+void rethrow_thread_exception(captured_exception_t const & captured, thread_rethrow_t mode)
+{
+    if(captured.f_exception != nullptr
+    && mode == thread_rethrow_t::THREAD_RETHROW_ORIGINAL)
+    {
+        try
+        {
+            std::rethrow_exception(captured.f_exception);
+        }
+        catch(exception_base_t & e)
+        {
+            set_origin_parameters(e, captured);
+            throw;
+        }
+    }
+
+    std::string what("exception in thread ");
+    what += std::to_string(captured.f_thread_id);
+    if(!captured.f_thread_name.empty())
+    {
+        what += " (";
+        what += captured.f_thread_name;
+        what += ')';
+    }
+    if(captured.f_exception != nullptr)
+    {
+        try
+        {
+            std::rethrow_exception(captured.f_exception);
+        }
+        catch(std::exception const & e)
+        {
+            what += ": ";
+            what += e.what();
+        }
+        catch(...)
+        {
+        }
+    }
+
+    thread_exception e(what);
+    e.set_cause(captured.f_exception);
+    set_origin_parameters(e, captured);
+    throw e;
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,98 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/exception.h>
+
+
+// C++
+//
+#include    <exception>
+#include    <string>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+/** \file
+ * \brief Declarations of the cross thread exception transport.
+ *
+ * This file defines the functions used to capture an exception in a
+ * worker thread and rethrow it in the thread which joins the worker,
+ * with information about both threads.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(thread_exception);
+
+
+struct call_site_t
+{
+                                call_site_t(
+                                          char const * file = __builtin_FILE()
+                                        , int line = __builtin_LINE()
+                                        , char const * function = __builtin_FUNCTION())
+                                    : f_file(file)
+                                    , f_line(line)
+                                    , f_function(function)
+                                {
+                                }
+
+    std::string                 to_string() const;
+
+    char const *                f_file = nullptr;
+    int                         f_line = 0;
+    char const *                f_function = nullptr;
+};
+
+
+enum class thread_rethrow_t
+{
+    THREAD_RETHROW_ORIGINAL,    // rethrow the worker's exception as is
+    THREAD_RETHROW_WRAPPED,     // throw a thread_exception with the worker's exception as its cause
+};
+
+
+struct captured_exception_t
+{
+    std::exception_ptr          f_exception = std::exception_ptr();
+    pid_t                       f_thread_id = 0;
+    std::string                 f_thread_name = std::string();
+    call_site_t                 f_call_site = call_site_t(nullptr, 0, nullptr);
+};
+
+
+captured_exception_t            capture_thread_exception(call_site_t const & call_site);
+[[noreturn]] void               rethrow_thread_exception(
+                                          captured_exception_t const & captured
+                                        , thread_rethrow_t mode = thread_rethrow_t::THREAD_RETHROW_ORIGINAL);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
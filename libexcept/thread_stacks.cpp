@@ -0,0 +1,768 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/thread_stacks.h"
+
+#include    "libexcept/signal_safe_writer.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstdint>
+#include    <cstring>
+#include    <iterator>
+#include    <memory>
+
+
+// C
+//
+#include    <errno.h>
+#include    <execinfo.h>
+#include    <fcntl.h>
+#include    <sched.h>
+#include    <signal.h>
+#include    <sys/syscall.h>
+#include    <sys/ucontext.h>
+#include    <time.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the functions capturing the stacks of threads.
+ *
+ * A thread can only walk its own stack. To get the stack of another
+ * thread, we send it a signal with tgkill(). The handler of that signal
+ * runs in the target thread, saves its raw frames in a slot allocated
+ * ahead of time and marks the slot as done. The requesting thread waits
+ * for all the slots with a bounded timeout.
+ *
+ * Everything here only uses async-signal-safe functions (and backtrace()
+ * which gets loaded by init_thread_stacks()) so the dump can happen from
+ * the crash handler.
+ *
+ * Each slot goes through the following states:
+ *
+ * \li free -- not in use;
+ * \li requested -- the signal was sent to the thread;
+ * \li capturing -- the handler is saving the frames;
+ * \li done -- the frames are available;
+ * \li abandoned -- the thread did not answer in time; the handler
+ *     ignores a slot in this state.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+enum slot_state_t : int
+{
+    SLOT_STATE_FREE,
+    SLOT_STATE_REQUESTED,
+    SLOT_STATE_CAPTURING,
+    SLOT_STATE_DONE,
+    SLOT_STATE_ABANDONED,
+};
+
+
+struct slot_t
+{
+    std::atomic<pid_t>          f_tid = 0;
+    std::atomic<int>            f_state = SLOT_STATE_FREE;
+    int                         f_frame_count = 0;
+    void *                      f_frames[THREAD_STACKS_FRAMES] = {};
+};
+
+
+slot_t                          g_slots[THREAD_STACKS_MAX_THREADS] = {};
+std::atomic<int>                g_signal = 0;
+std::atomic<bool>               g_busy = false;
+
+
+std::int64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+
+/** \brief Wait a little before checking the slots again.
+ *
+ * A thread answers within a few microseconds when it is running so the
+ * first few iterations only yield the processor. Afterward, the function
+ * sleeps to not burn a processor while waiting for a stuck thread.
+ *
+ * \param[in] iteration  The number of times the caller already waited.
+ */
+void short_wait(int iteration)
+{
+    if(iteration < 100)
+    {
+        sched_yield();
+        return;
+    }
+    timespec const ts{ 0, 50'000 };
+    nanosleep(&ts, nullptr);
+}
+
+
+/** \brief Get the address of the interrupted instruction.
+ *
+ * \param[in] context  The ucontext received by the signal handler.
+ *
+ * \return The program counter or nullptr if not supported.
+ */
+void * interrupted_pc(void * context)
+{
+    if(context == nullptr)
+    {
+        return nullptr;
+    }
+    ucontext_t const * uc(reinterpret_cast<ucontext_t const *>(context));
+
+#if defined(__x86_64__)
+    return reinterpret_cast<void *>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+    return reinterpret_cast<void *>(uc->uc_mcontext.pc);
+#else
+    static_cast<void>(uc);
+    return nullptr;
+#endif
+}
+
+
+/** \brief Save the frames of the current thread in its slot.
+ *
+ * \param[in] sig  The signal received.
+ * \param[in] info  The signal information.
+ * \param[in] context  The context of the interrupted code.
+ */
+void capture_handler(int sig, siginfo_t * info, void * context)
+{
+    static_cast<void>(sig);
+    static_cast<void>(info);
+
+    int const saved_errno(errno);
+    pid_t const tid(gettid());
+    for(auto & slot : g_slots)
+    {
+        if(slot.f_tid.load(std::memory_order_acquire) != tid)
+        {
+            continue;
+        }
+        int expected(SLOT_STATE_REQUESTED);
+        if(!slot.f_state.compare_exchange_strong(expected, SLOT_STATE_CAPTURING))
+        {
+            continue;
+        }
+
+        slot.f_frame_count = collect_signal_frames(context, slot.f_frames, THREAD_STACKS_FRAMES);
+
+        slot.f_state.store(SLOT_STATE_DONE, std::memory_order_release);
+        break;
+    }
+    errno = saved_errno;
+}
+
+
+/** \brief List the threads of this process.
+ *
+ * The directory is read with getdents64 since opendir() allocates memory.
+ *
+ * \param[out] tids  The array receiving the thread identifiers.
+ * \param[in] max  The size of \p tids.
+ *
+ * \return The total number of threads, which may be more than \p max.
+ */
+std::size_t list_threads(pid_t * tids, std::size_t max)
+{
+    struct linux_dirent64_t
+    {
+        ino64_t         d_ino;
+        off64_t         d_off;
+        unsigned short  d_reclen;
+        unsigned char   d_type;
+        char            d_name[];
+    };
+
+    int const dir(open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(dir < 0)
+    {
+        return 0;
+    }
+    std::size_t total(0);
+    alignas(linux_dirent64_t) char buf[1024];
+    for(;;)
+    {
+        long const r(syscall(SYS_getdents64, dir, buf, sizeof(buf)));
+        if(r <= 0)
+        {
+            break;
+        }
+        for(long pos(0); pos < r;)
+        {
+            linux_dirent64_t const * ent(reinterpret_cast<linux_dirent64_t const *>(buf + pos));
+            pos += ent->d_reclen;
+            if(ent->d_name[0] < '0'
+            || ent->d_name[0] > '9')
+            {
+                continue;
+            }
+            pid_t tid(0);
+            for(char const * s(ent->d_name); *s >= '0' && *s <= '9'; ++s)
+            {
+                tid = tid * 10 + (*s - '0');
+            }
+            if(total < max)
+            {
+                tids[total] = tid;
+            }
+            ++total;
+        }
+    }
+    close(dir);
+    return total;
+}
+
+
+/** \brief Take ownership of the slots.
+ *
+ * Only one capture can happen at a time. If the slots stay busy past
+ * \p deadline, the function gives up and returns false. The crash
+ * handler, which may interrupt a capture in progress, uses the slots
+ * anyway in that case.
+ *
+ * \param[in] deadline  The time after which the function gives up.
+ *
+ * \return true if the slots are now owned by the caller.
+ */
+bool acquire_slots(std::int64_t deadline)
+{
+    for(int iteration(0);; ++iteration)
+    {
+        bool expected(false);
+        if(g_busy.compare_exchange_strong(expected, true))
+        {
+            return true;
+        }
+        if(now_ns() >= deadline)
+        {
+            return false;
+        }
+        short_wait(iteration);
+    }
+}
+
+
+void release_slots(std::size_t count)
+{
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        g_slots[idx].f_tid.store(0, std::memory_order_relaxed);
+        int expected(SLOT_STATE_DONE);
+        if(!g_slots[idx].f_state.compare_exchange_strong(expected, SLOT_STATE_FREE))
+        {
+            expected = SLOT_STATE_ABANDONED;
+            g_slots[idx].f_state.compare_exchange_strong(expected, SLOT_STATE_FREE);
+        }
+    }
+    g_busy.store(false);
+}
+
+
+/** \brief Send the signal to each thread and wait for their frames.
+ *
+ * Slot \em i receives the frames of `tids[i]`. Once this function
+ * returns, a slot is either done or abandoned.
+ *
+ * \param[in] tids  The threads to capture.
+ * \param[in] count  The number of threads, at most THREAD_STACKS_MAX_THREADS.
+ * \param[in] deadline  The time after which the threads are abandoned.
+ */
+void capture_stacks(pid_t const * tids, std::size_t count, std::int64_t deadline)
+{
+    pid_t const pid(getpid());
+    int const sig(g_signal.load());
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        slot_t & slot(g_slots[idx]);
+
+        // a handler abandoned by a previous capture may still be writing
+        //
+        for(int iteration(0);
+               slot.f_state.load(std::memory_order_acquire) == SLOT_STATE_CAPTURING
+            && now_ns() < deadline;
+            ++iteration)
+        {
+            short_wait(iteration);
+        }
+
+        slot.f_frame_count = 0;
+        slot.f_tid.store(tids[idx], std::memory_order_relaxed);
+        slot.f_state.store(SLOT_STATE_REQUESTED, std::memory_order_release);
+        if(syscall(SYS_tgkill, pid, tids[idx], sig) != 0)
+        {
+            // the thread exited
+            //
+            slot.f_state.store(SLOT_STATE_ABANDONED);
+        }
+    }
+
+    for(int iteration(0);; ++iteration)
+    {
+        bool pending(false);
+        bool const expired(now_ns() >= deadline);
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            int state(g_slots[idx].f_state.load(std::memory_order_acquire));
+            if(state == SLOT_STATE_REQUESTED
+            && expired)
+            {
+                if(g_slots[idx].f_state.compare_exchange_strong(state, SLOT_STATE_ABANDONED))
+                {
+                    continue;
+                }
+            }
+            if(state == SLOT_STATE_REQUESTED
+            || state == SLOT_STATE_CAPTURING)
+            {
+                pending = true;
+            }
+        }
+        if(!pending
+        || expired)
+        {
+            // a thread still capturing past the deadline keeps its slot
+            // as is; the next capture waits for it
+            //
+            return;
+        }
+        short_wait(iteration);
+    }
+}
+
+
+/** \brief List the threads to capture, except the calling thread.
+ *
+ * \param[out] tids  The array receiving the thread identifiers.
+ * \param[out] count  The number of threads saved in \p tids.
+ *
+ * \return The total number of threads, which may be more than the size
+ * of \p tids plus one.
+ */
+std::size_t list_other_threads(pid_t (&tids)[THREAD_STACKS_MAX_THREADS], std::size_t & count)
+{
+    std::size_t const total(list_threads(tids, std::size(tids)));
+    count = std::min(total, std::size(tids));
+
+    pid_t const self(gettid());
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        if(tids[idx] == self)
+        {
+            tids[idx] = tids[count - 1];
+            --count;
+            break;
+        }
+    }
+
+    return total;
+}
+
+
+/** \brief Capture the frames of the specified threads.
+ *
+ * This function is the implementation of the public collect functions.
+ *
+ * \exception thread_stacks_error
+ * Raised if init_thread_stacks() was not called or if another capture
+ * keeps the slots busy for the whole timeout.
+ *
+ * \param[in] tids  The threads to capture.
+ * \param[in] count  The number of threads, at most THREAD_STACKS_MAX_THREADS.
+ * \param[in] timeout_ms  The maximum time to wait for the threads.
+ *
+ * \return One entry per thread, in the same order as \p tids.
+ */
+thread_stack_list_t collect_frames(pid_t const * tids, std::size_t count, int timeout_ms)
+{
+    if(g_signal.load() == 0)
+    {
+        throw thread_stacks_error("init_thread_stacks() must be called before capturing the stack of another thread.");
+    }
+
+    thread_stack_list_t result(count);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        result[idx].f_tid = tids[idx];
+        result[idx].f_frames.reserve(THREAD_STACKS_FRAMES);
+    }
+
+    std::int64_t const deadline(now_ns() + timeout_ms * 1'000'000LL);
+    if(!acquire_slots(deadline))
+    {
+        throw thread_stacks_error("the thread stack slots are busy.");
+    }
+
+    capture_stacks(tids, count, deadline);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        slot_t const & slot(g_slots[idx]);
+        if(slot.f_state.load(std::memory_order_acquire) == SLOT_STATE_DONE)
+        {
+            result[idx].f_captured = true;
+            result[idx].f_frames.assign(slot.f_frames, slot.f_frames + slot.f_frame_count);
+        }
+    }
+
+    release_slots(count);
+
+    return result;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Capture the frames of the code interrupted by a signal.
+ *
+ * This function is expected to be called from a signal handler. It
+ * captures the frames of the current thread and removes the frames of
+ * the handler and of the signal trampoline so the first frame is the
+ * interrupted instruction. When the interrupted instruction cannot be
+ * found (unsupported processor), all the frames are kept.
+ *
+ * The function does not allocate memory. The first call to backtrace()
+ * does, though, so init_thread_stacks() or a similar function must be
+ * called first.
+ *
+ * \param[in] context  The context received by the signal handler.
+ * \param[out] frames  The array receiving the frames.
+ * \param[in] max_frames  The size of \p frames.
+ *
+ * \return The number of frames saved in \p frames.
+ */
+int collect_signal_frames(void * context, void ** frames, int max_frames)
+{
+    void * all[THREAD_STACKS_FRAMES + 8];
+    int const count(backtrace(all, std::size(all)));
+    int first(0);
+    void * const pc(interrupted_pc(context));
+    for(int idx(0); idx < count; ++idx)
+    {
+        if(all[idx] == pc)
+        {
+            first = idx;
+            break;
+        }
+    }
+    int const kept(std::min(count - first, max_frames));
+    memcpy(frames, all + first, kept * sizeof(void *));
+    return kept;
+}
+
+
+/** \brief Install the handler used to capture the stacks of threads.
+ *
+ * This function installs a handler for \p sig, a signal reserved for
+ * this purpose. By default, SIGRTMAX - 1 is used.
+ *
+ * Once this function was called, the crash handler installed by
+ * init_report_signal() also dumps the stacks of all the other threads
+ * (see dump_thread_stacks()).
+ *
+ * \warning
+ * This function is not thread safe. Call it before starting threads.
+ *
+ * \exception thread_stacks_error
+ * Raised if \p sig is not valid, if the function was already called
+ * with a different signal, or if the handler cannot be installed.
+ *
+ * \param[in] sig  The signal to use or 0 for the default.
+ */
+void init_thread_stacks(int sig)
+{
+    if(sig == 0)
+    {
+        sig = SIGRTMAX - 1;
+    }
+    if(sig < 1
+    || sig > SIGRTMAX)
+    {
+        throw thread_stacks_error("invalid signal " + std::to_string(sig) + " for init_thread_stacks().");
+    }
+    int const current(g_signal.load());
+    if(current == sig)
+    {
+        return;
+    }
+    if(current != 0)
+    {
+        throw thread_stacks_error(
+                  "init_thread_stacks() already called with signal "
+                + std::to_string(current)
+                + ".");
+    }
+
+    // the first call to backtrace() loads libgcc which is not signal safe
+    //
+    void * frame(nullptr);
+    backtrace(&frame, 1);
+
+    struct sigaction action = {};
+    action.sa_sigaction = capture_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if(sigaction(sig, &action, nullptr) != 0)
+    {
+        throw thread_stacks_error("sigaction() failed to install the handler of signal " + std::to_string(sig) + ".");
+    }
+    g_signal.store(sig);
+}
+
+
+/** \brief Get the signal used to capture the stacks of threads.
+ *
+ * \return The signal passed to init_thread_stacks() or 0.
+ */
+int get_thread_stacks_signal()
+{
+    return g_signal.load();
+}
+
+
+/** \brief Write the stacks of all the other threads.
+ *
+ * This function sends a signal to each thread of the process, except
+ * the calling thread, and writes the raw frames they capture to \p fd.
+ * Threads which do not answer within \p timeout_ms (i.e. they block
+ * the signal or are stuck in the kernel) are reported as unavailable.
+ *
+ * The output looks like this:
+ *
+ * \code
+ *     thread stack: tid=1234
+ *       frame 0x7f3d5f4b1a2c
+ *       ...
+ *     thread stack: tid=1235 unavailable
+ *     end thread stacks
+ * \endcode
+ *
+ * The function only uses async-signal-safe functions and returns within
+ * about \p timeout_ms so it can be called from a crash handler. If
+ * init_thread_stacks() was not called, nothing is written.
+ *
+ * At most THREAD_STACKS_MAX_THREADS threads are captured.
+ *
+ * \param[in] fd  The file descriptor where the stacks get written.
+ * \param[in] timeout_ms  The maximum time to wait for the threads.
+ */
+void dump_thread_stacks(int fd, int timeout_ms)
+{
+    if(g_signal.load() == 0)
+    {
+        return;
+    }
+
+    std::int64_t const start(now_ns());
+    std::int64_t const deadline(start + timeout_ms * 1'000'000LL);
+
+    pid_t tids[THREAD_STACKS_MAX_THREADS];
+    std::size_t count(0);
+    std::size_t const total(list_other_threads(tids, count));
+
+    // if another capture does not release the slots in time, use them
+    // anyway; we are crashing
+    //
+    acquire_slots(start + timeout_ms * 500'000LL);
+    capture_stacks(tids, count, deadline);
+
+    signal_safe_writer out(fd);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        slot_t const & slot(g_slots[idx]);
+        out.append("thread stack: tid=");
+        out.append_decimal(tids[idx]);
+        if(slot.f_state.load(std::memory_order_acquire) != SLOT_STATE_DONE)
+        {
+            out.append(" unavailable\n");
+            continue;
+        }
+        out.append("\n");
+        for(int f(0); f < slot.f_frame_count; ++f)
+        {
+            out.append("  frame ");
+            out.append_hex(reinterpret_cast<std::uintptr_t>(slot.f_frames[f]));
+            out.append("\n");
+        }
+    }
+    if(total > std::size(tids) + 1)
+    {
+        out.append("thread stack: skipped=");
+        out.append_decimal(total - std::size(tids) - 1);
+        out.append("\n");
+    }
+    out.append("end thread stacks\n");
+
+    release_slots(count);
+}
+
+
+
+/** \brief Capture the raw frames of one thread.
+ *
+ * This function sends the signal reserved by init_thread_stacks() to
+ * \p tid and waits for that thread to save its frames. The process is
+ * not stopped; only the target thread runs a short signal handler.
+ * When the thread is running, this takes a few microseconds.
+ *
+ * If \p tid is the calling thread, the frames are captured directly.
+ *
+ * If the thread does not answer within \p timeout_ms (it blocks the
+ * signal, it is stuck in an uninterruptible system call, it exited...)
+ * the returned entry has its f_captured flag set to false.
+ *
+ * \exception thread_stacks_error
+ * Raised if init_thread_stacks() was not called or if another capture
+ * keeps the slots busy for the whole timeout.
+ *
+ * \param[in] tid  The identifier of the thread to capture.
+ * \param[in] timeout_ms  The maximum time to wait for the thread.
+ *
+ * \return The frames of the thread.
+ */
+thread_stack_t collect_thread_frames(pid_t tid, int timeout_ms)
+{
+    if(tid == gettid())
+    {
+        thread_stack_t result;
+        result.f_tid = tid;
+        result.f_captured = true;
+        result.f_frames.resize(THREAD_STACKS_FRAMES);
+        result.f_frames.resize(backtrace(result.f_frames.data(), THREAD_STACKS_FRAMES));
+        return result;
+    }
+
+    return collect_frames(&tid, 1, timeout_ms).front();
+}
+
+
+/** \brief Capture the raw frames of all the other threads.
+ *
+ * This function is similar to collect_thread_frames() for each thread
+ * of the process except the calling thread. All the threads get the
+ * signal at once so the total time is about the time of the slowest
+ * thread.
+ *
+ * At most THREAD_STACKS_MAX_THREADS threads are captured.
+ *
+ * \exception thread_stacks_error
+ * Raised if init_thread_stacks() was not called or if another capture
+ * keeps the slots busy for the whole timeout.
+ *
+ * \param[in] timeout_ms  The maximum time to wait for the threads.
+ *
+ * \return The frames of the threads.
+ */
+thread_stack_list_t collect_all_thread_frames(int timeout_ms)
+{
+    pid_t tids[THREAD_STACKS_MAX_THREADS];
+    std::size_t count(0);
+    list_other_threads(tids, count);
+    return collect_frames(tids, count, timeout_ms);
+}
+
+
+/** \brief Convert raw frames to a stack trace.
+ *
+ * The frames are converted with backtrace_symbols() so the result
+ * looks like the output of collect_stack_trace().
+ *
+ * \param[in] frames  The frames to convert.
+ *
+ * \return The stack trace.
+ */
+stack_trace_t thread_frames_to_stack_trace(thread_frames_t const & frames)
+{
+    stack_trace_t stack_trace;
+
+    if(!frames.empty())
+    {
+        std::unique_ptr<char *, decltype(&::free)> stack_string_list(
+                  backtrace_symbols(frames.data(), frames.size())
+                , &::free);
+        if(stack_string_list != nullptr)
+        {
+            for(std::size_t idx(0); idx < frames.size(); ++idx)
+            {
+                stack_trace.push_back(stack_string_list.get()[idx]);
+            }
+        }
+    }
+
+    return stack_trace;
+}
+
+
+/** \brief Get the stack trace of a live thread.
+ *
+ * This function answers the question "what is thread \p tid doing right
+ * now?" without attaching a debugger. It captures the frames with
+ * collect_thread_frames() and converts them to strings.
+ *
+ * \exception thread_stacks_error
+ * Raised if init_thread_stacks() was not called or if the thread did
+ * not answer within \p timeout_ms.
+ *
+ * \param[in] tid  The identifier of the thread to capture.
+ * \param[in] timeout_ms  The maximum time to wait for the thread.
+ *
+ * \return The stack trace of the thread.
+ */
+stack_trace_t collect_stack_trace_of_thread(pid_t tid, int timeout_ms)
+{
+    thread_stack_t const stack(collect_thread_frames(tid, timeout_ms));
+    if(!stack.f_captured)
+    {
+        throw thread_stacks_error(
+                  "thread "
+                + std::to_string(tid)
+                + " did not answer the stack capture request.");
+    }
+    return thread_frames_to_stack_trace(stack.f_frames);
+}
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,95 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/exception.h>
+#include    <libexcept/stack_trace.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+/** \file
+ * \brief Declarations of the functions capturing the stacks of threads.
+ *
+ * This file defines the functions used to capture the raw frames of
+ * the other threads of the process by sending them a signal, either
+ * on a crash or on demand.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(thread_stacks_error);
+
+
+constexpr std::size_t const     THREAD_STACKS_MAX_THREADS = 256;
+constexpr std::size_t const     THREAD_STACKS_FRAMES = 64;
+constexpr int const             THREAD_STACKS_DEFAULT_TIMEOUT_MS = 250;
+
+
+typedef std::vector<void *>     thread_frames_t;
+
+
+struct thread_stack_t
+{
+    pid_t                       f_tid = 0;
+    bool                        f_captured = false;
+    thread_frames_t             f_frames = thread_frames_t();
+};
+
+typedef std::vector<thread_stack_t>     thread_stack_list_t;
+
+
+void                            init_thread_stacks(int sig = 0);
+int                             get_thread_stacks_signal();
+void                            dump_thread_stacks(
+                                          int fd
+                                        , int timeout_ms = THREAD_STACKS_DEFAULT_TIMEOUT_MS);
+thread_stack_t                  collect_thread_frames(
+                                          pid_t tid
+                                        , int timeout_ms = THREAD_STACKS_DEFAULT_TIMEOUT_MS);
+thread_stack_list_t             collect_all_thread_frames(
+                                          int timeout_ms = THREAD_STACKS_DEFAULT_TIMEOUT_MS);
+stack_trace_t                   thread_frames_to_stack_trace(thread_frames_t const & frames);
+int                             collect_signal_frames(
+                                          void * context
+                                        , void ** frames
+                                        , int max_frames);
+stack_trace_t                   collect_stack_trace_of_thread(
+                                          pid_t tid
+                                        , int timeout_ms = THREAD_STACKS_DEFAULT_TIMEOUT_MS);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
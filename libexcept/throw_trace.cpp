@@ -0,0 +1,235 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/throw_trace.h"
+
+
+// C++
+//
+#include    <atomic>
+#include    <memory>
+
+
+// C
+//
+#include    <execinfo.h>
+#include    <stdlib.h>
+
+
+/** \file
+ * \brief Implementation of the throw trace capture.
+ *
+ * The libexcept exceptions collect a stack trace in their constructor.
+ * Other exceptions, such as std::bad_alloc, std::system_error, or the
+ * exceptions of third party libraries, arrive in a catch() block without
+ * any information about where they were thrown.
+ *
+ * The except_throw_trace library interposes the `__cxa_throw()` function
+ * of the C++ runtime (see throw_trace_hooks.cpp). When that library is
+ * loaded and the capture is turned on with set_capture_throw_stack(),
+ * each throw saves the raw addresses of the current stack in a thread
+ * local slot before the exception gets thrown. The catch() block can
+ * then retrieve the frames:
+ *
+ * \code
+ *     catch(std::exception const & e)
+ *     {
+ *         libexcept::throw_trace_t const * trace(libexcept::get_throw_trace(e));
+ *         if(trace != nullptr)
+ *         {
+ *             for(auto const & frame : libexcept::throw_trace_to_stack_trace(*trace))
+ *             {
+ *                 std::cerr << "  " << frame << "\n";
+ *             }
+ *         }
+ *     }
+ * \endcode
+ *
+ * The capture only saves raw addresses, no symbols get resolved and no
+ * memory gets allocated, so it is cheap enough to be used in production.
+ *
+ * This file only holds the slot and the functions to manage it, so
+ * processes which do not load except_throw_trace keep the C++ runtime
+ * `__cxa_throw()` untouched.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Whether __cxa_throw() captures the stack.
+ *
+ * The capture is off by default. Use set_capture_throw_stack() to
+ * turn it on.
+ */
+std::atomic<bool>           g_capture_throw_stack = std::atomic<bool>(false);
+
+
+/** \brief The frames of the last exception thrown by this thread.
+ *
+ * The slot gets overwritten by each throw. The catch() block should
+ * retrieve it before throwing anything else.
+ */
+thread_local throw_trace_t  g_throw_trace = throw_trace_t();
+
+
+
+} // no name namespace
+
+
+
+/** \brief Turn the capture of the throw stack on or off.
+ *
+ * When on, each C++ throw in this process saves the raw stack frames in
+ * a thread local slot. Use get_throw_trace() or get_last_throw_trace()
+ * to retrieve them.
+ *
+ * \note
+ * The throws only get captured if the process links against the
+ * except_throw_trace library (or loads it with LD_PRELOAD).
+ *
+ * \param[in] capture  Whether to capture the stack on throw.
+ */
+void set_capture_throw_stack(bool capture)
+{
+    if(capture)
+    {
+        // the first call to backtrace() loads libgcc, do it now instead
+        // of in the middle of a throw
+        //
+        void * frame;
+        backtrace(&frame, 1);
+    }
+    g_capture_throw_stack.store(capture, std::memory_order_relaxed);
+}
+
+
+/** \brief Check whether the throw stack gets captured.
+ *
+ * \return true if each C++ throw captures the stack.
+ */
+bool get_capture_throw_stack()
+{
+    return g_capture_throw_stack.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Save the stack of an exception being thrown.
+ *
+ * The `__cxa_throw()` replacement of the except_throw_trace library
+ * calls this function for each throw. If the capture is turned on, the
+ * raw stack frames and the thrown object get saved in this thread's
+ * slot. Otherwise the function does nothing.
+ *
+ * \param[in] object  The object being thrown.
+ * \param[in] type  The std::type_info of the object being thrown.
+ */
+void record_throw_trace(void const * object, std::type_info const * type)
+{
+    if(g_capture_throw_stack.load(std::memory_order_relaxed))
+    {
+        g_throw_trace.f_object = object;
+        g_throw_trace.f_type = type;
+        g_throw_trace.f_count = backtrace(g_throw_trace.f_frames, THROW_TRACE_DEPTH);
+    }
+}
+
+
+/** \brief Get the trace of the last exception thrown by this thread.
+ *
+ * The result is empty (f_count is 0) if the capture was off at the time
+ * or no exception was thrown yet.
+ *
+ * \return A reference to this thread's throw trace slot.
+ */
+throw_trace_t const & get_last_throw_trace()
+{
+    return g_throw_trace;
+}
+
+
+/** \brief Get the trace of a specific exception.
+ *
+ * This function returns the throw trace only if it was captured when
+ * \p e was thrown. If another exception was thrown since (or \p e is a
+ * copy of the thrown object), the function returns nullptr.
+ *
+ * \param[in] e  The exception caught by reference.
+ *
+ * \return The throw trace of \p e or nullptr.
+ */
+throw_trace_t const * get_throw_trace(std::exception const & e)
+{
+    if(g_throw_trace.f_count == 0
+    || g_throw_trace.f_object != dynamic_cast<void const *>(&e))
+    {
+        return nullptr;
+    }
+
+    return &g_throw_trace;
+}
+
+
+/** \brief Convert a throw trace to a stack trace.
+ *
+ * This function resolves the symbols of the raw frames the same way as
+ * collect_stack_trace() does. It allocates memory, so call it in the
+ * catch() block, not in a signal handler.
+ *
+ * \param[in] trace  The trace to convert.
+ *
+ * \return The list of strings representing the frames.
+ */
+stack_trace_t throw_trace_to_stack_trace(throw_trace_t const & trace)
+{
+    stack_trace_t stack_trace;
+
+    if(trace.f_count > 0)
+    {
+        std::unique_ptr<char *, decltype(&::free)> stack_string_list(backtrace_symbols(trace.f_frames, trace.f_count), &::free);
+        if(stack_string_list != nullptr)
+        {
+            for(int idx(0); idx < trace.f_count; ++idx)
+            {
+                stack_trace.push_back(stack_string_list.get()[idx]);
+            }
+        }
+    }
+
+    return stack_trace;
+}
+
+
+
+}
+// namespace libexcept
+
+
+
+// vim: ts=4 sw=4 et
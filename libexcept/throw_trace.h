@@ -0,0 +1,74 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/stack_trace.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <exception>
+#include    <typeinfo>
+
+
+
+/** \file
+ * \brief Declarations of the throw trace capture.
+ *
+ * This file defines the functions used to capture the raw stack frames
+ * of any C++ exception at the time it gets thrown, including exceptions
+ * which are not derived from the libexcept classes.
+ *
+ * The capture is opt-in: the `__cxa_throw()` function of the C++ runtime
+ * only gets replaced in processes which link against the
+ * except_throw_trace library or load it with LD_PRELOAD. Without it,
+ * set_capture_throw_stack() has no effect on the throws.
+ */
+
+
+namespace libexcept
+{
+
+
+constexpr std::size_t const     THROW_TRACE_DEPTH = 32;
+
+
+struct throw_trace_t
+{
+    void const *                f_object = nullptr;
+    std::type_info const *      f_type = nullptr;
+    int                         f_count = 0;
+    void *                      f_frames[THROW_TRACE_DEPTH] = {};
+};
+
+
+void                            set_capture_throw_stack(bool capture);
+bool                            get_capture_throw_stack();
+void                            record_throw_trace(void const * object, std::type_info const * type);
+throw_trace_t const &           get_last_throw_trace();
+throw_trace_t const *           get_throw_trace(std::exception const & e);
+stack_trace_t                   throw_trace_to_stack_trace(throw_trace_t const & trace);
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,130 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/throw_trace.h"
+
+
+// C
+//
+#include    <dlfcn.h>
+#include    <stdlib.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Replacement of the C++ runtime `__cxa_throw()` function.
+ *
+ * This file is compiled in its own library, except_throw_trace, so the
+ * C++ runtime function only gets replaced in processes which ask for it,
+ * either by linking against that library or by loading it with
+ * LD_PRELOAD:
+ *
+ * \code
+ *     LD_PRELOAD=libexcept_throw_trace.so my-daemon
+ * \endcode
+ *
+ * The replacement calls record_throw_trace() and then the original
+ * `__cxa_throw()`. The stack only gets saved once the capture is turned
+ * on with set_capture_throw_stack().
+ *
+ * \note
+ * The interposition works for throws that go through the dynamic linker,
+ * which is the case of the executable and the shared libraries loaded
+ * after except_throw_trace, libstdc++ included. Rethrowing (`throw;`)
+ * does not call `__cxa_throw()` so the slot keeps the original frames.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+namespace
+{
+
+
+
+typedef void (*cxa_throw_t)(void *, void *, void (*)(void *));
+
+
+/** \brief Find the original __cxa_throw() function.
+ *
+ * Our `__cxa_throw()` cannot throw anything without the original
+ * implementation. If the dynamic linker does not find it, the process
+ * cannot continue so this function prints an error and aborts.
+ *
+ * \return The next `__cxa_throw()` in the list of loaded objects.
+ */
+cxa_throw_t find_cxa_throw()
+{
+    cxa_throw_t const f(reinterpret_cast<cxa_throw_t>(dlsym(RTLD_NEXT, "__cxa_throw")));
+    if(f == nullptr)
+    {
+        char const msg[] = "except_throw_trace: fatal error: could not find the original __cxa_throw() function.\n";
+        if(write(STDERR_FILENO, msg, sizeof(msg) - 1) == -1)
+        {
+            // nothing more we can do, we abort anyway
+        }
+        abort();
+    }
+    return f;
+}
+
+
+
+} // no name namespace
+
+
+
+}
+// namespace libexcept
+
+
+
+/** \brief Capture the stack and throw an exception.
+ *
+ * This function replaces the C++ runtime `__cxa_throw()`. It lets
+ * record_throw_trace() save the raw stack frames and the thrown object
+ * in the thread local slot, then it calls the original `__cxa_throw()`.
+ *
+ * The type info parameter is declared as a `void *` to match the
+ * declaration the compiler has built in.
+ *
+ * \param[in] thrown_exception  The object being thrown.
+ * \param[in] tinfo  The std::type_info of the object being thrown.
+ * \param[in] dest  The destructor of the object being thrown.
+ */
+extern "C" [[noreturn]] void __cxa_throw(
+          void * thrown_exception
+        , void * tinfo
+        , void (*dest)(void *))
+{
+    libexcept::record_throw_trace(thrown_exception, static_cast<std::type_info const *>(tinfo));
+
+    static libexcept::cxa_throw_t const g_cxa_throw(libexcept::find_cxa_throw());
+    g_cxa_throw(thrown_exception, tinfo, dest);
+    __builtin_unreachable();
+}
+
+
+// vim: ts=4 sw=4 et
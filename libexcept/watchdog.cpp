@@ -0,0 +1,430 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "libexcept/watchdog.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <chrono>
+#include    <condition_variable>
+#include    <iostream>
+#include    <mutex>
+#include    <thread>
+#include    <vector>
+
+
+// C
+//
+#include    <pthread.h>
+#include    <unistd.h>
+
+
+/** \file
+ * \brief Implementation of the stall watchdog.
+ *
+ * A crash gets reported by report_signal(), a stall does not. This file
+ * implements a watchdog thread which detects threads that stopped making
+ * progress and reports the stack where they are stuck.
+ *
+ * A thread registers itself by creating a watchdog_registration object
+ * and calls heartbeat() each time it makes progress (i.e. once per loop
+ * iteration). The heartbeat is a counter saved with a single relaxed
+ * atomic store so it can be called in hot loops:
+ *
+ * \code
+ *     void worker()
+ *     {
+ *         libexcept::watchdog_registration watchdog("worker", 5'000);
+ *         for(;;)
+ *         {
+ *             watchdog.heartbeat();
+ *             ...
+ *         }
+ *     }
+ * \endcode
+ *
+ * The watchdog thread wakes up every period and compares each counter
+ * with the value it saw last. When a counter does not change for more
+ * than the threshold of its thread, the watchdog captures the stack of
+ * that thread with collect_thread_frames() and reports it. A stall is
+ * reported once; the report is re-armed when the thread sends a new
+ * heartbeat.
+ */
+
+
+
+namespace libexcept
+{
+
+
+
+/** \brief The watchdog data of one registered thread.
+ *
+ * The f_heartbeat counter is written by the registered thread. The
+ * other fields are only accessed by the watchdog thread, except for
+ * the constant ones set on registration and f_registered, which is
+ * protected by f_mutex.
+ *
+ * The watchdog holds f_mutex while it captures the stack of the thread,
+ * so the thread cannot unregister, exit, and have its identifier reused
+ * by another thread in the meantime.
+ */
+struct watchdog_entry_t
+{
+    pid_t                       f_tid = 0;
+    std::string                 f_name = std::string();
+    std::int64_t                f_threshold_ms = 0;
+    std::atomic<std::uint64_t>  f_heartbeat = 0;
+    std::mutex                  f_mutex = std::mutex();
+    bool                        f_registered = true;
+
+    std::uint64_t               f_last_seen = 0;
+    std::chrono::steady_clock::time_point
+                                f_last_change = std::chrono::steady_clock::time_point();
+    bool                        f_reported = false;
+};
+
+
+
+namespace
+{
+
+
+
+typedef std::shared_ptr<watchdog_entry_t>   entry_pointer_t;
+
+
+std::mutex                      g_watchdog_mutex = std::mutex();
+std::condition_variable         g_watchdog_condition = std::condition_variable();
+std::vector<entry_pointer_t>    g_entries = std::vector<entry_pointer_t>();
+std::thread                     g_watchdog_thread = std::thread();
+bool                            g_watchdog_stop = false;
+
+
+/** \brief Stop the watchdog on exit.
+ *
+ * A joinable std::thread calls std::terminate() when destroyed. If
+ * the process exits while the watchdog is running, this guard stops
+ * and joins the thread first. It is defined after the other globals
+ * so it gets destroyed before them.
+ */
+class watchdog_exit_guard
+{
+public:
+    ~watchdog_exit_guard()
+    {
+        stop_watchdog();
+    }
+};
+
+watchdog_exit_guard             g_watchdog_exit_guard = watchdog_exit_guard();
+
+
+/** \brief Write a stall to stderr.
+ *
+ * This is the reporter used when start_watchdog() is called without
+ * a callback.
+ *
+ * \param[in] stall  The stall to report.
+ */
+void default_report(watchdog_stall_t const & stall)
+{
+    std::cerr
+        << "watchdog: thread "
+        << stall.f_tid;
+    if(!stall.f_name.empty())
+    {
+        std::cerr << " (" << stall.f_name << ")";
+    }
+    std::cerr
+        << " did not send a heartbeat for "
+        << stall.f_stalled_ms
+        << "ms.\n";
+    if(!stall.f_stack.f_captured)
+    {
+        std::cerr << "watchdog: the stack of the thread is not available.\n";
+        return;
+    }
+    for(auto const & frame : thread_frames_to_stack_trace(stall.f_stack.f_frames))
+    {
+        std::cerr << "  stalled at: " << frame << '\n';
+    }
+}
+
+
+/** \brief Check the heartbeats of all the registered threads.
+ *
+ * The entries are copied so the stacks get captured without holding
+ * the lock, which would otherwise block the registration of new
+ * threads.
+ *
+ * An exception raised by \p callback gets reported to stderr and the
+ * watchdog continues with the next thread.
+ *
+ * \param[in] callback  The function called for each new stall.
+ */
+void check_heartbeats(watchdog_callback_t const & callback)
+{
+    std::vector<entry_pointer_t> entries;
+    {
+        std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+        entries = g_entries;
+    }
+
+    auto const now(std::chrono::steady_clock::now());
+    for(auto const & e : entries)
+    {
+        std::uint64_t const heartbeat(e->f_heartbeat.load(std::memory_order_relaxed));
+        if(heartbeat != e->f_last_seen
+        || e->f_last_change == std::chrono::steady_clock::time_point())
+        {
+            e->f_last_seen = heartbeat;
+            e->f_last_change = now;
+            e->f_reported = false;
+            continue;
+        }
+        if(e->f_reported)
+        {
+            continue;
+        }
+        std::int64_t const stalled_ms(std::chrono::duration_cast<std::chrono::milliseconds>(now - e->f_last_change).count());
+        if(stalled_ms < e->f_threshold_ms)
+        {
+            continue;
+        }
+        e->f_reported = true;
+
+        watchdog_stall_t stall;
+        stall.f_tid = e->f_tid;
+        stall.f_name = e->f_name;
+        stall.f_stalled_ms = stalled_ms;
+        {
+            // the thread may have unregistered since we copied the list,
+            // in which case its identifier may already be reused
+            //
+            std::lock_guard<std::mutex> lock(e->f_mutex);
+            if(!e->f_registered)
+            {
+                continue;
+            }
+            try
+            {
+                stall.f_stack = collect_thread_frames(e->f_tid);
+            }
+            catch(thread_stacks_error const &)
+            {
+                // report the stall without a stack
+                //
+                stall.f_stack.f_tid = e->f_tid;
+            }
+        }
+
+        // an exception escaping the watchdog thread would terminate the
+        // process
+        //
+        try
+        {
+            callback(stall);
+        }
+        catch(std::exception const & x)
+        {
+            std::cerr
+                << "watchdog: the stall callback raised an exception: "
+                << x.what()
+                << '\n';
+        }
+        catch(...)
+        {
+            std::cerr << "watchdog: the stall callback raised an unknown exception.\n";
+        }
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Register the calling thread with the watchdog.
+ *
+ * Once registered, the thread is expected to call heartbeat() at least
+ * once every \p threshold_ms milliseconds. If it does not, the watchdog
+ * reports the stall along with the stack of the thread.
+ *
+ * The registration ends when the object is destroyed. It must be
+ * destroyed by the thread which created it.
+ *
+ * The watchdog itself may be started before or after the registration.
+ *
+ * \exception watchdog_error
+ * Raised if \p threshold_ms is not positive.
+ *
+ * \param[in] name  A name used in the reports.
+ * \param[in] threshold_ms  The maximum time between two heartbeats.
+ */
+watchdog_registration::watchdog_registration(
+          std::string const & name
+        , int threshold_ms)
+{
+    if(threshold_ms <= 0)
+    {
+        throw watchdog_error("the watchdog threshold must be positive.");
+    }
+
+    f_entry = std::make_shared<watchdog_entry_t>();
+    f_entry->f_tid = gettid();
+    f_entry->f_name = name;
+    f_entry->f_threshold_ms = threshold_ms;
+    f_heartbeat = &f_entry->f_heartbeat;
+
+    std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+    g_entries.push_back(f_entry);
+}
+
+
+/** \brief Unregister the thread.
+ *
+ * The watchdog stops checking this thread. If the watchdog is capturing
+ * the stack of this thread, the destructor waits for the capture to end.
+ */
+watchdog_registration::~watchdog_registration()
+{
+    {
+        std::lock_guard<std::mutex> lock(f_entry->f_mutex);
+        f_entry->f_registered = false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+    auto it(std::find(g_entries.begin(), g_entries.end(), f_entry));
+    if(it != g_entries.end())
+    {
+        g_entries.erase(it);
+    }
+}
+
+
+/** \brief Start the watchdog thread.
+ *
+ * The watchdog checks the heartbeats of the registered threads every
+ * \p period_ms milliseconds. A stall is therefore detected between
+ * the threshold of the thread and the threshold plus the period.
+ *
+ * Each stall gets reported to \p callback, from the watchdog thread.
+ * If the callback raises an exception, it gets reported to stderr and
+ * the watchdog keeps running. Without a callback, the stall and the symbolized stack are written
+ * to stderr.
+ *
+ * The stacks get captured by signal (see init_thread_stacks()). If
+ * init_thread_stacks() was not called yet, it gets called with its
+ * default signal.
+ *
+ * \exception watchdog_error
+ * Raised if the watchdog is already running or if \p period_ms is not
+ * positive.
+ *
+ * \param[in] period_ms  How often the heartbeats get checked.
+ * \param[in] callback  The function called on each stall.
+ */
+void start_watchdog(int period_ms, watchdog_callback_t callback)
+{
+    if(period_ms <= 0)
+    {
+        throw watchdog_error("the watchdog period must be positive.");
+    }
+    if(get_thread_stacks_signal() == 0)
+    {
+        init_thread_stacks();
+    }
+    if(!callback)
+    {
+        callback = default_report;
+    }
+
+    std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+    if(g_watchdog_thread.joinable())
+    {
+        throw watchdog_error("the watchdog is already running.");
+    }
+    g_watchdog_stop = false;
+    g_watchdog_thread = std::thread([period_ms, callback]()
+        {
+            pthread_setname_np(pthread_self(), "watchdog");
+
+            std::unique_lock<std::mutex> thread_lock(g_watchdog_mutex);
+            while(!g_watchdog_stop)
+            {
+                g_watchdog_condition.wait_for(thread_lock, std::chrono::milliseconds(period_ms));
+                if(g_watchdog_stop)
+                {
+                    break;
+                }
+                thread_lock.unlock();
+                check_heartbeats(callback);
+                thread_lock.lock();
+            }
+        });
+}
+
+
+/** \brief Stop the watchdog thread.
+ *
+ * This function wakes up the watchdog thread and waits for it to exit.
+ * The registrations remain in place so the watchdog can be restarted.
+ *
+ * If the process exits while the watchdog is running, this function
+ * gets called automatically.
+ *
+ * Calling this function when the watchdog is not running has no effect.
+ */
+void stop_watchdog()
+{
+    std::thread t;
+    {
+        std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+        g_watchdog_stop = true;
+        std::swap(t, g_watchdog_thread);
+    }
+    g_watchdog_condition.notify_all();
+    if(t.joinable())
+    {
+        t.join();
+    }
+}
+
+
+/** \brief Check whether the watchdog thread is running.
+ *
+ * \return true between start_watchdog() and stop_watchdog().
+ */
+bool is_watchdog_running()
+{
+    std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+    return g_watchdog_thread.joinable();
+}
+
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
@@ -0,0 +1,101 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    <libexcept/thread_stacks.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+#include    <functional>
+#include    <memory>
+#include    <string>
+
+
+
+/** \file
+ * \brief Declarations of the stall watchdog.
+ *
+ * This file defines a watchdog thread which detects threads that stop
+ * sending heartbeats and reports the stack where they are stuck.
+ */
+
+
+namespace libexcept
+{
+
+
+DECLARE_MAIN_EXCEPTION(watchdog_error);
+
+
+constexpr int const             WATCHDOG_DEFAULT_PERIOD_MS = 100;
+
+
+struct watchdog_stall_t
+{
+    pid_t                       f_tid = 0;
+    std::string                 f_name = std::string();
+    std::int64_t                f_stalled_ms = 0;
+    thread_stack_t              f_stack = thread_stack_t();
+};
+
+typedef std::function<void(watchdog_stall_t const & stall)>     watchdog_callback_t;
+
+
+struct watchdog_entry_t;
+
+
+class watchdog_registration
+{
+public:
+                                watchdog_registration(
+                                          std::string const & name
+                                        , int threshold_ms);
+                                watchdog_registration(watchdog_registration const &) = delete;
+                                ~watchdog_registration();
+
+    watchdog_registration &     operator = (watchdog_registration const &) = delete;
+
+    void                        heartbeat()
+                                {
+                                    f_heartbeat->store(++f_count, std::memory_order_relaxed);
+                                }
+
+private:
+    std::shared_ptr<watchdog_entry_t>
+                                f_entry = std::shared_ptr<watchdog_entry_t>();
+    std::atomic<std::uint64_t> *f_heartbeat = nullptr;
+    std::uint64_t               f_count = 0;
+};
+
+
+void                            start_watchdog(
+                                          int period_ms = WATCHDOG_DEFAULT_PERIOD_MS
+                                        , watchdog_callback_t callback = watchdog_callback_t());
+void                            stop_watchdog();
+bool                            is_watchdog_running();
+
+
+}
+// namespace libexcept
+// vim: ts=4 sw=4 et
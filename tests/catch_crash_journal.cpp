@@ -0,0 +1,197 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/crash_journal.h>
+#include    <libexcept/report_signal.h>
+
+
+// C
+//
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+DECLARE_MAIN_EXCEPTION(journaled_exception);
+DECLARE_EXCEPTION(journaled_exception, journaled_sub_exception);
+
+
+}
+
+
+
+CATCH_TEST_CASE("crash_journal", "[journal]")
+{
+    CATCH_START_SECTION("crash_journal: exceptions wrap around")
+    {
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/exceptions.journal");
+        unlink(filename.c_str());
+
+        CATCH_CHECK_FALSE(libexcept::has_crash_journal());
+        libexcept::open_crash_journal(filename, 4);
+        CATCH_CHECK(libexcept::has_crash_journal());
+
+        for(int idx(1); idx <= 6; ++idx)
+        {
+            libexcept::exception_t e("exception #" + std::to_string(idx));
+        }
+
+        libexcept::close_crash_journal();
+        CATCH_CHECK_FALSE(libexcept::has_crash_journal());
+
+        // not recorded anymore
+        //
+        libexcept::exception_t e("not in journal");
+
+        libexcept::journal_records_t records(libexcept::read_crash_journal(filename));
+        CATCH_REQUIRE(records.size() == 4);
+        for(std::size_t idx(0); idx < records.size(); ++idx)
+        {
+            CATCH_CHECK(records[idx].f_sequence == idx + 3);
+            CATCH_CHECK(records[idx].f_type == libexcept::journal_record_type_t::JOURNAL_RECORD_EXCEPTION);
+            CATCH_CHECK(records[idx].f_pid == getpid());
+            CATCH_CHECK(records[idx].f_name == typeid(libexcept::exception_t).name());
+            CATCH_CHECK(records[idx].f_message == "exception #" + std::to_string(idx + 3));
+            CATCH_CHECK_FALSE(records[idx].f_frames.empty());
+        }
+
+        // reopening keeps the existing records
+        //
+        libexcept::open_crash_journal(filename, 4);
+        {
+            libexcept::logic_exception_t e7("exception #7");
+        }
+        libexcept::close_crash_journal();
+
+        records = libexcept::read_crash_journal(filename);
+        CATCH_REQUIRE(records.size() == 4);
+        CATCH_CHECK(records[0].f_message == "exception #4");
+        CATCH_CHECK(records[3].f_message == "exception #7");
+        CATCH_CHECK(records[3].f_sequence == 7);
+
+        // a different geometry resets the journal
+        //
+        libexcept::open_crash_journal(filename, 8);
+        libexcept::close_crash_journal();
+        CATCH_CHECK(libexcept::read_crash_journal(filename).empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crash_journal: declared exceptions save their own type")
+    {
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/declared.journal");
+        unlink(filename.c_str());
+
+        libexcept::open_crash_journal(filename, 4);
+        try
+        {
+            throw journaled_exception("main");
+        }
+        catch(journaled_exception const &)
+        {
+        }
+        {
+            journaled_sub_exception e("sub");
+        }
+        libexcept::close_crash_journal();
+
+        libexcept::journal_records_t const records(libexcept::read_crash_journal(filename));
+        CATCH_REQUIRE(records.size() == 2);
+        CATCH_CHECK(records[0].f_sequence == 1);
+        CATCH_CHECK(records[0].f_name == typeid(journaled_exception).name());
+        CATCH_CHECK(records[0].f_message == "journaled_exception: main");
+        CATCH_CHECK(records[1].f_sequence == 2);
+        CATCH_CHECK(records[1].f_name == typeid(journaled_sub_exception).name());
+        CATCH_CHECK(records[1].f_message == "journaled_exception: sub");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crash_journal: records survive SIGKILL and crashes")
+    {
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/crash.journal");
+        unlink(filename.c_str());
+
+        for(int const sig : { SIGKILL, SIGSEGV })
+        {
+            pid_t const child(fork());
+            CATCH_REQUIRE(child != -1);
+            if(child == 0)
+            {
+                signal(SIGABRT, SIG_DFL);
+                libexcept::open_crash_journal(filename, 16);
+                libexcept::init_report_signal();
+                libexcept::out_of_range_t e("before the signal");
+                raise(sig);
+                _exit(1);   // not reached
+            }
+
+            int status(0);
+            CATCH_REQUIRE(waitpid(child, &status, 0) == child);
+            CATCH_REQUIRE(WIFSIGNALED(status));
+        }
+
+        libexcept::journal_records_t const records(libexcept::read_crash_journal(filename));
+        CATCH_REQUIRE(records.size() == 3);
+        CATCH_CHECK(records[0].f_type == libexcept::journal_record_type_t::JOURNAL_RECORD_EXCEPTION);
+        CATCH_CHECK(records[0].f_message == "before the signal");
+        CATCH_CHECK(records[1].f_type == libexcept::journal_record_type_t::JOURNAL_RECORD_EXCEPTION);
+        CATCH_CHECK(records[1].f_pid != records[0].f_pid);
+        CATCH_CHECK(records[2].f_type == libexcept::journal_record_type_t::JOURNAL_RECORD_CRASH);
+        CATCH_CHECK(records[2].f_signal == SIGSEGV);
+        CATCH_CHECK(records[2].f_name == "SEGV");
+        CATCH_CHECK(records[2].f_pid == records[1].f_pid);
+        CATCH_CHECK_FALSE(records[2].f_frames.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crash_journal: invalid files")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::read_crash_journal(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/does-not-exist.journal")
+                , libexcept::crash_journal_error);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::read_crash_journal("/proc/self/cmdline")
+                , libexcept::crash_journal_error);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::open_crash_journal(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/zero.journal", 0)
+                , libexcept::crash_journal_error);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::open_crash_journal(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/huge.journal", libexcept::CRASH_JOURNAL_MAX_SLOTS + 1)
+                , libexcept::crash_journal_error);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::open_crash_journal(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/overflow.journal", SIZE_MAX / 2)
+                , libexcept::crash_journal_error);
+        CATCH_CHECK_FALSE(libexcept::has_crash_journal());
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,137 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/exception.h>
+#include    <libexcept/exception_context.h>
+
+
+// C++
+//
+#include    <thread>
+#include    <type_traits>
+
+
+
+namespace
+{
+
+
+DECLARE_MAIN_EXCEPTION(context_exception);
+
+
+// a temporary string would be destroyed before the guard
+//
+static_assert(std::is_constructible_v<libexcept::exception_context, char const *, std::string const &>);
+static_assert(!std::is_constructible_v<libexcept::exception_context, char const *, std::string &&>);
+static_assert(!std::is_constructible_v<libexcept::exception_context, char const *, std::string>);
+
+
+[[noreturn]] void parse_line(int line)
+{
+    std::string const line_number(std::to_string(line));
+    libexcept::exception_context line_context("line", line_number);
+    throw context_exception("syntax error");
+}
+
+
+
+}
+
+
+CATCH_TEST_CASE("exception_context", "[context][exception]")
+{
+    CATCH_START_SECTION("exception context parameters")
+    {
+        CATCH_CHECK(libexcept::get_exception_context() == nullptr);
+
+        {
+            context_exception e("no context");
+            CATCH_CHECK(e.get_parameters().empty());
+        }
+
+        libexcept::exception_context request_context("request_id", "r-1234");
+        CATCH_CHECK(libexcept::get_exception_context() == &request_context);
+        CATCH_CHECK(strcmp(request_context.get_name(), "request_id") == 0);
+        CATCH_CHECK(strcmp(request_context.get_value(), "r-1234") == 0);
+        CATCH_CHECK(request_context.get_previous() == nullptr);
+
+        try
+        {
+            libexcept::exception_context file_context("filename", "/etc/config.conf");
+            CATCH_CHECK(file_context.get_previous() == &request_context);
+            parse_line(33);
+        }
+        catch(context_exception const & e)
+        {
+            CATCH_CHECK(e.get_parameter("request_id") == "r-1234");
+            CATCH_CHECK(e.get_parameter("filename") == "/etc/config.conf");
+            CATCH_CHECK(e.get_parameter("line") == "33");
+            CATCH_CHECK(e.get_parameters().size() == 3);
+        }
+
+        // the guards were popped while unwinding
+        //
+        CATCH_CHECK(libexcept::get_exception_context() == &request_context);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("exception context innermost wins")
+    {
+        libexcept::exception_context outer("name", "outer");
+        {
+            libexcept::exception_context inner("name", "inner");
+            context_exception e("shadowed");
+            CATCH_CHECK(e.get_parameter("name") == "inner");
+        }
+        context_exception e("not shadowed");
+        CATCH_CHECK(e.get_parameter("name") == "outer");
+
+        // set_parameter() still overwrites
+        //
+        e.set_parameter("name", "explicit");
+        CATCH_CHECK(e.get_parameter("name") == "explicit");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("exception context is per thread")
+    {
+        libexcept::exception_context main_context("thread", "main");
+
+        std::string other;
+        std::thread t([&other]()
+            {
+                context_exception e("in thread");
+                other = e.get_parameter("thread");
+            });
+        t.join();
+
+        CATCH_CHECK(other.empty());
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -27,6 +27,11 @@
 #include    <libexcept/exception.h>
 
 
+// C++
+//
+#include    <type_traits>
+
+
 
 
 
@@ -35,6 +40,11 @@ namespace
 
 
 
+// a cause must be attached explicitly
+//
+static_assert(std::is_constructible_v<libexcept::exception_base_t, std::exception_ptr>);
+static_assert(!std::is_convertible_v<std::exception_ptr, libexcept::exception_base_t>);
+
 
 
 }
@@ -430,6 +440,259 @@ CATCH_TEST_CASE("exception_parameters", "[parameters][exception]")
         }
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("exception parameters are copied on write")
+    {
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+        libexcept::exception_t original("shared payload");
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+
+        original.set_parameter("filename", "/etc/aliases");
+
+        // a copy shares the payload
+        //
+        libexcept::exception_t copy(original);
+        CATCH_CHECK(&copy.get_stack_trace() == &original.get_stack_trace());
+        CATCH_CHECK(&copy.get_parameters() == &original.get_parameters());
+        CATCH_CHECK(copy.get_parameter("filename") == "/etc/aliases");
+
+        // changing a parameter detaches the copy
+        //
+        copy.set_parameter("line", "33");
+        CATCH_CHECK(&copy.get_parameters() != &original.get_parameters());
+        CATCH_CHECK(copy.get_stack_trace() == original.get_stack_trace());
+        CATCH_CHECK(copy.get_parameters().size() == 2);
+        CATCH_CHECK(original.get_parameters().size() == 1);
+        CATCH_CHECK(original.get_parameter("line").empty());
+
+        // a move transfers the payload
+        //
+        libexcept::stack_trace_t const * trace(&copy.get_stack_trace());
+        libexcept::exception_t moved(std::move(copy));
+        CATCH_CHECK(&moved.get_stack_trace() == trace);
+        CATCH_CHECK(moved.get_parameter("line") == "33");
+        CATCH_CHECK(strcmp(moved.what(), "shared payload") == 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("declared_exception", "[trace][exception]")
+{
+    CATCH_START_SECTION("declared exception messages")
+    {
+        DECLARE_MAIN_EXCEPTION(test_main_exception);
+        DECLARE_EXCEPTION(test_main_exception, test_sub_exception);
+        DECLARE_OUT_OF_RANGE(test_range_exception);
+
+        CATCH_CHECK(test_main_exception::prefix() == "test_main_exception: ");
+
+        std::string const msg("from a string");
+        test_main_exception a(msg);
+        CATCH_CHECK(strcmp(a.what(), "test_main_exception: from a string") == 0);
+
+        test_main_exception b(std::string("from a temporary"));
+        CATCH_CHECK(strcmp(b.what(), "test_main_exception: from a temporary") == 0);
+
+        std::string_view const view("from a view which is not terminated", 11);
+        test_range_exception c(view);
+        CATCH_CHECK(strcmp(c.what(), "test_range_exception: from a view") == 0);
+
+        test_sub_exception d("sub-exception");
+        CATCH_CHECK(strcmp(d.what(), "test_main_exception: sub-exception") == 0);
+
+        libexcept::exception_t e(view);
+        CATCH_CHECK(strcmp(e.what(), "from a view") == 0);
+
+        std::string const large(1000, 'x');
+        test_main_exception f(large);
+        CATCH_CHECK(f.what() == "test_main_exception: " + large);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("declared exception stack trace depth")
+    {
+        DECLARE_LOGIC_ERROR(test_depth_exception);
+        DECLARE_EXCEPTION(libexcept::exception_t, test_derived_exception);
+
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+
+        test_depth_exception a("three frames", 3);
+        CATCH_CHECK(a.get_stack_trace().size() > 0);
+        CATCH_CHECK(a.get_stack_trace().size() <= 3);
+
+        test_depth_exception b("no frames", 0);
+        CATCH_CHECK(b.get_stack_trace().empty());
+
+        test_derived_exception c("two frames", 2);
+        CATCH_CHECK(strcmp(c.what(), "two frames") == 0);
+        CATCH_CHECK(c.get_stack_trace().size() > 0);
+        CATCH_CHECK(c.get_stack_trace().size() <= 2);
+
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("declared exception from a hand written base")
+    {
+        class hand_written_exception
+            : public std::runtime_error
+        {
+        public:
+            hand_written_exception(std::string const & msg)
+                : runtime_error("hand written: " + msg)
+            {
+            }
+        };
+        DECLARE_EXCEPTION(hand_written_exception, test_hand_written_exception);
+
+        std::string const msg("only a string constructor");
+        test_hand_written_exception e(msg);
+        CATCH_CHECK(strcmp(e.what(), "hand written: only a string constructor") == 0);
+
+        hand_written_exception const & base(e);
+        CATCH_CHECK(strcmp(base.what(), e.what()) == 0);
+
+        // bases without exactly one std::exception work too
+        //
+        class plain_error
+        {
+        public:
+            plain_error(std::string const & msg)
+                : f_msg(msg)
+            {
+            }
+
+            std::string f_msg;
+        };
+        DECLARE_EXCEPTION(plain_error, test_plain_error);
+
+        test_plain_error p(msg);
+        CATCH_CHECK(p.f_msg == msg);
+
+        class ambiguous_exception
+            : public std::runtime_error
+            , public std::logic_error
+        {
+        public:
+            ambiguous_exception(std::string const & msg)
+                : runtime_error(msg)
+                , logic_error(msg)
+            {
+            }
+        };
+        DECLARE_EXCEPTION(ambiguous_exception, test_ambiguous_exception);
+
+        test_ambiguous_exception a(msg);
+        CATCH_CHECK(strcmp(static_cast<std::runtime_error const &>(a).what(), msg.c_str()) == 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("exception_cause", "[trace][exception]")
+{
+    CATCH_START_SECTION("exception cause chain")
+    {
+        DECLARE_MAIN_EXCEPTION(test_io_exception);
+        DECLARE_LOGIC_ERROR(test_config_exception);
+
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+
+        std::exception_ptr cause;
+        try
+        {
+            test_io_exception e("disk on fire");
+            e.set_parameter("device", "/dev/sda");
+            throw e;
+        }
+        catch(test_io_exception const &)
+        {
+            cause = std::current_exception();
+        }
+
+        test_config_exception wrapper("could not load settings", cause);
+        CATCH_CHECK(strcmp(wrapper.what(), "test_config_exception: could not load settings") == 0);
+        CATCH_CHECK(wrapper.get_cause() == cause);
+
+        // the cause is shared, not copied
+        //
+        std::exception const * c(wrapper.get_cause_exception());
+        CATCH_REQUIRE(c != nullptr);
+        CATCH_CHECK(strcmp(c->what(), "test_io_exception: disk on fire") == 0);
+        libexcept::exception_base_t const * base(dynamic_cast<libexcept::exception_base_t const *>(c));
+        CATCH_REQUIRE(base != nullptr);
+        CATCH_CHECK(base->get_parameter("device") == "/dev/sda");
+
+        // no new trace was collected, the root one is used instead
+        //
+        CATCH_CHECK(wrapper.get_stack_trace().empty());
+        CATCH_CHECK(!base->get_stack_trace().empty());
+        CATCH_CHECK(&wrapper.get_root_stack_trace() == &base->get_stack_trace());
+
+        // walk the chain
+        //
+        libexcept::exception_t top("top level", std::make_exception_ptr(wrapper));
+        libexcept::exception_chain_t const chain(libexcept::get_exception_chain(top));
+        CATCH_REQUIRE(chain.size() == 3);
+        CATCH_CHECK(chain[0] == &top);
+        CATCH_CHECK(strcmp(chain[1]->what(), "test_config_exception: could not load settings") == 0);
+        CATCH_CHECK(chain[2] == c);
+        CATCH_CHECK(top.get_stack_trace().empty());
+        CATCH_CHECK(&top.get_root_stack_trace() == &base->get_stack_trace());
+
+        // a copy shares the cause
+        //
+        test_config_exception copy(wrapper);
+        CATCH_CHECK(copy.get_cause_exception() == c);
+
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("exception cause stack trace options")
+    {
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+
+        // a cause without a stack trace does not prevent collection
+        //
+        std::exception_ptr const plain(std::make_exception_ptr(std::runtime_error("plain")));
+        libexcept::exception_t a("wrap plain", plain);
+        CATCH_CHECK(!a.get_stack_trace().empty());
+        CATCH_CHECK(&a.get_root_stack_trace() == &a.get_stack_trace());
+        CATCH_REQUIRE(a.get_cause_exception() != nullptr);
+        CATCH_CHECK(strcmp(a.get_cause_exception()->what(), "plain") == 0);
+        CATCH_CHECK(libexcept::get_exception_chain(a).size() == 2);
+
+        // a cause which is not a std::exception is kept but not walked
+        //
+        libexcept::exception_t b("wrap int", std::make_exception_ptr(33));
+        CATCH_CHECK(b.get_cause() != nullptr);
+        CATCH_CHECK(b.get_cause_exception() == nullptr);
+        CATCH_CHECK(libexcept::get_exception_chain(b).size() == 1);
+
+        // turn off the reuse
+        //
+        CATCH_CHECK(libexcept::get_reuse_cause_stack());
+        libexcept::set_reuse_cause_stack(false);
+        CATCH_CHECK(!libexcept::get_reuse_cause_stack());
+        libexcept::out_of_range_t c("wrap again", std::make_exception_ptr(a));
+        CATCH_CHECK(!c.get_stack_trace().empty());
+        libexcept::set_reuse_cause_stack(true);
+
+        // set_cause() detaches a shared payload
+        //
+        libexcept::exception_t d(b);
+        d.set_cause(plain);
+        CATCH_CHECK(d.get_cause() == plain);
+        CATCH_CHECK(b.get_cause() != plain);
+        d.set_cause(std::exception_ptr());
+        CATCH_CHECK(d.get_cause() == nullptr);
+        CATCH_CHECK(d.get_cause_exception() == nullptr);
+
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+    }
+    CATCH_END_SECTION()
 }
 
 
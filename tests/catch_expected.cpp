@@ -0,0 +1,142 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/expected.h>
+
+
+
+namespace
+{
+
+
+libexcept::expected<int> parse_digit(char c)
+{
+    if(c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    libexcept::error_result_t e("not a digit", libexcept::error_kind_t::ERROR_KIND_OUT_OF_RANGE);
+    e.set_parameter("character", std::string(1, c));
+    return e;
+}
+
+
+libexcept::expected<void> check_even(int value)
+{
+    if((value & 1) == 0)
+    {
+        return {};
+    }
+
+    return libexcept::error_result_t("odd value", libexcept::error_kind_t::ERROR_KIND_LOGIC);
+}
+
+
+}
+
+
+CATCH_TEST_CASE("expected", "[expected][exception]")
+{
+    CATCH_START_SECTION("expected: value")
+    {
+        libexcept::expected<int> const r(parse_digit('7'));
+        CATCH_REQUIRE(r.has_value());
+        CATCH_REQUIRE(static_cast<bool>(r));
+        CATCH_CHECK(r.value() == 7);
+        CATCH_CHECK(*r == 7);
+        CATCH_CHECK(r.value_or(3) == 7);
+
+        libexcept::expected<std::string> s(std::string("value"));
+        CATCH_CHECK(s->length() == 5);
+        std::string const moved(std::move(s).value());
+        CATCH_CHECK(moved == "value");
+
+        CATCH_CHECK(check_even(4).has_value());
+        check_even(4).value();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("expected: error promoted to out_of_range_t")
+    {
+        libexcept::expected<int> const r(parse_digit('x'));
+        CATCH_REQUIRE_FALSE(r.has_value());
+        CATCH_CHECK(r.value_or(3) == 3);
+        CATCH_CHECK(r.error().get_message() == "not a digit");
+        CATCH_CHECK(r.error().get_kind() == libexcept::error_kind_t::ERROR_KIND_OUT_OF_RANGE);
+        CATCH_CHECK(r.error().get_parameter("character") == "x");
+        CATCH_CHECK(r.error().get_stack_trace().empty());
+
+        try
+        {
+            r.value();
+            CATCH_REQUIRE(!"value() did not throw");
+        }
+        catch(libexcept::out_of_range_t const & e)
+        {
+            CATCH_CHECK(strcmp(e.what(), "not a digit") == 0);
+            CATCH_CHECK(e.get_parameter("character") == "x");
+
+            // the payload is shared, not copied
+            //
+            CATCH_CHECK(&e.get_parameters() == &r.error().get_parameters());
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("expected: void error promoted to logic_exception_t")
+    {
+        libexcept::expected<void> const r(check_even(5));
+        CATCH_REQUIRE_FALSE(r.has_value());
+        CATCH_CHECK(r.error().get_kind() == libexcept::error_kind_t::ERROR_KIND_LOGIC);
+        CATCH_REQUIRE_THROWS_AS(r.value(), libexcept::logic_exception_t);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("expected: error with a stack trace promoted to exception_t")
+    {
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+        libexcept::error_result_t const error("with a trace", libexcept::error_kind_t::ERROR_KIND_RUNTIME, libexcept::STACK_TRACE_DEPTH);
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+        CATCH_CHECK_FALSE(error.get_stack_trace().empty());
+
+        libexcept::expected<double> const r(error);
+        try
+        {
+            r.value();
+            CATCH_REQUIRE(!"value() did not throw");
+        }
+        catch(libexcept::exception_t const & e)
+        {
+            CATCH_CHECK(strcmp(e.what(), "with a trace") == 0);
+            CATCH_CHECK(e.get_stack_trace() == error.get_stack_trace());
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
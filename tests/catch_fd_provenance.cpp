@@ -0,0 +1,239 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/fd_provenance.h>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <signal.h>
+#include    <string.h>
+#include    <sys/epoll.h>
+#include    <sys/eventfd.h>
+#include    <sys/inotify.h>
+#include    <sys/mman.h>
+#include    <sys/signalfd.h>
+#include    <sys/socket.h>
+#include    <sys/syscall.h>
+#include    <sys/timerfd.h>
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("fd_provenance", "[fd_provenance]")
+{
+    CATCH_START_SECTION("fd_provenance: untracked by default")
+    {
+        CATCH_CHECK_FALSE(libexcept::get_track_fd_provenance());
+
+        int const fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(fd >= 0);
+        CATCH_CHECK(libexcept::get_fd_provenance(fd).empty());
+        close(fd);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("fd_provenance: track descriptor creation")
+    {
+        libexcept::set_track_fd_provenance(true);
+        CATCH_CHECK(libexcept::get_track_fd_provenance());
+
+        int const fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(fd >= 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(fd).empty());
+
+        void * frames[libexcept::FD_PROVENANCE_FRAMES];
+        CATCH_CHECK(libexcept::get_fd_provenance_frames(fd, frames, libexcept::FD_PROVENANCE_FRAMES) > 0);
+        CATCH_CHECK(libexcept::get_fd_provenance_frames(fd, frames, 0) == 0);
+        CATCH_CHECK(libexcept::get_fd_provenance_frames(-1, frames, libexcept::FD_PROVENANCE_FRAMES) == 0);
+
+        int const copy(dup(fd));
+        CATCH_REQUIRE(copy >= 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(copy).empty());
+
+        // close() forgets the descriptor
+        //
+        close(fd);
+        CATCH_CHECK(libexcept::get_fd_provenance(fd).empty());
+        close(copy);
+
+        int pipes[2];
+        CATCH_REQUIRE(pipe2(pipes, O_CLOEXEC) == 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(pipes[0]).empty());
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(pipes[1]).empty());
+        close(pipes[0]);
+        close(pipes[1]);
+
+        int sockets[2];
+        CATCH_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(sockets[0]).empty());
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(sockets[1]).empty());
+        close(sockets[0]);
+        close(sockets[1]);
+
+        int const s(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        CATCH_REQUIRE(s >= 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(s).empty());
+        close(s);
+
+        // turning the tracker off stops the recording
+        //
+        libexcept::set_track_fd_provenance(false);
+        int const untracked(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(untracked >= 0);
+        CATCH_CHECK(libexcept::get_fd_provenance(untracked).empty());
+        close(untracked);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("fd_provenance: other descriptor creators")
+    {
+        libexcept::set_track_fd_provenance(true);
+
+        std::vector<int> fds;
+        fds.push_back(eventfd(0, EFD_CLOEXEC));
+        fds.push_back(epoll_create1(EPOLL_CLOEXEC));
+        fds.push_back(memfd_create("fd_provenance", MFD_CLOEXEC));
+        fds.push_back(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC));
+        fds.push_back(inotify_init1(IN_CLOEXEC));
+
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGUSR2);
+        fds.push_back(signalfd(-1, &mask, SFD_CLOEXEC));
+
+        fds.push_back(fcntl(fds[0], F_DUPFD_CLOEXEC, 100));
+        CATCH_CHECK(fds.back() >= 100);
+
+        for(auto const fd : fds)
+        {
+            CATCH_REQUIRE(fd >= 0);
+            CATCH_CHECK_FALSE(libexcept::get_fd_provenance(fd).empty());
+        }
+
+        // a descriptor received with SCM_RIGHTS is new in this process
+        //
+        int sockets[2];
+        CATCH_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == 0);
+        {
+            // send a descriptor created without going through our hooks
+            //
+            int const untracked(syscall(SYS_eventfd2, 0, EFD_CLOEXEC));
+            CATCH_REQUIRE(untracked >= 0);
+            CATCH_CHECK(libexcept::get_fd_provenance(untracked).empty());
+
+            char data('x');
+            iovec iov{ &data, 1 };
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr * cmsg(CMSG_FIRSTHDR(&msg));
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &untracked, sizeof(int));
+            CATCH_REQUIRE(sendmsg(sockets[0], &msg, 0) == 1);
+            close(untracked);
+        }
+        {
+            char data(0);
+            iovec iov{ &data, 1 };
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            CATCH_REQUIRE(recvmsg(sockets[1], &msg, MSG_CMSG_CLOEXEC) == 1);
+            cmsghdr * cmsg(CMSG_FIRSTHDR(&msg));
+            CATCH_REQUIRE(cmsg != nullptr);
+            int received(-1);
+            memcpy(&received, CMSG_DATA(cmsg), sizeof(int));
+            CATCH_REQUIRE(received >= 0);
+            CATCH_CHECK_FALSE(libexcept::get_fd_provenance(received).empty());
+            close(received);
+        }
+        close(sockets[0]);
+        close(sockets[1]);
+
+        for(auto const fd : fds)
+        {
+            close(fd);
+        }
+
+        libexcept::set_track_fd_provenance(false);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("fd_provenance: no stale provenance on reused descriptors")
+    {
+        libexcept::set_track_fd_provenance(true);
+
+        // close_range() forgets the descriptors; the new descriptor is
+        // created without our hooks and points to the same file
+        //
+        int const fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(fd >= 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(fd).empty());
+        CATCH_REQUIRE(close_range(fd, fd, 0) == 0);
+        int const same(syscall(SYS_openat, AT_FDCWD, "/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(same == fd);
+        CATCH_CHECK(libexcept::get_fd_provenance(same).empty());
+        syscall(SYS_close, same);
+
+        // a descriptor closed behind our back and reused for another file
+        // does not show the frames of the old file
+        //
+        int const old(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(old >= 0);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(old).empty());
+        syscall(SYS_close, old);
+        int const reused(syscall(SYS_eventfd2, 0, EFD_CLOEXEC));
+        CATCH_REQUIRE(reused == old);
+        CATCH_CHECK(libexcept::get_fd_provenance(reused).empty());
+        close(reused);
+
+        // and a tracked creation after close_range() gets its own frames
+        //
+        int const first(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(first >= 0);
+        CATCH_REQUIRE(close_range(first, first, 0) == 0);
+        int const second(eventfd(0, EFD_CLOEXEC));
+        CATCH_REQUIRE(second == first);
+        CATCH_CHECK_FALSE(libexcept::get_fd_provenance(second).empty());
+        close(second);
+
+        libexcept::set_track_fd_provenance(false);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -32,6 +32,13 @@
 #include    <fstream>
 
 
+// C
+//
+#include    <dirent.h>
+#include    <fcntl.h>
+#include    <sys/wait.h>
+
+
 void tokenize(std::list<std::string> list, std::string const & p)
 {
     char const * s(p.c_str());
@@ -54,6 +61,22 @@ void tokenize(std::list<std::string> list, std::string const & p)
     }
 }
 
+libexcept::allowed_fds_bitmap_t currently_opened_fds()
+{
+    libexcept::allowed_fds_bitmap_t fds;
+    DIR * d(opendir("/proc/self/fd"));
+    for(dirent const * ent(readdir(d)); ent != nullptr; ent = readdir(d))
+    {
+        if(ent->d_name[0] != '.'
+        && std::atoi(ent->d_name) != dirfd(d))
+        {
+            fds.set(std::atoi(ent->d_name));
+        }
+    }
+    closedir(d);
+    return fds;
+}
+
 std::string join_strings(std::list<std::string> list, char sep)
 {
     std::string result;
@@ -181,6 +204,278 @@ CATCH_TEST_CASE("file_inheritance", "[file_inheritance]")
         CATCH_REQUIRE(r != 0);
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("file_inheritance: command line arguments")
+    {
+        libexcept::command_line_t const args(libexcept::get_command_line_arguments(getpid()));
+        CATCH_REQUIRE(!args.empty());
+        CATCH_CHECK(args[0] == libexcept::get_command_line(getpid()));
+
+        libexcept::command_line_t const sample{ "/bin/sh", "-c", "exit 0" };
+        CATCH_CHECK(libexcept::command_line_to_string(sample) == "/bin/sh -c exit 0");
+        CATCH_CHECK(libexcept::command_line_to_string(libexcept::command_line_t()).empty());
+
+        libexcept::command_line_cache_t cache;
+        libexcept::command_line_t const & cached(cache.get(getpid()));
+        CATCH_CHECK(cached == args);
+        CATCH_CHECK(&cache.get(getpid()) == &cached);
+        cache.clear();
+        CATCH_CHECK(cache.get(getpid()) == args);
+
+        // a process which does not exist
+        //
+        CATCH_CHECK(libexcept::get_command_line(-1).empty());
+        CATCH_CHECK(libexcept::get_command_line_arguments(-1).empty());
+        CATCH_CHECK(cache.get(-1).empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("file_inheritance: scan another process")
+    {
+        // the child inherits the write side of `sync` and a pipe without
+        // the close-on-exec flag; it waits until we close `sync`
+        //
+        int sync[2];
+        CATCH_REQUIRE(pipe(sync) == 0);
+        int leak[2];
+        CATCH_REQUIRE(pipe(leak) == 0);
+        pid_t const child(fork());
+        CATCH_REQUIRE(child >= 0);
+        if(child == 0)
+        {
+            close(sync[1]);
+            char c;
+            while(read(sync[0], &c, 1) < 0);
+            _exit(0);
+        }
+        close(sync[0]);
+
+        libexcept::fd_inventory_t const inventory(libexcept::get_fd_inventory(child));
+        bool found(false);
+        for(auto const & info : inventory)
+        {
+            CATCH_CHECK(info.f_error == 0);
+            if(info.f_fd == leak[0])
+            {
+                found = true;
+                CATCH_CHECK(info.f_type == libexcept::fd_type_t::FD_TYPE_PIPE);
+                CATCH_CHECK(info.f_target.compare(0, 5, "pipe:") == 0);
+                CATCH_CHECK_FALSE(info.f_cloexec);
+                CATCH_CHECK((info.f_flags & O_ACCMODE) == O_RDONLY);
+                CATCH_CHECK(info.f_position == -1);
+            }
+        }
+        CATCH_CHECK(found);
+
+        // a process which exited cannot be scanned
+        //
+        pid_t const gone(fork());
+        CATCH_REQUIRE(gone >= 0);
+        if(gone == 0)
+        {
+            _exit(0);
+        }
+        int gone_status(0);
+        CATCH_REQUIRE(waitpid(gone, &gone_status, 0) == gone);
+        libexcept::fd_inventory_t gone_inventory;
+        CATCH_CHECK_FALSE(libexcept::get_fd_inventory(gone, gone_inventory));
+        CATCH_CHECK(errno == ENOENT);
+        CATCH_CHECK(gone_inventory.empty());
+        CATCH_CHECK(libexcept::get_fd_inventory(child, gone_inventory));
+        CATCH_CHECK_FALSE(gone_inventory.empty());
+
+        std::string const cmd(path
+                        + " --scan --jobs 2 --allow "
+                        + std::to_string(sync[0])
+                        + ' '
+                        + std::to_string(child)
+                        + ' '
+                        + std::to_string(gone));
+        FILE * p(popen(cmd.c_str(), "r"));
+        CATCH_REQUIRE(p != nullptr);
+        std::string output;
+        char buf[256];
+        for(;;)
+        {
+            std::size_t const l(fread(buf, 1, sizeof(buf), p));
+            if(l == 0)
+            {
+                break;
+            }
+            output.append(buf, l);
+        }
+        int const r(pclose(p));
+        CATCH_CHECK(WEXITSTATUS(r) == 1);
+        CATCH_CHECK(output.find("{\"pid\":" + std::to_string(child) + ",") != std::string::npos);
+        CATCH_CHECK(output.find("{\"pid\":" + std::to_string(gone) + ",\"command\":\"\",\"error\":\"ENOENT\",\"message\":\"") != std::string::npos);
+        CATCH_CHECK(output.find("\"fd\":" + std::to_string(leak[0]) + ",\"type\":\"pipe\"") != std::string::npos);
+        CATCH_CHECK(output.find("\"fd\":" + std::to_string(sync[0]) + ",") == std::string::npos);
+
+        close(sync[1]);
+        close(leak[0]);
+        close(leak[1]);
+        int status(0);
+        CATCH_REQUIRE(waitpid(child, &status, 0) == child);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("file_inheritance: allowed file descriptors bitmap")
+    {
+        libexcept::allowed_fds_bitmap_t empty;
+        CATCH_CHECK_FALSE(empty.contains(0));
+        CATCH_CHECK_FALSE(empty.contains(-1));
+        CATCH_CHECK_FALSE(empty.contains(1000));
+
+        libexcept::allowed_fds_bitmap_t fds(libexcept::allowed_fds_t{ 3, 64, 500 });
+        CATCH_CHECK(fds.contains(3));
+        CATCH_CHECK(fds.contains(64));
+        CATCH_CHECK(fds.contains(500));
+        CATCH_CHECK_FALSE(fds.contains(4));
+        CATCH_CHECK_FALSE(fds.contains(63));
+        CATCH_CHECK_FALSE(fds.contains(65));
+        CATCH_CHECK_FALSE(fds.contains(501));
+
+        fds.set(70000);
+        CATCH_CHECK(fds.contains(70000));
+        fds.set(-5);
+        CATCH_CHECK_FALSE(fds.contains(-5));
+        fds.clear(64);
+        CATCH_CHECK_FALSE(fds.contains(64));
+        fds.clear(100000);
+        CATCH_CHECK(fds.contains(500));
+
+        CATCH_CHECK(fds.next(0) == 3);
+        CATCH_CHECK(fds.next(3) == 3);
+        CATCH_CHECK(fds.next(4) == 500);
+        CATCH_CHECK(fds.next(501) == 70000);
+        CATCH_CHECK(fds.next(70001) == -1);
+        CATCH_CHECK(empty.next(0) == -1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("file_inheritance: remediate leaked file descriptors")
+    {
+        for(auto const remediation : {
+                      libexcept::fd_remediation_t::FD_REMEDIATION_CLOSE
+                    , libexcept::fd_remediation_t::FD_REMEDIATION_CLOEXEC })
+        {
+            // the remediation affects all the descriptors of the process
+            // so run it in a child
+            //
+            pid_t const child(fork());
+            CATCH_REQUIRE(child >= 0);
+            if(child == 0)
+            {
+                int pipes[2];
+                if(pipe(pipes) != 0)
+                {
+                    _exit(1);
+                }
+                libexcept::allowed_fds_bitmap_t allowed(currently_opened_fds());
+                allowed.clear(pipes[1]);
+
+                int leaks[3];
+                for(auto & fd : leaks)
+                {
+                    fd = open("/dev/null", O_RDONLY);
+                }
+                if(!libexcept::remediate_inherited_files(allowed, remediation))
+                {
+                    _exit(2);
+                }
+                if(fcntl(pipes[0], F_GETFD) != 0)
+                {
+                    _exit(3);   // allowed descriptor was modified
+                }
+                for(int fd : { leaks[0], leaks[1], leaks[2], pipes[1] })
+                {
+                    int const flags(fcntl(fd, F_GETFD));
+                    if(remediation == libexcept::fd_remediation_t::FD_REMEDIATION_CLOSE
+                            ? flags != -1
+                            : flags != FD_CLOEXEC)
+                    {
+                        _exit(4);
+                    }
+                }
+                _exit(0);
+            }
+            int status(0);
+            CATCH_REQUIRE(waitpid(child, &status, 0) == child);
+            CATCH_REQUIRE(WIFEXITED(status));
+            CATCH_CHECK(WEXITSTATUS(status) == 0);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("file_inheritance: inventory of opened file descriptors")
+    {
+        CATCH_CHECK(strcmp(libexcept::fd_type_to_string(libexcept::fd_type_t::FD_TYPE_SOCKET), "socket") == 0);
+        CATCH_CHECK(strcmp(libexcept::fd_type_to_string(libexcept::fd_type_t::FD_TYPE_UNKNOWN), "unknown") == 0);
+
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/inventory.txt");
+        int const file(open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+        CATCH_REQUIRE(file >= 0);
+        CATCH_REQUIRE(write(file, "inventory", 9) == 9);
+        int pipes[2];
+        CATCH_REQUIRE(pipe(pipes) == 0);
+
+        libexcept::fd_inventory_t const inventory(libexcept::get_fd_inventory());
+        bool found_file(false);
+        bool found_pipe(false);
+        int previous(-1);
+        for(auto const & info : inventory)
+        {
+            CATCH_CHECK(info.f_fd > previous);
+            previous = info.f_fd;
+            if(info.f_fd == file)
+            {
+                found_file = true;
+                CATCH_CHECK(info.f_type == libexcept::fd_type_t::FD_TYPE_FILE);
+                CATCH_CHECK(info.f_target.find("inventory.txt") != std::string::npos);
+                CATCH_CHECK(info.f_cloexec);
+                CATCH_CHECK((info.f_flags & O_ACCMODE) == O_RDWR);
+                CATCH_CHECK(info.f_position == 9);
+            }
+            else if(info.f_fd == pipes[0])
+            {
+                found_pipe = true;
+                CATCH_CHECK(info.f_type == libexcept::fd_type_t::FD_TYPE_PIPE);
+                CATCH_CHECK(info.f_target.compare(0, 5, "pipe:") == 0);
+                CATCH_CHECK_FALSE(info.f_cloexec);
+                CATCH_CHECK(info.f_position == -1);
+            }
+        }
+        CATCH_CHECK(found_file);
+        CATCH_CHECK(found_pipe);
+
+        close(file);
+        close(pipes[0]);
+        close(pipes[1]);
+    }
+    CATCH_END_SECTION()
+
+#ifdef _DEBUG
+    CATCH_START_SECTION("file_inheritance: verify this process with a bitmap")
+    {
+        libexcept::allowed_fds_bitmap_t const allowed(currently_opened_fds());
+        libexcept::verify_inherited_files(allowed);
+
+        int const fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(fd >= 0);
+        CATCH_REQUIRE_THROWS_AS(libexcept::verify_inherited_files(allowed), libexcept::file_inherited);
+
+        libexcept::allowed_fds_bitmap_t with_fd(allowed);
+        with_fd.set(fd);
+        libexcept::verify_inherited_files(with_fd);
+
+        // with a remediation, the leak gets closed instead of throwing
+        //
+        libexcept::verify_inherited_files(allowed, libexcept::fd_remediation_t::FD_REMEDIATION_CLOSE);
+        CATCH_CHECK(fcntl(fd, F_GETFD) == -1);
+        libexcept::verify_inherited_files(allowed);
+    }
+    CATCH_END_SECTION()
+#endif
 }
 
 
@@ -0,0 +1,182 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/exception.h>
+#include    <libexcept/json.h>
+
+
+// C
+//
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("json", "[json][exception]")
+{
+    CATCH_START_SECTION("json: write to a buffer")
+    {
+        libexcept::exception_t e("message with \"quotes\", \\ and\ta\ncontrol \x01 char");
+        e.set_parameter("filename", "/etc/aliases");
+        e.set_parameter("quote", "\"");
+
+        char buffer[1024];
+        libexcept::json_writer writer(buffer, sizeof(buffer));
+        CATCH_REQUIRE(writer.write_exception(e));
+        CATCH_CHECK_FALSE(writer.is_truncated());
+
+        std::string const json(buffer, writer.get_size());
+        CATCH_CHECK(json ==
+                  "{\"type\":\"libexcept::exception_t\""
+                  ",\"message\":\"message with \\\"quotes\\\", \\\\ and\\ta\\ncontrol \\u0001 char\""
+                  ",\"parameters\":{\"filename\":\"/etc/aliases\",\"quote\":\"\\\"\"}"
+                  ",\"stack_trace\":[]}\n");
+
+        // a second exception is appended
+        //
+        CATCH_REQUIRE(writer.write_exception(std::out_of_range("std")));
+        std::string const json2(buffer + json.length(), writer.get_size() - json.length());
+        CATCH_CHECK(json2 == "{\"type\":\"std::out_of_range\",\"message\":\"std\"}\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("json: buffer too small")
+    {
+        char buffer[20];
+        libexcept::json_writer writer(buffer, sizeof(buffer));
+        CATCH_CHECK_FALSE(writer.write_exception(std::runtime_error("this message does not fit")));
+        CATCH_CHECK(writer.is_truncated());
+        CATCH_CHECK(writer.get_size() == sizeof(buffer));
+        CATCH_CHECK(std::string(buffer, sizeof(buffer)) == "{\"type\":\"std::runtim");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("json: UTF-8")
+    {
+        char buffer[256];
+        libexcept::json_writer writer(buffer, sizeof(buffer));
+        writer.begin_object();
+
+        // valid sequences of 2, 3, and 4 bytes are kept as is
+        //
+        writer.write_string("valid", "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80");
+
+        // a stray continuation byte, an overlong form, a surrogate, a
+        // code point over U+10FFFF, and a sequence cut by the end
+        //
+        writer.write_string("invalid", "a\x80" "b\xC0\xAF" "c\xED\xA0\x80" "d\xF4\x90\x80\x80" "e\xE2\x82");
+        CATCH_REQUIRE(writer.end_object());
+
+        CATCH_CHECK(std::string(buffer, writer.get_size()) ==
+                  "{\"valid\":\"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80\""
+                  ",\"invalid\":\"a\\ufffd"
+                  "b\\ufffd\\ufffd"
+                  "c\\ufffd\\ufffd\\ufffd"
+                  "d\\ufffd\\ufffd\\ufffd\\ufffd"
+                  "e\\ufffd\\ufffd\"}\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("json: truncation does not cut sequences")
+    {
+        // 10 bytes: `{"m":"abc` then a 3 byte UTF-8 character which
+        // does not fit
+        //
+        char buffer[10];
+        libexcept::json_writer utf8(buffer, sizeof(buffer));
+        utf8.begin_object();
+        utf8.write_string("m", "abc\xE2\x82\xAC" "def");
+        CATCH_CHECK_FALSE(utf8.end_object());
+        CATCH_CHECK(utf8.is_truncated());
+        CATCH_CHECK(std::string(buffer, utf8.get_size()) == "{\"m\":\"abc");
+
+        // the same with an escape
+        //
+        libexcept::json_writer escape(buffer, sizeof(buffer));
+        escape.begin_object();
+        escape.write_string("m", "abc\x01" "def");
+        CATCH_CHECK_FALSE(escape.end_object());
+        CATCH_CHECK(std::string(buffer, escape.get_size()) == "{\"m\":\"abc");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("json: write to a file descriptor")
+    {
+        int pipes[2];
+        CATCH_REQUIRE(pipe(pipes) == 0);
+
+        std::string const long_message(libexcept::JSON_WRITER_BUFFER_SIZE + 100, 'm');
+        {
+            libexcept::json_writer writer(pipes[1]);
+            CATCH_REQUIRE(writer.write_exception(std::runtime_error(long_message)));
+        }
+        close(pipes[1]);
+
+        std::string json;
+        char buf[256];
+        for(;;)
+        {
+            ssize_t const r(read(pipes[0], buf, sizeof(buf)));
+            if(r <= 0)
+            {
+                break;
+            }
+            json.append(buf, r);
+        }
+        close(pipes[0]);
+
+        CATCH_CHECK(json == "{\"type\":\"std::runtime_error\",\"message\":\"" + long_message + "\"}\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("json: write records")
+    {
+        char buffer[256];
+        libexcept::json_writer writer(buffer, sizeof(buffer));
+        writer.begin_object();
+        writer.write_integer("pid", 1234);
+        writer.write_string("command", "/bin/\"daemon\"\n");
+        writer.write_integer("position", -1);
+        writer.write_integer("min", INT64_MIN);
+        writer.write_boolean("cloexec", false);
+        writer.write_boolean("tracked", true);
+        CATCH_REQUIRE(writer.end_object());
+
+        writer.begin_object();
+        writer.write_string("target", "pipe:[12]", 4);
+        writer.write_integer("fd", 0);
+        CATCH_REQUIRE(writer.end_object());
+
+        CATCH_CHECK(std::string(buffer, writer.get_size()) ==
+                  "{\"pid\":1234,\"command\":\"/bin/\\\"daemon\\\"\\n\""
+                  ",\"position\":-1,\"min\":-9223372036854775808"
+                  ",\"cloexec\":false,\"tracked\":true}\n"
+                  "{\"target\":\"pipe\",\"fd\":0}\n");
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,198 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/demangle.h>
+#include    <libexcept/profiler.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <sstream>
+#include    <thread>
+
+
+
+namespace
+{
+
+
+
+/** \brief Use the CPU in a libexcept function for a while.
+ *
+ * The function demangles names in a loop so most samples have the
+ * exported demangle_cpp_name() function in their stack.
+ */
+std::size_t burn_cpu(int ms)
+{
+    std::size_t length(0);
+    auto const end(std::chrono::steady_clock::now() + std::chrono::milliseconds(ms));
+    while(std::chrono::steady_clock::now() < end)
+    {
+        for(int i(0); i < 100; ++i)
+        {
+            length += libexcept::demangle_cpp_name("_ZN9libexcept19collect_stack_traceB5cxx11Ei").length();
+        }
+    }
+    return length;
+}
+
+
+/** \brief Check the folded stack lines and sum their counts.
+ *
+ * \param[in] folded  The output of drain_profiler().
+ *
+ * \return The sum of the counts or -1 if a line is invalid.
+ */
+long sum_folded(std::string const & folded)
+{
+    long sum(0);
+    std::istringstream in(folded);
+    std::string line;
+    while(std::getline(in, line))
+    {
+        std::string::size_type const space(line.rfind(' '));
+        if(space == std::string::npos
+        || space == 0
+        || space + 1 == line.length())
+        {
+            return -1;
+        }
+        sum += std::stol(line.substr(space + 1));
+    }
+    return sum;
+}
+
+
+
+}
+
+
+CATCH_TEST_CASE("profiler", "[profiler]")
+{
+    CATCH_START_SECTION("profiler: folded stacks with symbols")
+    {
+        libexcept::start_profiler(1000);
+        CATCH_CHECK(libexcept::is_profiler_running());
+        CATCH_REQUIRE_THROWS_AS(libexcept::start_profiler(), libexcept::profiler_error);
+
+        CATCH_CHECK(burn_cpu(300) > 0);
+
+        libexcept::stop_profiler();
+        CATCH_CHECK_FALSE(libexcept::is_profiler_running());
+
+        std::stringstream out;
+        std::size_t const count(libexcept::drain_profiler(out));
+        std::string const folded(out.str());
+        CATCH_CHECK(count > 0);
+        CATCH_CHECK(sum_folded(folded) == static_cast<long>(count));
+        CATCH_CHECK(folded.find("libexcept::demangle_cpp_name") != std::string::npos);
+
+        // the buffer was emptied
+        //
+        std::stringstream empty;
+        CATCH_CHECK(libexcept::drain_profiler(empty) == 0);
+        CATCH_CHECK(empty.str().empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("profiler: folded stacks with offsets, drained while running")
+    {
+        libexcept::start_profiler(1000);
+        burn_cpu(150);
+
+        std::stringstream first;
+        std::size_t const first_count(libexcept::drain_profiler(first, libexcept::profiler_frame_format_t::PROFILER_FRAME_FORMAT_OFFSET));
+        CATCH_CHECK(first_count > 0);
+        CATCH_CHECK(first.str().find("libexcept.so+0x") != std::string::npos);
+        CATCH_CHECK(sum_folded(first.str()) == static_cast<long>(first_count));
+
+        burn_cpu(150);
+        libexcept::stop_profiler();
+
+        std::stringstream second;
+        CATCH_CHECK(libexcept::drain_profiler(second, libexcept::profiler_frame_format_t::PROFILER_FRAME_FORMAT_OFFSET) > 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("profiler: samples the thread using the CPU")
+    {
+        // the main thread sleeps while the other one uses the CPU; the
+        // samples must come from the other thread, including when it
+        // was created after the profiler started
+        //
+        libexcept::start_profiler(1000);
+
+        std::atomic<bool> go(false);
+        std::thread worker([&go]()
+            {
+                while(!go.load())
+                {
+                    std::this_thread::yield();
+                }
+                burn_cpu(200);
+            });
+
+        std::stringstream ignore;
+        libexcept::drain_profiler(ignore);
+        go.store(true);
+        worker.join();
+        libexcept::stop_profiler();
+
+        std::stringstream out;
+        std::size_t const count(libexcept::drain_profiler(out));
+        CATCH_CHECK(count > 0);
+        CATCH_CHECK(out.str().find("libexcept::demangle_cpp_name") != std::string::npos);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("profiler: dropped samples")
+    {
+        std::uint64_t const dropped(libexcept::get_profiler_dropped_samples());
+
+        libexcept::start_profiler(1000, 2);
+        burn_cpu(100);
+        libexcept::stop_profiler();
+
+        CATCH_CHECK(libexcept::get_profiler_dropped_samples() > dropped);
+        std::stringstream out;
+        CATCH_CHECK(libexcept::drain_profiler(out) <= 2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("profiler: invalid parameters")
+    {
+        CATCH_REQUIRE_THROWS_AS(libexcept::start_profiler(0), libexcept::profiler_error);
+        CATCH_REQUIRE_THROWS_AS(libexcept::start_profiler(10'001), libexcept::profiler_error);
+        CATCH_REQUIRE_THROWS_AS(libexcept::start_profiler(99, 0), libexcept::profiler_error);
+        CATCH_CHECK_FALSE(libexcept::is_profiler_running());
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,164 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/exception.h>
+#include    <libexcept/recent_exceptions.h>
+
+
+// C++
+//
+#include    <fstream>
+#include    <sstream>
+#include    <thread>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+DECLARE_MAIN_EXCEPTION(recorded_main_exception);
+DECLARE_EXCEPTION(recorded_main_exception, recorded_sub_exception);
+DECLARE_LOGIC_ERROR(recorded_logic_error);
+
+
+std::string dump()
+{
+    std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/recent-exceptions.txt");
+    int const fd(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+    libexcept::dump_recent_exceptions(fd);
+    close(fd);
+
+    std::ifstream in(filename);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+
+std::size_t count(std::string const & s, std::string const & what)
+{
+    std::size_t result(0);
+    for(std::string::size_type pos(s.find(what)); pos != std::string::npos; pos = s.find(what, pos + 1))
+    {
+        ++result;
+    }
+    return result;
+}
+
+
+}
+
+
+CATCH_TEST_CASE("recent_exceptions", "[exception]")
+{
+    CATCH_START_SECTION("recent_exceptions: not recorded by default")
+    {
+        CATCH_CHECK_FALSE(libexcept::get_record_exceptions());
+
+        libexcept::exception_t e("not recorded");
+        CATCH_CHECK(dump().find("not recorded") == std::string::npos);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("recent_exceptions: record exceptions of two threads")
+    {
+        libexcept::set_record_exceptions(true);
+        CATCH_CHECK(libexcept::get_record_exceptions());
+
+        libexcept::logic_exception_t e1("recorded in main thread");
+        libexcept::record_exception(std::range_error("a standard exception recorded explicitly"));
+
+        std::thread t([]()
+            {
+                for(std::size_t idx(0); idx < libexcept::RECENT_EXCEPTIONS_PER_THREAD + 5; ++idx)
+                {
+                    libexcept::out_of_range_t e("thread exception #" + std::to_string(idx));
+                }
+            });
+        t.join();
+
+        libexcept::exception_t e2(std::string(200, 'x'));
+
+        libexcept::set_record_exceptions(false);
+
+        std::string const report(dump());
+        CATCH_CHECK(report.find("type=N9libexcept17logic_exception_tE message=\"recorded in main thread\"") != std::string::npos);
+        CATCH_CHECK(report.find("type=St11range_error message=\"a standard exception recorded explicitly\"") != std::string::npos);
+        CATCH_CHECK(report.find(" tid=" + std::to_string(gettid()) + " ") != std::string::npos);
+
+        // the message is truncated
+        //
+        CATCH_CHECK(report.find("message=\"" + std::string(libexcept::RECENT_EXCEPTION_MESSAGE_SIZE - 1, 'x') + "\"\n") != std::string::npos);
+
+        // the thread ring wrapped around so the first 5 are gone
+        //
+        CATCH_CHECK(count(report, "message=\"thread exception #") == libexcept::RECENT_EXCEPTIONS_PER_THREAD);
+        CATCH_CHECK(report.find("message=\"thread exception #4\"") == std::string::npos);
+        CATCH_CHECK(report.find("message=\"thread exception #5\"") != std::string::npos);
+        CATCH_CHECK(report.find("message=\"thread exception #20\"") != std::string::npos);
+        CATCH_CHECK(report.find("\n  frame 0x") != std::string::npos);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("recent_exceptions: record the declared type")
+    {
+        libexcept::set_record_exceptions(true);
+
+        try
+        {
+            throw recorded_main_exception("declared main exception");
+        }
+        catch(recorded_main_exception const &)
+        {
+        }
+        recorded_sub_exception sub("declared sub-exception", std::make_exception_ptr(std::runtime_error("cause")));
+        recorded_logic_error logic("declared logic error");
+
+        libexcept::set_record_exceptions(false);
+
+        std::string const report(dump());
+        CATCH_CHECK(report.find(std::string("type=") + typeid(recorded_main_exception).name() + " message=\"recorded_main_exception: declared main exception\"") != std::string::npos);
+        CATCH_CHECK(report.find(std::string("type=") + typeid(recorded_sub_exception).name() + " message=\"recorded_main_exception: declared sub-exception\"") != std::string::npos);
+        CATCH_CHECK(report.find(std::string("type=") + typeid(recorded_logic_error).name() + " message=\"recorded_logic_error: declared logic error\"") != std::string::npos);
+
+        // each exception is recorded once, with its final type
+        //
+        CATCH_CHECK(count(report, "declared main exception\"") == 1);
+        CATCH_CHECK(count(report, "declared sub-exception\"") == 1);
+        CATCH_CHECK(report.find("type=N9libexcept11exception_tE message=\"recorded_main_exception: ") == std::string::npos);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
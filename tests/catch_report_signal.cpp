@@ -0,0 +1,168 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/report_signal.h>
+#include    <libexcept/thread_stacks.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <fstream>
+#include    <sstream>
+#include    <thread>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("report_signal", "[signal]")
+{
+    CATCH_START_SECTION("report_signal: crash report file")
+    {
+        CATCH_CHECK(libexcept::get_crash_report_fd() == -1);
+
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/crash-report.txt");
+        unlink(filename.c_str());
+
+        pid_t const child(fork());
+        CATCH_REQUIRE(child != -1);
+        if(child == 0)
+        {
+            int const fd(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+            if(fd == -1)
+            {
+                _exit(1);
+            }
+            // catch2 captures SIGABRT, restore the default in the child
+            //
+            signal(SIGABRT, SIG_DFL);
+
+            libexcept::set_crash_report_fd(fd);
+            libexcept::init_report_signal();
+            raise(SIGSEGV);
+            _exit(2);   // not reached
+        }
+
+        int status(0);
+        CATCH_REQUIRE(waitpid(child, &status, 0) == child);
+        CATCH_REQUIRE(WIFSIGNALED(status));
+        CATCH_CHECK(WTERMSIG(status) == SIGABRT);
+
+        std::ifstream in(filename);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string const report(ss.str());
+
+        std::string const expected("crash: signal=" + std::to_string(SIGSEGV) + " pid=" + std::to_string(child));
+        CATCH_CHECK(report.compare(0, expected.length(), expected) == 0);
+        CATCH_CHECK(report.find("\nthread " + std::to_string(child) + "\n") != std::string::npos);
+        CATCH_CHECK(report.find("\nmaps:\n") != std::string::npos);
+        CATCH_CHECK(report.find("\nend maps\n") != std::string::npos);
+        CATCH_CHECK(report.find("\nframe 0x") != std::string::npos);
+#if defined(__x86_64__)
+        CATCH_CHECK(report.find("\nregister rip=0x") != std::string::npos);
+#endif
+        CATCH_CHECK(report.find("\nend crash\n") != std::string::npos);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("report_signal: crash report with all the threads")
+    {
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/crash-report-threads.txt");
+        unlink(filename.c_str());
+
+        int p[2];
+        CATCH_REQUIRE(pipe2(p, O_CLOEXEC) == 0);
+
+        pid_t const child(fork());
+        CATCH_REQUIRE(child != -1);
+        if(child == 0)
+        {
+            int const fd(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+            if(fd == -1)
+            {
+                _exit(1);
+            }
+            signal(SIGABRT, SIG_DFL);
+
+            libexcept::set_crash_report_fd(fd);
+            libexcept::init_report_signal();
+            libexcept::init_thread_stacks();
+
+            std::atomic<pid_t> worker_tid(0);
+            std::thread worker([&worker_tid]()
+                {
+                    worker_tid.store(gettid());
+                    for(;;)
+                    {
+                        pause();
+                    }
+                });
+            while(worker_tid.load() == 0)
+            {
+                usleep(100);
+            }
+            pid_t const tid(worker_tid.load());
+            if(write(p[1], &tid, sizeof(tid)) != sizeof(tid))
+            {
+                _exit(3);
+            }
+            raise(SIGSEGV);
+            _exit(2);   // not reached
+        }
+
+        pid_t tid(0);
+        close(p[1]);
+        CATCH_REQUIRE(read(p[0], &tid, sizeof(tid)) == sizeof(tid));
+        close(p[0]);
+
+        int status(0);
+        CATCH_REQUIRE(waitpid(child, &status, 0) == child);
+        CATCH_REQUIRE(WIFSIGNALED(status));
+        CATCH_CHECK(WTERMSIG(status) == SIGABRT);
+
+        std::ifstream in(filename);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string const report(ss.str());
+
+        std::string const thread_stack("\nthread stack: tid=" + std::to_string(tid) + "\n  frame 0x");
+        CATCH_CHECK(report.find(thread_stack) != std::string::npos);
+        CATCH_CHECK(report.find("\nthread stack: tid=" + std::to_string(child)) == std::string::npos);
+        CATCH_CHECK(report.find("\nend thread stacks\n") != std::string::npos);
+        CATCH_CHECK(report.find("\nend crash\n") != std::string::npos);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
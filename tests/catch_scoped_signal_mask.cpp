@@ -0,0 +1,241 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/exception.h>
+#include    <libexcept/scoped_signal_mask.h>
+
+
+// C++
+//
+#include    <thread>
+
+
+// C
+//
+#include    <pthread.h>
+
+
+
+namespace
+{
+
+
+
+constexpr libexcept::signal_set_t const g_io_signals{ SIGPIPE, SIGCHLD };
+
+static_assert(g_io_signals.contains(SIGPIPE));
+static_assert(g_io_signals.contains(SIGCHLD));
+static_assert(!g_io_signals.contains(SIGUSR1));
+
+
+volatile sig_atomic_t g_usr1_count = 0;
+
+
+void count_usr1(int sig)
+{
+    static_cast<void>(sig);
+    ++g_usr1_count;
+}
+
+
+bool is_blocked(int sig)
+{
+    sigset_t current;
+    pthread_sigmask(SIG_SETMASK, nullptr, &current);
+    return sigismember(&current, sig) == 1;
+}
+
+
+
+}
+
+
+CATCH_TEST_CASE("scoped_signal_mask", "[signal]")
+{
+    CATCH_START_SECTION("signal set")
+    {
+        libexcept::signal_set_t set;
+        CATCH_CHECK(set.empty());
+        set.add(SIGUSR1).add(SIGUSR2);
+        CATCH_CHECK(set.contains(SIGUSR1));
+        CATCH_CHECK(set.contains(SIGUSR2));
+        set.remove(SIGUSR1);
+        CATCH_CHECK_FALSE(set.contains(SIGUSR1));
+        set.remove(libexcept::signal_set_t{ SIGUSR2 });
+        CATCH_CHECK(set.empty());
+        CATCH_CHECK(set.get_invalid() == 0);
+
+        sigset_t s;
+        g_io_signals.to_sigset(s);
+        CATCH_CHECK(sigismember(&s, SIGPIPE) == 1);
+        CATCH_CHECK(sigismember(&s, SIGCHLD) == 1);
+        CATCH_CHECK(sigismember(&s, SIGUSR1) == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("block constant set")
+    {
+        CATCH_REQUIRE_FALSE(is_blocked(SIGPIPE));
+        {
+            libexcept::scoped_signal_mask const mask(g_io_signals);
+            CATCH_CHECK(is_blocked(SIGPIPE));
+            CATCH_CHECK(is_blocked(SIGCHLD));
+            CATCH_CHECK_FALSE(is_blocked(SIGUSR1));
+        }
+        CATCH_CHECK_FALSE(is_blocked(SIGPIPE));
+        CATCH_CHECK_FALSE(is_blocked(SIGCHLD));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("block braced list and std::list")
+    {
+        {
+            libexcept::scoped_signal_mask const mask({ SIGUSR1 });
+            CATCH_CHECK(is_blocked(SIGUSR1));
+        }
+        CATCH_CHECK_FALSE(is_blocked(SIGUSR1));
+
+        {
+            libexcept::scoped_signal_mask const mask(libexcept::sig_list_t{ SIGUSR2 });
+            CATCH_CHECK(is_blocked(SIGUSR2));
+        }
+        CATCH_CHECK_FALSE(is_blocked(SIGUSR2));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("only the calling thread is affected")
+    {
+        libexcept::scoped_signal_mask const mask({ SIGUSR1 });
+        CATCH_CHECK(is_blocked(SIGUSR1));
+
+        // the thread inherits our mask; changing it there must not
+        // affect this thread
+        //
+        bool blocked_in_thread(true);
+        std::thread t([&blocked_in_thread]()
+            {
+                sigset_t set;
+                sigemptyset(&set);
+                sigaddset(&set, SIGUSR1);
+                pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+                blocked_in_thread = is_blocked(SIGUSR1);
+            });
+        t.join();
+        CATCH_CHECK_FALSE(blocked_in_thread);
+        CATCH_CHECK(is_blocked(SIGUSR1));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("invalid signal")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::scoped_signal_mask({ 1000 })
+                , libexcept::fixme);
+        CATCH_CHECK_FALSE(is_blocked(SIGUSR1));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("lazy mask defers managed signals")
+    {
+        libexcept::set_lazy_signal_handler(SIGUSR1, count_usr1);
+        CATCH_CHECK(libexcept::get_lazy_signals().contains(SIGUSR1));
+        g_usr1_count = 0;
+
+        raise(SIGUSR1);
+        CATCH_CHECK(g_usr1_count == 1);
+
+        {
+            libexcept::scoped_signal_mask const outer(
+                      libexcept::signal_set_t{ SIGUSR1, SIGUSR2 }
+                    , libexcept::signal_mask_mode_t::SIGNAL_MASK_LAZY);
+
+            // SIGUSR1 is deferred without system call, SIGUSR2 is not
+            // managed by libexcept so it really gets blocked
+            //
+            CATCH_CHECK_FALSE(is_blocked(SIGUSR1));
+            CATCH_CHECK(is_blocked(SIGUSR2));
+
+            {
+                libexcept::scoped_signal_mask const inner(
+                          libexcept::signal_set_t{ SIGUSR1 }
+                        , libexcept::signal_mask_mode_t::SIGNAL_MASK_LAZY);
+                raise(SIGUSR1);
+                raise(SIGUSR1);
+                CATCH_CHECK(g_usr1_count == 1);
+            }
+
+            // still deferred by the outer scope
+            //
+            CATCH_CHECK(g_usr1_count == 1);
+        }
+
+        // pending signals are merged like blocked signals would be
+        //
+        CATCH_CHECK(g_usr1_count == 2);
+        CATCH_CHECK_FALSE(is_blocked(SIGUSR2));
+
+        libexcept::set_lazy_signal_handler(SIGUSR1, nullptr);
+        CATCH_CHECK_FALSE(libexcept::get_lazy_signals().contains(SIGUSR1));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("lazy handler on a synchronous signal")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::set_lazy_signal_handler(SIGSEGV, count_usr1)
+                , libexcept::fixme);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::set_lazy_signal_handler(0, count_usr1)
+                , libexcept::fixme);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("has sanitizer is stable")
+    {
+        bool const first(libexcept::has_sanitizer());
+        bool results[4] = {};
+        std::thread threads[4];
+        for(int i(0); i < 4; ++i)
+        {
+            threads[i] = std::thread([&results, i]()
+                {
+                    results[i] = libexcept::has_sanitizer();
+                });
+        }
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+        for(auto const r : results)
+        {
+            CATCH_CHECK(r == first);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,114 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/serialize.h>
+
+
+
+CATCH_TEST_CASE("serialize", "[serialize][exception]")
+{
+    CATCH_START_SECTION("serialize: libexcept exception")
+    {
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+        libexcept::exception_t e("serialize this exception");
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+        e.set_parameter("filename", "/etc/aliases");
+        e.set_parameter("line", "33");
+
+        libexcept::serialized_exception_t buffer;
+        libexcept::serialize_exception(e, buffer);
+
+        libexcept::exception_reader reader(buffer.data(), buffer.size());
+        CATCH_CHECK(reader.get_size() == buffer.size());
+        CATCH_CHECK(reader.get_version() == libexcept::SERIALIZATION_VERSION);
+        CATCH_CHECK(reader.get_type() == typeid(libexcept::exception_t).name());
+        CATCH_CHECK(reader.get_demangled_type() == "libexcept::exception_t");
+        CATCH_CHECK(reader.get_message() == "serialize this exception");
+
+        CATCH_REQUIRE(reader.get_parameter_count() == 2);
+        std::string_view name;
+        std::string_view value;
+        CATCH_REQUIRE(reader.next_parameter(name, value));
+        CATCH_CHECK(name == "filename");
+        CATCH_CHECK(value == "/etc/aliases");
+        CATCH_REQUIRE(reader.next_parameter(name, value));
+        CATCH_CHECK(name == "line");
+        CATCH_CHECK(value == "33");
+        CATCH_CHECK_FALSE(reader.next_parameter(name, value));
+
+        CATCH_REQUIRE(reader.get_frame_count() == e.get_stack_trace().size());
+        std::string_view frame;
+        for(auto const & f : e.get_stack_trace())
+        {
+            CATCH_REQUIRE(reader.next_frame(frame));
+            CATCH_CHECK(frame == f);
+        }
+        CATCH_CHECK_FALSE(reader.next_frame(frame));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serialize: standard exceptions one after the other")
+    {
+        libexcept::serialized_exception_t buffer;
+        libexcept::serialize_exception(std::range_error("first"), buffer);
+        libexcept::serialize_exception(std::logic_error(std::string(200, 'x')), buffer);
+
+        libexcept::exception_reader first(buffer.data(), buffer.size());
+        CATCH_CHECK(first.get_size() < buffer.size());
+        CATCH_CHECK(first.get_demangled_type() == "std::range_error");
+        CATCH_CHECK(first.get_message() == "first");
+        CATCH_CHECK(first.get_parameter_count() == 0);
+        CATCH_CHECK(first.get_frame_count() == 0);
+
+        libexcept::exception_reader second(buffer.data() + first.get_size(), buffer.size() - first.get_size());
+        CATCH_CHECK(first.get_size() + second.get_size() == buffer.size());
+        CATCH_CHECK(second.get_demangled_type() == "std::logic_error");
+        CATCH_CHECK(second.get_message() == std::string(200, 'x'));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serialize: invalid buffers")
+    {
+        libexcept::serialized_exception_t buffer;
+        libexcept::serialize_exception(libexcept::exception_t("truncated"), buffer);
+
+        for(std::size_t size(0); size < buffer.size(); ++size)
+        {
+            CATCH_REQUIRE_THROWS_AS(
+                      libexcept::exception_reader(buffer.data(), size)
+                    , libexcept::invalid_serialization);
+        }
+
+        buffer[3] = libexcept::SERIALIZATION_VERSION + 1;
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::exception_reader(buffer.data(), buffer.size())
+                , libexcept::invalid_serialization);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
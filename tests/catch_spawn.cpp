@@ -0,0 +1,186 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/spawn.h>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <signal.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+
+int wait_for(pid_t pid)
+{
+    int status(0);
+    if(waitpid(pid, &status, 0) != pid
+    || !WIFEXITED(status))
+    {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+
+
+}
+
+
+CATCH_TEST_CASE("spawn", "[spawn]")
+{
+    CATCH_START_SECTION("spawn without inherited descriptors")
+    {
+        // not close-on-exec on purpose, spawn_process() must close it
+        //
+        int const leak(open("/dev/null", O_RDONLY));
+        CATCH_REQUIRE(leak > 2);
+
+        std::string const script(
+                  "test -e /proc/self/fd/"
+                + std::to_string(leak)
+                + " && exit 1; exit 0");
+        pid_t const pid(libexcept::spawn_process("/bin/sh", { "sh", "-c", script }));
+        CATCH_CHECK(pid > 0);
+        CATCH_CHECK(wait_for(pid) == 0);
+
+        close(leak);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("spawn with an allowed descriptor")
+    {
+        int p[2];
+        CATCH_REQUIRE(pipe2(p, O_CLOEXEC) == 0);
+        int const leak(open("/dev/null", O_RDONLY));
+        CATCH_REQUIRE(leak > 2);
+
+        // the allowed descriptor is close-on-exec and still gets inherited
+        //
+        libexcept::allowed_fds_bitmap_t allowed;
+        allowed.set(p[1]);
+        std::string const script(
+                  "test -e /proc/self/fd/"
+                + std::to_string(leak)
+                + " && exit 1; echo ok >&"
+                + std::to_string(p[1]));
+        pid_t const pid(libexcept::spawn_process("/bin/sh", { "sh", "-c", script }, allowed, true));
+        CATCH_CHECK(pid > 0);
+        close(p[1]);
+
+        char buf[16] = {};
+        CATCH_CHECK(read(p[0], buf, sizeof(buf) - 1) == 3);
+        CATCH_CHECK(std::string(buf) == "ok\n");
+        CATCH_CHECK(wait_for(pid) == 0);
+
+        close(p[0]);
+        close(leak);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("spawn keeps the signal mask and not the handlers")
+    {
+        // the child gets the mask of the caller, not the "all blocked"
+        // mask used around vfork()
+        //
+        sigset_t usr2;
+        sigemptyset(&usr2);
+        sigaddset(&usr2, SIGUSR2);
+        sigset_t saved;
+        CATCH_REQUIRE(pthread_sigmask(SIG_BLOCK, &usr2, &saved) == 0);
+
+        struct sigaction action = {};
+        action.sa_handler = [](int) {};
+        struct sigaction previous_action;
+        CATCH_REQUIRE(sigaction(SIGUSR1, &action, &previous_action) == 0);
+
+        int p[2];
+        CATCH_REQUIRE(pipe2(p, O_CLOEXEC) == 0);
+        libexcept::allowed_fds_bitmap_t allowed;
+        allowed.set(p[1]);
+
+        // the shell clears its mask on startup so run grep directly with
+        // its stdout redirected to the pipe
+        //
+        int const saved_stdout(dup(STDOUT_FILENO));
+        CATCH_REQUIRE(dup2(p[1], STDOUT_FILENO) == STDOUT_FILENO);
+        pid_t const pid(libexcept::spawn_process("/bin/grep", { "grep", "SigBlk", "/proc/self/status" }, allowed));
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        CATCH_CHECK(pid > 0);
+        close(p[1]);
+
+        char buf[64] = {};
+        CATCH_CHECK(read(p[0], buf, sizeof(buf) - 1) > 0);
+        CATCH_CHECK(std::string(buf) == "SigBlk:\t0000000000000800\n");
+        CATCH_CHECK(wait_for(pid) == 0);
+        close(p[0]);
+
+        // and the mask of the caller is restored
+        //
+        sigset_t current;
+        CATCH_REQUIRE(pthread_sigmask(SIG_SETMASK, nullptr, &current) == 0);
+        CATCH_CHECK(sigismember(&current, SIGUSR2) == 1);
+        CATCH_CHECK(sigismember(&current, SIGUSR1) == 0);
+        CATCH_CHECK(sigismember(&current, SIGTERM) == 0);
+
+        // and the handler of the caller is still in place
+        //
+        struct sigaction current_action;
+        CATCH_REQUIRE(sigaction(SIGUSR1, nullptr, &current_action) == 0);
+        CATCH_CHECK(current_action.sa_handler == action.sa_handler);
+
+        sigaction(SIGUSR1, &previous_action, nullptr);
+        pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("spawn a missing executable")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::spawn_process("/this/file/does/not/exist", { "missing" })
+                , libexcept::spawn_error);
+
+        int const fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        libexcept::allowed_fds_bitmap_t allowed;
+        allowed.set(fd);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::spawn_process("/this/file/does/not/exist", { "missing" }, allowed)
+                , libexcept::spawn_error);
+        close(fd);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
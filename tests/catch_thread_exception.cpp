@@ -0,0 +1,193 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/thread_exception.h>
+
+
+// C++
+//
+#include    <stdexcept>
+#include    <thread>
+
+
+// C
+//
+#include    <pthread.h>
+
+
+
+namespace
+{
+
+
+DECLARE_MAIN_EXCEPTION(worker_exception);
+
+
+
+}
+
+
+CATCH_TEST_CASE("thread_exception", "[thread][exception]")
+{
+    CATCH_START_SECTION("thread exception call site")
+    {
+        libexcept::call_site_t const site;
+        CATCH_CHECK(strstr(site.f_file, "catch_thread_exception.cpp") != nullptr);
+        CATCH_CHECK(site.f_line == __LINE__ - 2);
+        CATCH_CHECK(site.to_string().find("catch_thread_exception.cpp:") != std::string::npos);
+
+        libexcept::call_site_t const undefined(nullptr, 0, nullptr);
+        CATCH_CHECK(undefined.to_string().empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread exception transport")
+    {
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_YES);
+
+        libexcept::call_site_t const site;
+        libexcept::captured_exception_t captured;
+        worker_exception const * original(nullptr);
+        pid_t worker_tid(0);
+        std::thread t([&]()
+            {
+                pthread_setname_np(pthread_self(), "test-worker");
+                worker_tid = gettid();
+                try
+                {
+                    worker_exception e("worker failed");
+                    e.set_parameter("job", "42");
+                    throw e;
+                }
+                catch(worker_exception const & e)
+                {
+                    original = &e;
+                    captured = libexcept::capture_thread_exception(site);
+                }
+            });
+        t.join();
+
+        CATCH_REQUIRE(captured.f_exception != nullptr);
+        CATCH_CHECK(captured.f_thread_id == worker_tid);
+        CATCH_CHECK(captured.f_thread_name == "test-worker");
+        CATCH_CHECK(captured.f_call_site.f_line == site.f_line);
+
+        try
+        {
+            libexcept::rethrow_thread_exception(captured, libexcept::thread_rethrow_t::THREAD_RETHROW_WRAPPED);
+        }
+        catch(libexcept::thread_exception const & e)
+        {
+            CATCH_CHECK(std::string(e.what()) == "thread_exception: exception in thread "
+                                + std::to_string(worker_tid)
+                                + " (test-worker): worker_exception: worker failed");
+            CATCH_CHECK(e.get_parameter("origin_thread_id") == std::to_string(worker_tid));
+            CATCH_CHECK(e.get_parameter("origin_thread_name") == "test-worker");
+            CATCH_CHECK(e.get_parameter("call_site") == site.to_string());
+
+            // the original exception is shared, not copied
+            //
+            CATCH_CHECK(e.get_cause_exception() == original);
+            CATCH_CHECK(original->get_parameter("job") == "42");
+
+            // both traces are available
+            //
+            CATCH_CHECK(!e.get_stack_trace().empty());
+            CATCH_CHECK(!original->get_stack_trace().empty());
+            CATCH_CHECK(&e.get_root_stack_trace() == &original->get_stack_trace());
+        }
+
+        libexcept::set_collect_stack(libexcept::collect_stack_t::COLLECT_STACK_NO);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread exception rethrows the original by default")
+    {
+        libexcept::call_site_t const site;
+        libexcept::captured_exception_t captured;
+        pid_t worker_tid(0);
+        std::thread t([&]()
+            {
+                pthread_setname_np(pthread_self(), "test-original");
+                worker_tid = gettid();
+                try
+                {
+                    throw worker_exception("worker failed");
+                }
+                catch(...)
+                {
+                    captured = libexcept::capture_thread_exception(site);
+                }
+            });
+        t.join();
+
+        bool caught(false);
+        try
+        {
+            libexcept::rethrow_thread_exception(captured);
+        }
+        catch(worker_exception const & e)
+        {
+            caught = true;
+            CATCH_CHECK(strcmp(e.what(), "worker_exception: worker failed") == 0);
+            CATCH_CHECK(e.get_parameter("origin_thread_id") == std::to_string(worker_tid));
+            CATCH_CHECK(e.get_parameter("origin_thread_name") == "test-original");
+            CATCH_CHECK(e.get_parameter("call_site") == site.to_string());
+        }
+        CATCH_CHECK(caught);
+
+        // exceptions which cannot hold parameters are rethrown as is
+        //
+        try
+        {
+            throw std::out_of_range("index too large");
+        }
+        catch(...)
+        {
+            captured = libexcept::capture_thread_exception(site);
+        }
+        CATCH_REQUIRE_THROWS_AS(libexcept::rethrow_thread_exception(captured), std::out_of_range);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread exception without exception")
+    {
+        libexcept::captured_exception_t captured;
+        try
+        {
+            libexcept::rethrow_thread_exception(captured);
+        }
+        catch(libexcept::thread_exception const & e)
+        {
+            CATCH_CHECK(strcmp(e.what(), "thread_exception: exception in thread 0") == 0);
+            CATCH_CHECK(e.get_cause() == nullptr);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
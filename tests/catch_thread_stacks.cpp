@@ -0,0 +1,232 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/thread_stacks.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <thread>
+
+
+// C
+//
+#include    <pthread.h>
+#include    <signal.h>
+#include    <stdio.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+
+std::string dump_to_string(int timeout_ms)
+{
+    FILE * f(tmpfile());
+    if(f == nullptr)
+    {
+        return std::string();
+    }
+    libexcept::dump_thread_stacks(fileno(f), timeout_ms);
+    std::string result;
+    rewind(f);
+    char buf[1024];
+    for(;;)
+    {
+        std::size_t const r(fread(buf, 1, sizeof(buf), f));
+        if(r == 0)
+        {
+            break;
+        }
+        result.append(buf, r);
+    }
+    fclose(f);
+    return result;
+}
+
+
+class worker
+{
+public:
+    worker(bool block_signal)
+        : f_thread([this, block_signal]()
+            {
+                if(block_signal)
+                {
+                    sigset_t set;
+                    sigemptyset(&set);
+                    sigaddset(&set, libexcept::get_thread_stacks_signal());
+                    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+                }
+                f_tid = gettid();
+                while(!f_stop.load())
+                {
+                    usleep(1000);
+                }
+            })
+    {
+        while(f_tid.load() == 0)
+        {
+            usleep(100);
+        }
+    }
+
+    ~worker()
+    {
+        f_stop.store(true);
+        f_thread.join();
+    }
+
+    pid_t tid() const
+    {
+        return f_tid.load();
+    }
+
+private:
+    std::atomic<pid_t>      f_tid = 0;
+    std::atomic<bool>       f_stop = false;
+    std::thread             f_thread;
+};
+
+
+
+}
+
+
+CATCH_TEST_CASE("thread_stacks", "[thread][signal]")
+{
+    CATCH_START_SECTION("thread stacks: dump other threads")
+    {
+        libexcept::init_thread_stacks();
+        CATCH_CHECK(libexcept::get_thread_stacks_signal() == SIGRTMAX - 1);
+
+        // calling again with the same signal is fine
+        //
+        libexcept::init_thread_stacks(SIGRTMAX - 1);
+
+        worker const w(false);
+        std::string const dump(dump_to_string(libexcept::THREAD_STACKS_DEFAULT_TIMEOUT_MS));
+
+        CATCH_CHECK(dump.find("thread stack: tid=" + std::to_string(w.tid()) + "\n  frame 0x") != std::string::npos);
+        CATCH_CHECK(dump.find("thread stack: tid=" + std::to_string(gettid())) == std::string::npos);
+        CATCH_CHECK(dump.find("end thread stacks\n") != std::string::npos);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread stacks: thread blocking the signal times out")
+    {
+        libexcept::init_thread_stacks();
+
+        worker const w(true);
+        std::string const dump(dump_to_string(20));
+
+        CATCH_CHECK(dump.find("thread stack: tid=" + std::to_string(w.tid()) + " unavailable\n") != std::string::npos);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread stacks: collect one thread on demand")
+    {
+        libexcept::init_thread_stacks();
+
+        worker const w(false);
+        libexcept::thread_stack_t const stack(libexcept::collect_thread_frames(w.tid()));
+        CATCH_CHECK(stack.f_tid == w.tid());
+        CATCH_CHECK(stack.f_captured);
+        CATCH_CHECK_FALSE(stack.f_frames.empty());
+        CATCH_CHECK(stack.f_frames.size() <= libexcept::THREAD_STACKS_FRAMES);
+
+        libexcept::stack_trace_t const trace(libexcept::collect_stack_trace_of_thread(w.tid()));
+        CATCH_CHECK(trace.size() == stack.f_frames.size());
+
+        // the calling thread is captured directly
+        //
+        libexcept::thread_stack_t const self(libexcept::collect_thread_frames(gettid()));
+        CATCH_CHECK(self.f_captured);
+        CATCH_CHECK_FALSE(self.f_frames.empty());
+
+        // many requests in a row reuse the slots
+        //
+        for(int i(0); i < 100; ++i)
+        {
+            CATCH_REQUIRE(libexcept::collect_thread_frames(w.tid()).f_captured);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread stacks: collect all threads")
+    {
+        libexcept::init_thread_stacks();
+
+        worker const w1(false);
+        worker const w2(false);
+        libexcept::thread_stack_list_t const stacks(libexcept::collect_all_thread_frames());
+
+        int found(0);
+        for(auto const & stack : stacks)
+        {
+            CATCH_CHECK(stack.f_tid != gettid());
+            if(stack.f_tid == w1.tid()
+            || stack.f_tid == w2.tid())
+            {
+                CATCH_CHECK(stack.f_captured);
+                CATCH_CHECK_FALSE(stack.f_frames.empty());
+                ++found;
+            }
+        }
+        CATCH_CHECK(found == 2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread stacks: collect a thread blocking the signal")
+    {
+        libexcept::init_thread_stacks();
+
+        worker const w(true);
+        CATCH_CHECK_FALSE(libexcept::collect_thread_frames(w.tid(), 20).f_captured);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::collect_stack_trace_of_thread(w.tid(), 20)
+                , libexcept::thread_stacks_error);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("thread stacks: invalid signal")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::init_thread_stacks(-1)
+                , libexcept::thread_stacks_error);
+        CATCH_REQUIRE_THROWS_AS(
+                  libexcept::init_thread_stacks(SIGRTMAX - 2)
+                , libexcept::thread_stacks_error);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
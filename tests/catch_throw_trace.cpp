@@ -0,0 +1,172 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/throw_trace.h>
+
+
+// C++
+//
+#include    <stdexcept>
+#include    <thread>
+#include    <vector>
+
+
+
+namespace
+{
+
+
+[[gnu::noinline]] void throw_runtime_error()
+{
+    throw std::runtime_error("not derived from libexcept");
+}
+
+
+
+}
+
+
+CATCH_TEST_CASE("throw_trace", "[throw][exception]")
+{
+    CATCH_START_SECTION("throw trace off by default")
+    {
+        CATCH_CHECK_FALSE(libexcept::get_capture_throw_stack());
+
+        try
+        {
+            throw_runtime_error();
+        }
+        catch(std::runtime_error const & e)
+        {
+            CATCH_CHECK(libexcept::get_throw_trace(e) == nullptr);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("throw trace of a standard exception")
+    {
+        libexcept::set_capture_throw_stack(true);
+        CATCH_CHECK(libexcept::get_capture_throw_stack());
+
+        try
+        {
+            throw_runtime_error();
+        }
+        catch(std::exception const & e)
+        {
+            libexcept::throw_trace_t const * trace(libexcept::get_throw_trace(e));
+            CATCH_REQUIRE(trace != nullptr);
+            CATCH_CHECK(trace->f_count > 0);
+            CATCH_CHECK(*trace->f_type == typeid(std::runtime_error));
+
+            libexcept::stack_trace_t const stack(libexcept::throw_trace_to_stack_trace(*trace));
+            CATCH_CHECK(stack.size() == static_cast<std::size_t>(trace->f_count));
+
+            // a copy is not the thrown object
+            //
+            std::runtime_error const copy(dynamic_cast<std::runtime_error const &>(e));
+            CATCH_CHECK(libexcept::get_throw_trace(copy) == nullptr);
+        }
+
+        // rethrowing keeps the original frames
+        //
+        try
+        {
+            try
+            {
+                throw_runtime_error();
+            }
+            catch(std::exception const &)
+            {
+                throw;
+            }
+        }
+        catch(std::exception const & e)
+        {
+            CATCH_CHECK(libexcept::get_throw_trace(e) != nullptr);
+        }
+
+        libexcept::set_capture_throw_stack(false);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("throw trace from the C++ library")
+    {
+        libexcept::set_capture_throw_stack(true);
+
+        std::vector<int> v;
+        try
+        {
+            v.at(3) = 5;
+            CATCH_FAIL("vector::at() did not throw");
+        }
+        catch(std::out_of_range const & e)
+        {
+            libexcept::throw_trace_t const * trace(libexcept::get_throw_trace(e));
+            CATCH_REQUIRE(trace != nullptr);
+            CATCH_CHECK(trace->f_count > 0);
+        }
+
+        libexcept::set_capture_throw_stack(false);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("throw trace slot is per thread")
+    {
+        libexcept::set_capture_throw_stack(true);
+
+        try
+        {
+            throw_runtime_error();
+        }
+        catch(std::exception const & e)
+        {
+            libexcept::throw_trace_t const * trace(libexcept::get_throw_trace(e));
+            CATCH_REQUIRE(trace != nullptr);
+
+            std::thread t([]()
+                {
+                    try
+                    {
+                        throw std::logic_error("other thread");
+                    }
+                    catch(std::logic_error const &)
+                    {
+                    }
+                });
+            t.join();
+
+            CATCH_CHECK(libexcept::get_throw_trace(e) == trace);
+            CATCH_CHECK(*trace->f_type == typeid(std::runtime_error));
+        }
+
+        libexcept::set_capture_throw_stack(false);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,192 @@
+// Copyright (c) 2012-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libexcept
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// self
+//
+#include    "catch_main.h"
+
+
+// libexcept
+//
+#include    <libexcept/watchdog.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <mutex>
+#include    <stdexcept>
+#include    <thread>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("watchdog", "[thread][watchdog]")
+{
+    CATCH_START_SECTION("watchdog: report a stalled thread once")
+    {
+        std::mutex mutex;
+        std::vector<libexcept::watchdog_stall_t> stalls;
+
+        libexcept::start_watchdog(10, [&mutex, &stalls](libexcept::watchdog_stall_t const & stall)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stalls.push_back(stall);
+            });
+        CATCH_CHECK(libexcept::is_watchdog_running());
+        CATCH_REQUIRE_THROWS_AS(libexcept::start_watchdog(10), libexcept::watchdog_error);
+
+        std::atomic<pid_t> tid(0);
+        std::thread worker([&tid]()
+            {
+                libexcept::watchdog_registration watchdog("stuck-worker", 50);
+                tid.store(gettid());
+
+                // healthy for a while
+                //
+                for(int i(0); i < 20; ++i)
+                {
+                    watchdog.heartbeat();
+                    usleep(5'000);
+                }
+
+                // then stuck
+                //
+                usleep(300'000);
+
+                // and healthy again
+                //
+                for(int i(0); i < 20; ++i)
+                {
+                    watchdog.heartbeat();
+                    usleep(5'000);
+                }
+            });
+        worker.join();
+        libexcept::stop_watchdog();
+        CATCH_CHECK_FALSE(libexcept::is_watchdog_running());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        CATCH_REQUIRE(stalls.size() == 1);
+        CATCH_CHECK(stalls[0].f_tid == tid.load());
+        CATCH_CHECK(stalls[0].f_name == "stuck-worker");
+        CATCH_CHECK(stalls[0].f_stalled_ms >= 50);
+        CATCH_CHECK(stalls[0].f_stack.f_captured);
+        CATCH_CHECK_FALSE(stalls[0].f_stack.f_frames.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("watchdog: healthy threads are not reported")
+    {
+        std::atomic<int> count(0);
+        libexcept::start_watchdog(5, [&count](libexcept::watchdog_stall_t const &)
+            {
+                ++count;
+            });
+
+        std::thread worker([]()
+            {
+                libexcept::watchdog_registration watchdog("busy-worker", 100);
+                for(int i(0); i < 100; ++i)
+                {
+                    watchdog.heartbeat();
+                    usleep(2'000);
+                }
+            });
+        worker.join();
+
+        // the registration is gone, a thread which exited is not a stall
+        //
+        usleep(150'000);
+        libexcept::stop_watchdog();
+
+        CATCH_CHECK(count.load() == 0);
+
+        // stopping twice is fine
+        //
+        libexcept::stop_watchdog();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("watchdog: a callback exception does not stop the watchdog")
+    {
+        std::atomic<int> count(0);
+        libexcept::start_watchdog(5, [&count](libexcept::watchdog_stall_t const &)
+            {
+                ++count;
+                throw std::runtime_error("callback failed");
+            });
+
+        auto stuck = [](char const * name)
+            {
+                libexcept::watchdog_registration watchdog(name, 20);
+                usleep(150'000);
+            };
+        std::thread first(stuck, "stuck-worker-1");
+        std::thread second(stuck, "stuck-worker-2");
+        first.join();
+        second.join();
+
+        CATCH_CHECK(libexcept::is_watchdog_running());
+        libexcept::stop_watchdog();
+
+        // both stalls were reported even though the first call threw
+        //
+        CATCH_CHECK(count.load() == 2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("watchdog: invalid parameters")
+    {
+        CATCH_REQUIRE_THROWS_AS(libexcept::start_watchdog(0), libexcept::watchdog_error);
+        CATCH_REQUIRE_THROWS_AS(libexcept::watchdog_registration("bad", 0), libexcept::watchdog_error);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("watchdog: exit while the watchdog is running")
+    {
+        pid_t const child(fork());
+        CATCH_REQUIRE(child >= 0);
+        if(child == 0)
+        {
+            // without the exit guard, the joinable thread calls
+            // std::terminate() and the child gets SIGABRT
+            //
+            libexcept::start_watchdog(10, [](libexcept::watchdog_stall_t const &) {});
+            libexcept::watchdog_registration registration("exiting", 1'000);
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            exit(7);
+        }
+
+        int status(0);
+        CATCH_REQUIRE(waitpid(child, &status, 0) == child);
+        CATCH_CHECK(WIFEXITED(status));
+        CATCH_CHECK(WEXITSTATUS(status) == 7);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,110 @@
+// Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+/** \file
+ * \brief A tool which prints the records of a crash journal.
+ *
+ * A process which calls libexcept::open_crash_journal() saves its
+ * exceptions and crashes in a journal file. This tool reads such a
+ * file and prints the records, from the oldest to the newest.
+ */
+
+
+// libexcept
+//
+#include    <libexcept/crash_journal.h>
+#include    <libexcept/demangle.h>
+
+
+// C++
+//
+#include    <cstring>
+#include    <iomanip>
+#include    <iostream>
+
+
+
+int main(int argc, char * argv[])
+{
+    if(argc != 2
+    || strcmp(argv[1], "--help") == 0
+    || strcmp(argv[1], "-h") == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " <journal>\n";
+        return argc == 2 ? 0 : 1;
+    }
+
+    try
+    {
+        libexcept::journal_records_t const records(libexcept::read_crash_journal(argv[1]));
+        for(auto const & r : records)
+        {
+            std::cout
+                << '#' << r.f_sequence
+                << " time=" << r.f_time.tv_sec
+                << '.' << std::setw(9) << std::setfill('0') << r.f_time.tv_nsec << std::setfill(' ')
+                << " pid=" << r.f_pid
+                << " tid=" << r.f_tid;
+            switch(r.f_type)
+            {
+            case libexcept::journal_record_type_t::JOURNAL_RECORD_EXCEPTION:
+                std::cout
+                    << " exception "
+                    << libexcept::demangle_cpp_name(r.f_name.c_str())
+                    << ": "
+                    << r.f_message
+                    << '\n';
+                break;
+
+            case libexcept::journal_record_type_t::JOURNAL_RECORD_CRASH:
+                std::cout
+                    << " crash signal="
+                    << r.f_signal
+                    << " (SIG"
+                    << r.f_name
+                    << ": "
+                    << r.f_message
+                    << ") address=0x"
+                    << std::hex << r.f_address << std::dec
+                    << '\n';
+                break;
+
+            default:
+                std::cout << " unknown record type\n";
+                break;
+
+            }
+            for(auto const & f : r.f_frames)
+            {
+                std::cout << "  frame 0x" << std::hex << f << std::dec << '\n';
+            }
+        }
+    }
+    catch(libexcept::crash_journal_error const & e)
+    {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -21,19 +21,302 @@
  * \brief A tool which verifies file inheritance.
  *
  * This tool is used to verify that we properly detect file inheritance.
+ *
+ * Without arguments, the tool checks its own descriptors with
+ * libexcept::verify_inherited_files() and aborts if it inherited any
+ * unexpected file.
+ *
+ * With the `--scan` option, the tool checks all the processes running
+ * on the host (or the ones listed on the command line) in parallel and
+ * prints one JSON object per leaked descriptor:
+ *
+ * \code
+ *     {"pid":1234,"command":"/usr/sbin/daemon --flag","fd":5,
+ *      "type":"socket","target":"socket:[98765]","flags":2,
+ *      "cloexec":false,"position":-1}
+ * \endcode
+ *
+ * (shown on two lines here for clarity.)
+ *
+ * A process which cannot be read (i.e. permission denied or the process
+ * exited while being scanned) gets one record with an error instead:
+ *
+ * \code
+ *     {"pid":1,"command":"/sbin/init","error":"EACCES",
+ *      "message":"Permission denied"}
+ * \endcode
+ *
+ * Similarly, a descriptor whose details cannot be read gets a record
+ * with its "fd" and an error instead of its "type", "target", etc.
+ *
+ * The same rules as verify_inherited_files() apply: descriptors other
+ * than stdin, stdout, stderr, and the ones specified with `--allow`
+ * are reported. The exit code is 0 when no leak was found and 1
+ * otherwise; processes and descriptors which could not be read do not
+ * change the exit code.
  */
 
 
 // libexcept
 //
 #include    <libexcept/file_inheritance.h>
+#include    <libexcept/json.h>
 
 
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstring>
+#include    <iostream>
+#include    <mutex>
+#include    <string>
+#include    <thread>
+#include    <vector>
+
+
+// C
+//
+#include    <dirent.h>
+#include    <errno.h>
+#include    <string.h>
+#include    <unistd.h>
 
-int main()
+
+
+namespace
 {
-    libexcept::verify_inherited_files();
-    return 0;
+
+
+
+void usage(char const * progname)
+{
+    std::cerr
+        << "Usage: " << progname << " [--scan [--jobs <count>] [--allow <fd>]... [<pid>...]]\n"
+        << "  without options, verify the files inherited by this process\n"
+        << "  --scan          scan all the processes (or the listed <pid>s)\n"
+        << "  --jobs <count>  number of processes scanned in parallel\n"
+        << "  --allow <fd>    do not report <fd> (can be repeated)\n";
+}
+
+
+std::vector<pid_t> all_processes()
+{
+    std::vector<pid_t> pids;
+    DIR * d(opendir("/proc"));
+    if(d == nullptr)
+    {
+        return pids;
+    }
+    for(dirent const * ent(readdir(d)); ent != nullptr; ent = readdir(d))
+    {
+        if(ent->d_name[0] >= '1'
+        && ent->d_name[0] <= '9')
+        {
+            pids.push_back(std::atoi(ent->d_name));
+        }
+    }
+    closedir(d);
+    return pids;
+}
+
+
+/** \brief Write the error member of a record.
+ *
+ * \param[in] error  The errno describing the error.
+ * \param[in,out] out  The writer receiving the record.
+ */
+void write_error(int error, libexcept::json_writer & out)
+{
+    char const * const name(strerrorname_np(error));
+    out.write_string("error", name == nullptr ? "unknown" : name);
+    out.write_string("message", strerror(error));
+}
+
+
+/** \brief Write the records of one process.
+ *
+ * If the descriptors of the process could not be read, one record with
+ * an "error" member is written instead, so such a process does not look
+ * like a process without leaks. A descriptor whose details could not be
+ * read gets a record with an "error" member too; it is not counted as a
+ * leak since we do not know whether it is close-on-exec.
+ *
+ * \param[in] pid  The process which was scanned.
+ * \param[in] command  The command line of the process.
+ * \param[in] inventory  The descriptors of the process.
+ * \param[in] error  The errno of the scan, 0 if it succeeded.
+ * \param[in] allowed  The descriptors which are not reported.
+ * \param[in,out] out  The writer receiving the records.
+ *
+ * \return The number of leaks found.
+ */
+int write_records(
+      pid_t pid
+    , std::string const & command
+    , libexcept::fd_inventory_t const & inventory
+    , int error
+    , libexcept::allowed_fds_bitmap_t const & allowed
+    , libexcept::json_writer & out)
+{
+    if(error != 0)
+    {
+        out.begin_object();
+        out.write_integer("pid", pid);
+        out.write_string("command", command.c_str(), command.length());
+        write_error(error, out);
+        out.end_object();
+        return 0;
+    }
+
+    int count(0);
+    for(auto const & info : inventory)
+    {
+        if(info.f_fd <= 2
+        || allowed.contains(info.f_fd))
+        {
+            continue;
+        }
+
+        out.begin_object();
+        out.write_integer("pid", pid);
+        out.write_string("command", command.c_str(), command.length());
+        out.write_integer("fd", info.f_fd);
+        if(info.f_error != 0)
+        {
+            write_error(info.f_error, out);
+            out.end_object();
+            continue;
+        }
+        out.write_string("type", libexcept::fd_type_to_string(info.f_type));
+        out.write_string("target", info.f_target.c_str(), info.f_target.length());
+        out.write_integer("flags", info.f_flags);
+        out.write_boolean("cloexec", info.f_cloexec);
+        out.write_integer("position", info.f_position);
+        out.end_object();
+        ++count;
+    }
+    return count;
+}
+
+
+int scan(
+      std::vector<pid_t> pids
+    , libexcept::allowed_fds_bitmap_t const & allowed
+    , std::size_t jobs)
+{
+    if(pids.empty())
+    {
+        pids = all_processes();
+    }
+
+    // our own descriptors are not of interest here
+    //
+    pid_t const self(getpid());
+
+    std::atomic<std::size_t> next(0);
+    std::atomic<int> leaks(0);
+    std::mutex output_mutex;
+    libexcept::json_writer out(STDOUT_FILENO);
+    auto worker = [&]()
+        {
+            libexcept::command_line_cache_t command_lines;
+            libexcept::fd_inventory_t inventory;
+            for(;;)
+            {
+                std::size_t const idx(next.fetch_add(1));
+                if(idx >= pids.size())
+                {
+                    break;
+                }
+                if(pids[idx] == self)
+                {
+                    continue;
+                }
+                int const error(libexcept::get_fd_inventory(pids[idx], inventory) ? 0 : errno);
+                std::string const command(libexcept::command_line_to_string(command_lines.get(pids[idx])));
+
+                std::lock_guard<std::mutex> lock(output_mutex);
+                leaks += write_records(pids[idx], command, inventory, error, allowed, out);
+                out.flush();
+            }
+        };
+
+    jobs = std::max(std::size_t(1), std::min(jobs, pids.size()));
+    std::vector<std::thread> threads;
+    for(std::size_t j(1); j < jobs; ++j)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(auto & t : threads)
+    {
+        t.join();
+    }
+
+    return leaks > 0 ? 1 : 0;
+}
+
+
+
+} // no name namespace
+
+
+
+int main(int argc, char * argv[])
+{
+    if(argc == 1)
+    {
+        libexcept::verify_inherited_files();
+        return 0;
+    }
+
+    bool scan_mode(false);
+    std::size_t jobs(std::max(1U, std::thread::hardware_concurrency()));
+    libexcept::allowed_fds_bitmap_t allowed;
+    std::vector<pid_t> pids;
+    for(int i(1); i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--help") == 0
+        || strcmp(argv[i], "-h") == 0)
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        if(strcmp(argv[i], "--scan") == 0)
+        {
+            scan_mode = true;
+        }
+        else if(strcmp(argv[i], "--jobs") == 0
+             && i + 1 < argc)
+        {
+            ++i;
+            jobs = std::atoi(argv[i]);
+        }
+        else if(strcmp(argv[i], "--allow") == 0
+             && i + 1 < argc)
+        {
+            ++i;
+            allowed.set(std::atoi(argv[i]));
+        }
+        else if(argv[i][0] >= '1'
+             && argv[i][0] <= '9')
+        {
+            pids.push_back(std::atoi(argv[i]));
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if(!scan_mode)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    return scan(pids, allowed, jobs);
 }
 
 